@@ -0,0 +1,295 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "source.h"
+
+// most reads issued while drawing a frame land in the same handful of pages (the class buffer, hex node
+// string previews, rtti walks, the pointer preview tooltip), so pages are cached for the duration of a frame
+// and only the first read of each page actually leaves the process
+
+inline constexpr uintptr_t CACHE_PAGE_SIZE = 0x1000;
+
+struct cachedPage {
+    uint64_t epoch = 0;
+    bool valid = false; // unreadable pages are cached too, garbage pointers would hit the syscall every frame otherwise
+    std::array<uint8_t, CACHE_PAGE_SIZE> data;
+};
+
+struct cacheStats {
+    std::atomic<uint64_t> hits = 0;
+    std::atomic<uint64_t> misses = 0;
+    std::atomic<uint64_t> bypassed = 0;
+};
+
+struct cacheFrameStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t bypassed = 0;
+};
+
+class pageCache {
+public:
+    using readFn = bool(*)(uintptr_t address, void* buf, uintptr_t size);
+    using batchFn = void(*)(std::vector<readRequest>& requests);
+
+    bool enabled = true;
+    uint64_t staleFrames = 0; // how many frames a page may be served after it was read, 0 = current frame only
+    size_t maxPages = 4096;
+    uintptr_t bypassSize = 16 * CACHE_PAGE_SIZE; // large reads (pattern scans etc.) go straight to the reader
+
+    cacheStats stats;
+    cacheFrameStats lastFrame; // counters of the previous completed frame
+
+    pageCache(readFn reader, batchFn batchReader) : reader(reader), batchReader(batchReader) {}
+
+    bool read(uintptr_t address, void* buf, uintptr_t size);
+    void readBatch(std::vector<readRequest>& requests);
+    void invalidate(uintptr_t address, uintptr_t size);
+    void clear();
+    void nextFrame();
+
+private:
+    readFn reader;
+    batchFn batchReader;
+    std::mutex mutex;
+    std::unordered_map<uintptr_t, std::unique_ptr<cachedPage>> pages;
+    uint64_t epoch = 1;
+    cacheFrameStats frameStart;
+
+    bool isFresh(const cachedPage& page) const {
+        return epoch - page.epoch <= staleFrames;
+    }
+
+    bool isCacheable(uintptr_t address, uintptr_t size) const {
+        return enabled && size != 0 && size <= bypassSize && address + size - 1 >= address;
+    }
+};
+
+inline bool pageCache::read(uintptr_t address, void* buf, uintptr_t size) {
+    if (!isCacheable(address, size)) {
+        stats.bypassed++;
+        return reader(address, buf, size);
+    }
+
+    uintptr_t first = address & ~(CACHE_PAGE_SIZE - 1);
+    uintptr_t last = (address + size - 1) & ~(CACHE_PAGE_SIZE - 1);
+
+    auto out = static_cast<uint8_t*>(buf);
+    bool result = true;
+
+    for (uintptr_t page = first;; page += CACHE_PAGE_SIZE) {
+        uintptr_t start = (page < address) ? address - page : 0;
+        uintptr_t end = (address + size - page < CACHE_PAGE_SIZE) ? address + size - page : CACHE_PAGE_SIZE;
+
+        bool hit = false;
+        {
+            std::lock_guard lock(mutex);
+            auto it = pages.find(page);
+            if (it != pages.end() && isFresh(*it->second)) {
+                hit = true;
+                if (it->second->valid) {
+                    memcpy(out, it->second->data.data() + start, end - start);
+                }
+                else {
+                    result = false;
+                }
+            }
+        }
+
+        if (hit) {
+            stats.hits++;
+        }
+        else {
+            stats.misses++;
+
+            // read outside of the lock so other threads aren't stalled on this syscall
+            auto entry = std::make_unique<cachedPage>();
+            entry->valid = reader(page, entry->data.data(), CACHE_PAGE_SIZE);
+
+            if (entry->valid) {
+                memcpy(out, entry->data.data() + start, end - start);
+            }
+            else {
+                result = false;
+            }
+
+            std::lock_guard lock(mutex);
+            entry->epoch = epoch;
+            pages[page] = std::move(entry);
+        }
+
+        out += end - start;
+
+        if (page == last) {
+            break;
+        }
+    }
+
+    return result;
+}
+
+// every page missing from the cache (plus every request too large to cache) is fetched with a single call
+// to the batch reader, after that the cacheable requests are all served from memory
+inline void pageCache::readBatch(std::vector<readRequest>& requests) {
+    std::vector<readRequest> fetches;
+    std::vector<size_t> bypassed;
+    std::vector<std::unique_ptr<cachedPage>> fetched;
+    std::unordered_set<uintptr_t> pending;
+
+    {
+        std::lock_guard lock(mutex);
+        for (size_t i = 0; i < requests.size(); i++) {
+            auto& request = requests[i];
+            if (!isCacheable(request.address, request.size)) {
+                bypassed.push_back(i);
+                continue;
+            }
+
+            uintptr_t first = request.address & ~(CACHE_PAGE_SIZE - 1);
+            uintptr_t last = (request.address + request.size - 1) & ~(CACHE_PAGE_SIZE - 1);
+
+            for (uintptr_t page = first;; page += CACHE_PAGE_SIZE) {
+                auto it = pages.find(page);
+                if ((it == pages.end() || !isFresh(*it->second)) && pending.insert(page).second) {
+                    fetched.push_back(std::make_unique<cachedPage>());
+                    fetches.push_back({ page, CACHE_PAGE_SIZE, fetched.back()->data.data() });
+                }
+
+                if (page == last) {
+                    break;
+                }
+            }
+        }
+    }
+
+    size_t pageFetches = fetches.size();
+    for (size_t index : bypassed) {
+        fetches.push_back(requests[index]);
+    }
+
+    if (!fetches.empty()) {
+        batchReader(fetches);
+    }
+
+    stats.misses += pageFetches;
+    stats.bypassed += bypassed.size();
+
+    for (size_t i = 0; i < bypassed.size(); i++) {
+        requests[bypassed[i]].success = fetches[pageFetches + i].success;
+    }
+
+    {
+        std::lock_guard lock(mutex);
+        for (size_t i = 0; i < pageFetches; i++) {
+            fetched[i]->valid = fetches[i].success;
+            fetched[i]->epoch = epoch;
+            pages[fetches[i].address] = std::move(fetched[i]);
+        }
+    }
+
+    // copied straight out of the pages, only pages that were cached before this batch count as hits. a page
+    // dropped by clear() in the meantime sends the request through read() instead
+    for (size_t i = 0, next = 0; i < requests.size(); i++) {
+        if (next < bypassed.size() && bypassed[next] == i) {
+            next++;
+            continue;
+        }
+
+        auto& request = requests[i];
+        uintptr_t first = request.address & ~(CACHE_PAGE_SIZE - 1);
+        uintptr_t last = (request.address + request.size - 1) & ~(CACHE_PAGE_SIZE - 1);
+
+        auto out = static_cast<uint8_t*>(request.dest);
+        bool result = true;
+        bool served = true;
+        uint64_t hits = 0;
+        {
+            std::lock_guard lock(mutex);
+            for (uintptr_t page = first;; page += CACHE_PAGE_SIZE) {
+                auto it = pages.find(page);
+                if (it == pages.end()) {
+                    served = false;
+                    break;
+                }
+
+                uintptr_t start = (page < request.address) ? request.address - page : 0;
+                uintptr_t end = (request.address + request.size - page < CACHE_PAGE_SIZE) ? request.address + request.size - page : CACHE_PAGE_SIZE;
+                if (it->second->valid) {
+                    memcpy(out, it->second->data.data() + start, end - start);
+                }
+                else {
+                    result = false;
+                }
+                hits += !pending.count(page);
+                out += end - start;
+
+                if (page == last) {
+                    break;
+                }
+            }
+        }
+
+        if (!served) {
+            request.success = read(request.address, request.dest, request.size);
+            continue;
+        }
+
+        stats.hits += hits;
+        request.success = result;
+    }
+}
+
+inline void pageCache::invalidate(uintptr_t address, uintptr_t size) {
+    if (size == 0) {
+        return;
+    }
+
+    uintptr_t first = address & ~(CACHE_PAGE_SIZE - 1);
+    uintptr_t last = (address + size - 1) & ~(CACHE_PAGE_SIZE - 1);
+
+    std::lock_guard lock(mutex);
+    for (uintptr_t page = first;; page += CACHE_PAGE_SIZE) {
+        pages.erase(page);
+
+        if (page == last) {
+            break;
+        }
+    }
+}
+
+inline void pageCache::clear() {
+    std::lock_guard lock(mutex);
+    pages.clear();
+}
+
+// called once per rendered frame, everything read before this point becomes one frame older
+inline void pageCache::nextFrame() {
+    cacheFrameStats now{ stats.hits, stats.misses, stats.bypassed };
+    lastFrame.hits = now.hits - frameStart.hits;
+    lastFrame.misses = now.misses - frameStart.misses;
+    lastFrame.bypassed = now.bypassed - frameStart.bypassed;
+    frameStart = now;
+
+    std::lock_guard lock(mutex);
+    epoch++;
+
+    if (pages.size() <= maxPages) {
+        return;
+    }
+
+    std::erase_if(pages, [this](const auto& entry) { return !isFresh(*entry.second); });
+
+    // still over budget, everything left is fresh so just start over
+    if (pages.size() > maxPages) {
+        pages.clear();
+    }
+}
@@ -128,6 +128,9 @@ public:
 	std::vector<float> totalHeight;
 	size_t lastNodeCount = 0;
 	size_t lastTypeHash = 0;
+	std::vector<readBuf<64>> stringPreviews;
+	std::vector<previewFacts> pointerFacts; // what the reader found out about each visible hex node's value
+	std::shared_ptr<readerSlot> reader; // refreshed in the background, see mem::g_Reader
 
 
 	uClass(int nodeCount, bool incrementCounter = true) {
@@ -169,7 +172,8 @@ public:
 	void drawNumber(int i, int64_t num);
 	void drawFloat(int i, float num);
 	void drawDouble(int i, double num);
-	void drawHexNumber(int i, uintptr_t num, uintptr_t* ptrOut = 0);
+	void drawHexNumber(int i, uintptr_t num, readBuf<64> buf, const previewFacts& facts, uintptr_t* ptrOut = 0);
+	void prefetchPreviews(int startIdx, int endIdx, int counter, const readerSnapshot& snapshot);
 	void drawControllers(int i, int counter);
 	void changeType(int i, nodeType newType, bool selectNew = false, int* newNodes = 0);
 	void changeType(nodeType newType);
@@ -520,7 +524,9 @@ inline void uClass::changeType(int i, nodeType newType, bool selectNew, int* new
 	}
 }
 
-inline void uClass::drawHexNumber(int i, uintptr_t num, uintptr_t* ptrOut) {
+// only looks at what the reader resolved and at local indexes, a value the reader hasn't got to yet shows as a
+// module pointer or nothing for a frame or two
+inline void uClass::drawHexNumber(int i, uintptr_t num, readBuf<64> buf, const previewFacts& facts, uintptr_t* ptrOut) {
 	cur_pad += 15;
 
 	ImColor color = ImColor(255, 162, 0);
@@ -531,7 +537,8 @@ inline void uClass::drawHexNumber(int i, uintptr_t num, uintptr_t* ptrOut) {
 	std::string toDraw;
 
 	pointerInfo info;
-	bool isPointer = mem::isPointer(num, &info);
+	bool inModule = mem::modulePointer(num, &info);
+	bool isPointer = facts.described ? facts.pointer : inModule;
 	if (isPointer) {
 		color = ImColor(255, 0, 0);
 
@@ -539,19 +546,20 @@ inline void uClass::drawHexNumber(int i, uintptr_t num, uintptr_t* ptrOut) {
 			toDraw = "[heap] " + targetAddress;
 		}
 		else {
-			auto exportIt = mem::g_ExportMap.find(num);
-			if (exportIt != mem::g_ExportMap.end()) {
+			if (auto symbol = mem::g_Symbols.find(num)) {
 				color = ImColor(0, 255, 0);
-				toDraw = "[EXPORT] " + exportIt->second + " " + targetAddress;
+				toDraw = "[EXPORT] " + mem::g_Symbols.format(*symbol) + " " + targetAddress;
 			}
 			else {
 				toDraw = std::format("[{}] {} {}", info.section, info.moduleName, targetAddress);
 			}
 		}
 
-		std::string rttiNames;
-		if (mem::rttiInfo(num, rttiNames)) {
-			toDraw += rttiNames;
+		if (!facts.rtti.empty()) {
+			toDraw += facts.rtti;
+		}
+		else if (auto rttiNames = mem::knownRtti(num)) {
+			toDraw += *rttiNames;
 		}
 	}
 
@@ -609,7 +617,6 @@ inline void uClass::drawHexNumber(int i, uintptr_t num, uintptr_t* ptrOut) {
 		}
 	}
 
-	auto buf = Read<readBuf<64>>(num);
 	bool isString = true;
 	for (int it = 0; it < 4; it++) {
 		if (buf.data[it] < 21 || buf.data[it] > 126) {
@@ -719,6 +726,8 @@ inline void uClass::drawStringBytes(int i, const BYTE* lData, int pos, int lSize
 }
 
 inline bool showModuleMissingPopup = false;
+inline bool showInstancesWindow = false;
+inline uintptr_t generateSignatureAt = 0; // picked up by ui::renderModals
 
 inline void uClass::drawControllers(int i, int counter) {
 	auto& node = nodes[i];
@@ -889,6 +898,22 @@ inline void uClass::drawControllers(int i, int counter) {
 		}
 
 
+		// nodes holding a vtable can look for every other object of that class
+		uintptr_t nodeValue = 0;
+		size_t pointerSize = mem::x32 ? 4 : 8;
+		if (counter + pointerSize <= size) {
+			memcpy(&nodeValue, data + counter, pointerSize);
+		}
+
+		if (nodeValue && mem::knownRtti(nodeValue) && ImGui::Selectable("Find instances")) {
+			mem::scanInstances(nodeValue);
+			showInstancesWindow = true;
+		}
+
+		if (ImGui::Selectable("Generate signature")) {
+			generateSignatureAt = this->address + counter;
+		}
+
 		if (ImGui::BeginMenu("Copy")) {
 
 			uintptr_t fullAddress = this->address + counter;
@@ -902,49 +927,26 @@ inline void uClass::drawControllers(int i, int counter) {
 			}
 
 			if (ImGui::Selectable("RVA")) {
+				// the module list is kept current by mem::pollModules, no need to walk the loader list here
+				auto regions = mem::g_Regions.current();
 
-
-				// refresh loaded modules
-				mem::getModules();
-
-				bool foundIt = false;
-
-				for (auto module : mem::moduleList)
-				{
-					if (fullAddress >= module.base && fullAddress <= module.base + module.size)
-					{
-						foundIt = true;
-						ImGui::SetClipboardText(ui::toHexString(fullAddress - module.base, 0).c_str());
-						break;
-					}
+				if (auto module = regions->findModule(fullAddress)) {
+					ImGui::SetClipboardText(ui::toHexString(fullAddress - module->base, 0).c_str());
 				}
-
-				if (!foundIt) {
+				else {
 					// the RVA was not found for any loaded modules, indicate this for the user
 					showModuleMissingPopup = true;
 				}
 			}
 
 			if (ImGui::Selectable("Full RVA")) {
+				auto regions = mem::g_Regions.current();
 
-
-				// refresh loaded modules
-				mem::getModules();
-
-				bool foundIt = false;
-
-				for (auto module : mem::moduleList)
-				{
-					if (fullAddress >= module.base && fullAddress <= module.base + module.size)
-					{
-						foundIt = true;
-						std::string fullName = std::format("{} + 0x{:X}", module.name.c_str(), fullAddress - module.base);
-						ImGui::SetClipboardText(fullName.c_str());
-						break;
-					}
+				if (auto module = regions->findModule(fullAddress)) {
+					std::string fullName = std::format("{} + 0x{:X}", module->name.c_str(), fullAddress - module->base);
+					ImGui::SetClipboardText(fullName.c_str());
 				}
-
-				if (!foundIt) {
+				else {
 					// the RVA was not found for any loaded modules, indicate this for the user
 					showModuleMissingPopup = true;
 				}
@@ -985,8 +987,64 @@ inline void uClass::recalculateHeights() {
 }
 
 
+// hex nodes preview whatever their value points at. the targets are handed to the background reader along
+// with the class itself, what it fetched last time is copied out of the snapshot
+inline void uClass::prefetchPreviews(int startIdx, int endIdx, int counter, const readerSnapshot& snapshot) {
+	stringPreviews.assign(endIdx - startIdx, {});
+	pointerFacts.assign(endIdx - startIdx, {});
+
+	std::vector<uintptr_t> previews;
+	for (int i = startIdx; i < endIdx; i++) {
+		auto& node = nodes[i];
+		auto dataPos = reinterpret_cast<std::uint8_t*>(data) + counter;
+
+		uintptr_t num = 0;
+		switch (node.type) {
+		case node_hex8:
+			num = *reinterpret_cast<int8_t*>(dataPos);
+			break;
+		case node_hex16:
+			num = *reinterpret_cast<int16_t*>(dataPos);
+			break;
+		case node_hex32:
+			num = *reinterpret_cast<int32_t*>(dataPos);
+			break;
+		case node_hex64:
+			num = *reinterpret_cast<int64_t*>(dataPos);
+			break;
+		default:
+			break;
+		}
+
+		if (num) {
+			previews.push_back(num);
+			if (auto preview = snapshot.preview(num)) {
+				memcpy(stringPreviews[i - startIdx].data, preview, sizeof(readBuf<64>));
+			}
+			if (auto facts = snapshot.describe(num)) {
+				pointerFacts[i - startIdx] = *facts;
+			}
+		}
+
+		counter += node.size;
+	}
+
+	mem::g_Reader.request(*reader, address, size, std::move(previews));
+}
+
 inline void uClass::drawNodes() {
-	mem::read(this->address, this->data, this->size);
+	if (!reader) {
+		reader = mem::g_Reader.subscribe();
+	}
+
+	// never reads the target here, whatever the reader finished last is what gets drawn
+	auto& snapshot = reader->latest();
+	if (snapshot.valid && snapshot.address == address) {
+		memcpy(data, snapshot.data.data(), min(size, snapshot.data.size()));
+	}
+	else {
+		memset(data, 0, size);
+	}
 
 	ImVec2 parentSize = ImGui::GetContentRegionAvail();
 
@@ -1036,6 +1094,8 @@ inline void uClass::drawNodes() {
 		counter += nodes[i].size;
 	}
 
+	prefetchPreviews(startIdx, endIdx, counter, snapshot);
+
 	for (int i = startIdx; i < endIdx; i++) {
 		auto& node = nodes[i];
 
@@ -1059,7 +1119,7 @@ inline void uClass::drawNodes() {
 
 			auto num = *reinterpret_cast<int8_t*>(dataPos);
 			drawNumber(i, num);
-			drawHexNumber(i, num);
+			drawHexNumber(i, num, stringPreviews[i - startIdx], pointerFacts[i - startIdx]);
 			break;
 		}
 		case node_hex16:
@@ -1069,7 +1129,7 @@ inline void uClass::drawNodes() {
 
 			auto num = *reinterpret_cast<int16_t*>(dataPos);
 			drawNumber(i, num);
-			drawHexNumber(i, num);
+			drawHexNumber(i, num, stringPreviews[i - startIdx], pointerFacts[i - startIdx]);
 			break;
 		}
 		case node_hex32:
@@ -1082,7 +1142,7 @@ inline void uClass::drawNodes() {
 
 			auto num = *reinterpret_cast<int32_t*>(dataPos);
 			drawNumber(i, num);
-			drawHexNumber(i, num, &clickedPointer);
+			drawHexNumber(i, num, stringPreviews[i - startIdx], pointerFacts[i - startIdx], &clickedPointer);
 			break;
 		}
 		case node_hex64:
@@ -1095,7 +1155,7 @@ inline void uClass::drawNodes() {
 
 			auto num = *reinterpret_cast<int64_t*>(dataPos);
 			drawNumber(i, num);
-			drawHexNumber(i, num, &clickedPointer);
+			drawHexNumber(i, num, stringPreviews[i - startIdx], pointerFacts[i - startIdx], &clickedPointer);
 			break;
 		}
 		case node_int64:
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "source.h"
+
+// export directory parsing on top of a memorySource, the pe structures are spelled out like minidump.h does so it
+// builds without Windows.h. linkers put the three tables, the name strings and the forwarder strings all inside
+// the export directory, so the whole thing comes over in one read and is parsed locally
+
+struct funcExport
+{
+    std::string name; // "#ordinal" for exports without a name
+    uintptr_t address;
+    uint32_t ordinal = 0;
+    std::string forwarder; // "module.name" or "module.#ordinal", address is 0 until resolved
+};
+
+inline constexpr uint32_t EXPORT_MAX_DIRECTORY = 0x1000000;
+inline constexpr uint32_t EXPORT_MAX_ENTRIES = 0x10000; // ordinals are words
+
+namespace pe {
+    inline constexpr uint16_t DOS_SIGNATURE = 0x5A4D; // "MZ"
+    inline constexpr uint32_t NT_SIGNATURE = 0x00004550; // "PE\0\0"
+    inline constexpr uint16_t OPTIONAL_HDR32_MAGIC = 0x10B;
+    inline constexpr uint32_t LFANEW_OFFSET = 0x3C;
+    inline constexpr uint32_t NT_HEADERS64_SIZE = 264;
+    inline constexpr uint32_t OPTIONAL_HEADER_OFFSET = 24; // signature and file header
+    inline constexpr uint32_t EXPORT_DIRECTORY_OFFSET32 = 96; // first data directory in the optional header
+    inline constexpr uint32_t EXPORT_DIRECTORY_OFFSET64 = 112;
+
+    struct exportDirectory {
+        uint32_t characteristics;
+        uint32_t timeDateStamp;
+        uint16_t majorVersion;
+        uint16_t minorVersion;
+        uint32_t name;
+        uint32_t base;
+        uint32_t numberOfFunctions;
+        uint32_t numberOfNames;
+        uint32_t addressOfFunctions;
+        uint32_t addressOfNames;
+        uint32_t addressOfNameOrdinals;
+    };
+    static_assert(sizeof(exportDirectory) == 40);
+}
+
+inline std::vector<funcExport> readModuleExports(memorySource& source, uintptr_t moduleBase)
+{
+    std::vector<funcExport> exports;
+
+    uint8_t headers[4096];
+    if (!source.read(moduleBase, headers, sizeof(headers))) {
+        return exports;
+    }
+
+    uint16_t dosMagic;
+    int32_t lfanew;
+    memcpy(&dosMagic, headers, sizeof(dosMagic));
+    memcpy(&lfanew, headers + pe::LFANEW_OFFSET, sizeof(lfanew));
+    if (dosMagic != pe::DOS_SIGNATURE || lfanew < 0 || lfanew > static_cast<int32_t>(sizeof(headers) - pe::NT_HEADERS64_SIZE)) {
+        return exports;
+    }
+
+    uint32_t signature;
+    uint16_t optionalMagic;
+    memcpy(&signature, headers + lfanew, sizeof(signature));
+    memcpy(&optionalMagic, headers + lfanew + pe::OPTIONAL_HEADER_OFFSET, sizeof(optionalMagic));
+    if (signature != pe::NT_SIGNATURE) {
+        return exports;
+    }
+
+    // the optional header of a 32 bit image is smaller, the data directories move with it
+    uint32_t exportData[2];
+    uint32_t directoryOffset = optionalMagic == pe::OPTIONAL_HDR32_MAGIC ? pe::EXPORT_DIRECTORY_OFFSET32 : pe::EXPORT_DIRECTORY_OFFSET64;
+    memcpy(exportData, headers + lfanew + pe::OPTIONAL_HEADER_OFFSET + directoryOffset, sizeof(exportData));
+
+    uint32_t exportDirRVA = exportData[0];
+    uint32_t exportDirSize = exportData[1];
+
+    if (!exportDirRVA || exportDirSize < sizeof(pe::exportDirectory) || exportDirSize > EXPORT_MAX_DIRECTORY) {
+        return exports;
+    }
+
+    std::vector<uint8_t> directory(exportDirSize);
+    if (!source.read(moduleBase + exportDirRVA, directory.data(), exportDirSize)) {
+        return exports;
+    }
+
+    pe::exportDirectory exportDir;
+    memcpy(&exportDir, directory.data(), sizeof(exportDir));
+
+    if (exportDir.numberOfFunctions > EXPORT_MAX_ENTRIES || exportDir.numberOfNames > exportDir.numberOfFunctions) {
+        return exports;
+    }
+
+    auto inDirectory = [&](uint32_t rva, size_t size) {
+        return rva >= exportDirRVA && size <= exportDirSize && rva - exportDirRVA <= exportDirSize - size;
+    };
+
+    // tables outside of the directory are unusual (packers), those get a read of their own
+    auto copyTable = [&](uint32_t rva, auto& dest) {
+        size_t size = dest.size() * sizeof(dest[0]);
+        if (inDirectory(rva, size)) {
+            memcpy(dest.data(), directory.data() + (rva - exportDirRVA), size);
+            return true;
+        }
+        return source.read(moduleBase + rva, dest.data(), size);
+    };
+
+    std::vector<uint32_t> functionRVAs(exportDir.numberOfFunctions);
+    std::vector<uint32_t> nameRVAs(exportDir.numberOfNames);
+    std::vector<uint16_t> ordinals(exportDir.numberOfNames);
+
+    if (!copyTable(exportDir.addressOfFunctions, functionRVAs) || !copyTable(exportDir.addressOfNames, nameRVAs) ||
+        !copyTable(exportDir.addressOfNameOrdinals, ordinals)) {
+        return exports;
+    }
+
+    auto directoryString = [&](uint32_t rva) {
+        auto start = reinterpret_cast<const char*>(directory.data() + (rva - exportDirRVA));
+        return std::string(start, strnlen(start, exportDirSize - (rva - exportDirRVA)));
+    };
+
+    auto addExport = [&](std::string name, uint32_t index) {
+        uint32_t functionRVA = functionRVAs[index];
+
+        funcExport info;
+        info.name = std::move(name);
+        info.ordinal = exportDir.base + index;
+
+        if (inDirectory(functionRVA, 1)) {
+            info.address = 0;
+            info.forwarder = directoryString(functionRVA);
+        }
+        else {
+            info.address = moduleBase + functionRVA;
+        }
+
+        exports.push_back(std::move(info));
+    };
+
+    exports.reserve(exportDir.numberOfFunctions);
+
+    std::vector<bool> named(exportDir.numberOfFunctions);
+    std::vector<std::array<char, 256>> outsideNames;
+    std::vector<readRequest> requests;
+    std::vector<uint32_t> outsideIndices;
+
+    for (uint32_t i = 0; i < exportDir.numberOfNames; ++i) {
+        uint16_t ordinal = ordinals[i];
+        if (ordinal >= exportDir.numberOfFunctions || !functionRVAs[ordinal]) {
+            continue;
+        }
+
+        named[ordinal] = true;
+
+        if (inDirectory(nameRVAs[i], 1)) {
+            addExport(directoryString(nameRVAs[i]), ordinal);
+        }
+        else {
+            outsideIndices.push_back(i);
+        }
+    }
+
+    // names outside of the directory fall back to one merged batch
+    if (!outsideIndices.empty()) {
+        outsideNames.resize(outsideIndices.size());
+        for (size_t i = 0; i < outsideIndices.size(); i++) {
+            outsideNames[i].fill(0);
+            requests.push_back({ moduleBase + nameRVAs[outsideIndices[i]], outsideNames[i].size() - 1, outsideNames[i].data() });
+        }
+
+        readMerged(requests, [&](std::vector<readRequest>& spans) { source.readBatch(spans); },
+            [&](uintptr_t address, void* buf, uintptr_t size) { return source.read(address, buf, size); });
+
+        for (size_t i = 0; i < outsideIndices.size(); i++) {
+            if (requests[i].success && outsideNames[i][0]) {
+                addExport(outsideNames[i].data(), ordinals[outsideIndices[i]]);
+            }
+        }
+    }
+
+    for (uint32_t i = 0; i < exportDir.numberOfFunctions; ++i) {
+        if (!named[i] && functionRVAs[i]) {
+            addExport(std::string("#").append(std::to_string(exportDir.base + i)), i);
+        }
+    }
+
+    return exports;
+}
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "source.h"
+#include "parallel.h"
+#include "matcher.h"
+
+// every object of a polymorphic class starts with its vtable pointer, so finding all instances means finding
+// every aligned slot in committed private memory that holds that vtable. regions are cut into fixed size chunks
+// that a few workers stream through pooled buffers, memory use doesn't grow with the size of the heap
+
+struct instanceScan {
+    std::vector<uintptr_t> vtables;
+    bool is32Bit = false;
+    uintptr_t chunkSize = 0x400000;
+    unsigned threads = 0; // 0 = one per core
+    size_t maxResults = 1000000;
+};
+
+struct instanceScanStats {
+    uint64_t bytesScanned = 0;
+    size_t chunks = 0;
+    bool truncated = false;
+    double ms = 0;
+};
+
+// appends base + offset of every slot in data equal to one of the targets
+inline void matchSlots(const uint8_t* data, size_t size, const uintptr_t* targets, size_t count, bool is32Bit, uintptr_t base, std::vector<uintptr_t>& out) {
+    const size_t slotSize = is32Bit ? 4 : 8;
+
+    auto matchScalar = [&](size_t begin, size_t end) {
+        for (size_t offset = begin; offset + slotSize <= end; offset += slotSize) {
+            uintptr_t value = 0;
+            memcpy(&value, data + offset, slotSize);
+            for (size_t i = 0; i < count; i++) {
+                if (value == targets[i]) {
+                    out.push_back(base + offset);
+                    break;
+                }
+            }
+        }
+    };
+
+    size_t offset = 0;
+
+#ifdef IMCLASS_SSE2
+    // the low dword of a vtable is distinctive enough to filter 64 byte blocks with, only blocks where it shows
+    // up anywhere get compared slot by slot
+    constexpr size_t BLOCK = 64;
+    if (count <= 8) {
+        __m128i low[8];
+        for (size_t i = 0; i < count; i++) {
+            low[i] = _mm_set1_epi32(static_cast<int>(static_cast<uint32_t>(targets[i])));
+        }
+
+        for (; offset + BLOCK <= size; offset += BLOCK) {
+            auto block = reinterpret_cast<const __m128i*>(data + offset);
+            __m128i a = _mm_loadu_si128(block);
+            __m128i b = _mm_loadu_si128(block + 1);
+            __m128i c = _mm_loadu_si128(block + 2);
+            __m128i d = _mm_loadu_si128(block + 3);
+
+            __m128i hits = _mm_setzero_si128();
+            for (size_t i = 0; i < count; i++) {
+                hits = _mm_or_si128(hits, _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi32(a, low[i]), _mm_cmpeq_epi32(b, low[i])),
+                    _mm_or_si128(_mm_cmpeq_epi32(c, low[i]), _mm_cmpeq_epi32(d, low[i]))));
+            }
+
+            if (_mm_movemask_epi8(hits)) {
+                matchScalar(offset, offset + BLOCK);
+            }
+        }
+    }
+#endif
+
+    matchScalar(offset, size);
+}
+
+inline std::vector<uintptr_t> findInstances(memorySource& source, const instanceScan& scan, instanceScanStats* stats = nullptr,
+    const std::atomic<bool>* cancel = nullptr, std::atomic<uint64_t>* progress = nullptr) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::vector<memoryRegion> regions;
+    source.getRegions(regions);
+
+    std::vector<std::pair<uintptr_t, uintptr_t>> chunks;
+    for (auto& region : regions) {
+        if (region.type != region_private || !region.committed || !(region.protect & protect_read)) {
+            continue;
+        }
+        for (uintptr_t offset = 0; offset < region.size; offset += scan.chunkSize) {
+            chunks.push_back({ region.base + offset, (std::min)(scan.chunkSize, region.size - offset) });
+        }
+    }
+
+    bufferPool pool;
+    std::atomic<uint64_t> scanned = 0;
+    std::vector<std::vector<uintptr_t>> chunkMatches(chunks.size());
+
+    // workers take chunks in address order, so the finished ones form a prefix plus the few still in flight. once
+    // that prefix holds more than maxResults matches nothing after it can make the result, those chunks are
+    // skipped and what they found is dropped, a heap full of matches doesn't pile up before the cut
+    std::mutex prefixMutex;
+    std::vector<bool> done(chunks.size());
+    size_t prefix = 0;
+    size_t prefixMatches = 0;
+    std::atomic<size_t> limit = chunks.size();
+
+    parallelFor(chunks.size(), [&](size_t i) {
+        if ((cancel && *cancel) || i >= limit) {
+            return;
+        }
+
+        auto [base, size] = chunks[i];
+        auto& matches = chunkMatches[i];
+
+        if (auto view = source.view(base, size)) {
+            matchSlots(view, size, scan.vtables.data(), scan.vtables.size(), scan.is32Bit, base, matches);
+        }
+        else {
+            auto buffer = pool.acquire(size);
+            if (source.read(base, buffer.data(), size)) {
+                matchSlots(buffer.data(), size, scan.vtables.data(), scan.vtables.size(), scan.is32Bit, base, matches);
+            }
+            else {
+                // guard pages and the like, take what can be read page by page
+                for (uintptr_t offset = 0; offset < size; offset += 0x1000) {
+                    uintptr_t pageSize = (std::min)(uintptr_t(0x1000), size - offset);
+                    if (source.read(base + offset, buffer.data(), pageSize)) {
+                        matchSlots(buffer.data(), pageSize, scan.vtables.data(), scan.vtables.size(), scan.is32Bit, base + offset, matches);
+                    }
+                }
+            }
+            pool.release(std::move(buffer));
+        }
+
+        scanned += size;
+        if (progress) {
+            *progress += size;
+        }
+
+        std::lock_guard lock(prefixMutex);
+        done[i] = true;
+        while (prefix < chunks.size() && done[prefix] && prefixMatches <= scan.maxResults) {
+            prefixMatches += chunkMatches[prefix++].size();
+        }
+        if (prefixMatches > scan.maxResults) {
+            limit = prefix;
+        }
+        if (i >= limit) {
+            std::vector<uintptr_t>().swap(matches);
+        }
+    }, scan.threads ? scan.threads : workerCount(chunks.size()));
+
+    // chunks are in address order, so are the results
+    std::vector<uintptr_t> result;
+    bool truncated = false;
+    for (auto& matches : chunkMatches) {
+        if (result.size() + matches.size() > scan.maxResults) {
+            result.insert(result.end(), matches.begin(), matches.begin() + (scan.maxResults - result.size()));
+            truncated = true;
+            break;
+        }
+        result.insert(result.end(), matches.begin(), matches.end());
+    }
+
+    if (stats) {
+        stats->bytesScanned = scanned;
+        stats->chunks = chunks.size();
+        stats->truncated = truncated;
+        stats->ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    return result;
+}
+
+// runs findInstances off the ui thread, one search at a time
+class instanceScanner {
+public:
+    std::atomic<uint64_t> bytesDone = 0;
+    std::atomic<uint64_t> bytesTotal = 0;
+
+    ~instanceScanner() { stop(); }
+
+    void start(std::shared_ptr<memorySource> source, instanceScan scan, std::string label);
+    void stop();
+
+    bool busy() const { return running; }
+    std::string label() const;
+    std::vector<uintptr_t> results(instanceScanStats* stats = nullptr) const;
+
+private:
+    mutable std::mutex mutex;
+    std::thread worker;
+    std::atomic<bool> cancel = false;
+    std::atomic<bool> running = false;
+
+    std::string currentLabel;
+    std::vector<uintptr_t> matches;
+    instanceScanStats lastStats;
+};
+
+inline void instanceScanner::stop() {
+    cancel = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    cancel = false;
+}
+
+inline void instanceScanner::start(std::shared_ptr<memorySource> source, instanceScan scan, std::string label) {
+    stop();
+
+    {
+        std::lock_guard lock(mutex);
+        currentLabel = std::move(label);
+        matches.clear();
+        lastStats = {};
+    }
+
+    if (!source || scan.vtables.empty()) {
+        return;
+    }
+
+    std::vector<memoryRegion> regions;
+    source->getRegions(regions);
+    uint64_t total = 0;
+    for (auto& region : regions) {
+        if (region.type == region_private && region.committed && (region.protect & protect_read)) {
+            total += region.size;
+        }
+    }
+    bytesDone = 0;
+    bytesTotal = total;
+
+    running = true;
+    worker = std::thread([this, source = std::move(source), scan = std::move(scan)]() {
+        instanceScanStats stats;
+        auto found = findInstances(*source, scan, &stats, &cancel, &bytesDone);
+
+        std::lock_guard lock(mutex);
+        matches = std::move(found);
+        lastStats = stats;
+        running = false;
+    });
+}
+
+inline std::string instanceScanner::label() const {
+    std::lock_guard lock(mutex);
+    return currentLabel;
+}
+
+inline std::vector<uintptr_t> instanceScanner::results(instanceScanStats* stats) const {
+    std::lock_guard lock(mutex);
+    if (stats) {
+        *stats = lastStats;
+    }
+    return matches;
+}
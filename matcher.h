@@ -0,0 +1,643 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include "source.h"
+#include "parallel.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <immintrin.h>
+#define IMCLASS_SSE2 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// msvc lets any function use avx2 intrinsics, gcc and clang want it spelled out per function
+#if defined(_MSC_VER) && !defined(__clang__)
+#define IMCLASS_TARGET_AVX2
+#else
+#define IMCLASS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+// a signature is scanned for by its rarest fixed byte instead of by its first one: a vector compare of that
+// byte (and the second rarest when there is one) against 16 or 32 positions at once throws out nearly every
+// offset, and only the few survivors get compared in full against the pattern bytes under their mask
+
+enum simdLevel {
+    simd_scalar,
+    simd_sse2,
+    simd_avx2,
+};
+
+inline simdLevel detectSimdLevel() {
+#ifdef IMCLASS_SSE2
+#ifdef _MSC_VER
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return simd_sse2;
+    }
+
+    // the os has to save the ymm registers too, not just the cpu support them
+    __cpuid(info, 1);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) {
+        return simd_sse2;
+    }
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) ? simd_avx2 : simd_sse2;
+#else
+    return __builtin_cpu_supports("avx2") ? simd_avx2 : simd_sse2;
+#endif
+#else
+    return simd_scalar;
+#endif
+}
+
+inline simdLevel bestSimdLevel() {
+    static const simdLevel level = detectSimdLevel();
+    return level;
+}
+
+// rough order of the most common bytes in x86 code and data, anything not listed counts as rare
+constexpr int byteFrequency(uint8_t value) {
+    constexpr uint8_t common[] = {
+        0x00, 0xFF, 0x48, 0x8B, 0xCC, 0x89, 0x0F, 0x24, 0x4C, 0x83, 0x01, 0x8D, 0xE8, 0x44, 0x85, 0xC0,
+        0x74, 0x45, 0x49, 0x41, 0x75, 0x40, 0x90, 0x10, 0x08, 0x20, 0x02, 0x04, 0xC3, 0x33, 0x3B, 0x28,
+        0x30, 0x18, 0x38, 0x5C, 0x4D, 0xC7, 0x80, 0xE9, 0x03, 0x8E, 0x50, 0xF8, 0x58, 0x06, 0x0C, 0xC4,
+    };
+
+    for (size_t i = 0; i < std::size(common); i++) {
+        if (common[i] == value) {
+            return static_cast<int>(std::size(common) - i);
+        }
+    }
+    return 0;
+}
+
+// patterns come with a bitset of the bytes that have to match, bit i of fixed[i / 64] for byte i
+constexpr bool isFixedByte(const uint64_t* fixed, size_t i) {
+    return (fixed[i / 64] >> (i % 64)) & 1;
+}
+
+// the bytes candidates are filtered on before a full compare: the rarest fixed byte, and the rarest one that
+// differs from it, "CC CC" would just filter on CC twice. ties go to the earlier byte
+struct patternAnchors {
+    bool any = false;
+    bool two = false;
+    size_t first = 0;
+    size_t second = 0;
+};
+
+constexpr patternAnchors choosePatternAnchors(const uint8_t* signature, const uint64_t* fixed, size_t length) {
+    patternAnchors anchors;
+    for (size_t i = 0; i < length; i++) {
+        if (isFixedByte(fixed, i) && (!anchors.any || byteFrequency(signature[i]) < byteFrequency(signature[anchors.first]))) {
+            anchors.first = i;
+            anchors.any = true;
+        }
+    }
+    if (!anchors.any) {
+        return anchors;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        if (isFixedByte(fixed, i) && signature[i] != signature[anchors.first]
+            && (!anchors.two || byteFrequency(signature[i]) < byteFrequency(signature[anchors.second]))) {
+            anchors.second = i;
+            anchors.two = true;
+        }
+    }
+    return anchors;
+}
+
+class patternMatcher {
+public:
+    patternMatcher(const uint8_t* signature, const uint64_t* fixed, size_t length);
+    patternMatcher(const uint8_t* signature, const uint64_t* fixed, size_t length, const patternAnchors& anchors);
+
+    size_t length() const { return patternLength; }
+
+    // appends base + offset of every match in data, in ascending order
+    void find(const uint8_t* data, size_t size, uintptr_t base, std::vector<uintptr_t>& out, simdLevel level = bestSimdLevel()) const;
+
+    bool matchesAt(const uint8_t* data) const;
+
+private:
+    size_t patternLength = 0;
+    std::vector<uint8_t> bytes; // wildcards zeroed, padded with wildcards to a multiple of 16
+    std::vector<uint8_t> masks; // 0xFF where the byte has to match
+
+    bool anyFixed = false;
+    bool twoAnchors = false;
+    size_t anchor = 0;
+    size_t secondAnchor = 0;
+
+    void findScalar(const uint8_t* data, size_t begin, size_t last, uintptr_t base, std::vector<uintptr_t>& out) const;
+
+#ifdef IMCLASS_SSE2
+    bool verify(const uint8_t* data, size_t size, size_t offset) const;
+    size_t findSse2(const uint8_t* data, size_t size, uintptr_t base, std::vector<uintptr_t>& out) const;
+    IMCLASS_TARGET_AVX2 size_t findAvx2(const uint8_t* data, size_t size, uintptr_t base, std::vector<uintptr_t>& out) const;
+#endif
+};
+
+inline patternMatcher::patternMatcher(const uint8_t* signature, const uint64_t* fixed, size_t length)
+    : patternMatcher(signature, fixed, length, choosePatternAnchors(signature, fixed, length)) {}
+
+inline patternMatcher::patternMatcher(const uint8_t* signature, const uint64_t* fixed, size_t length, const patternAnchors& anchors)
+    : patternLength(length), anyFixed(anchors.any), twoAnchors(anchors.two), anchor(anchors.first), secondAnchor(anchors.second) {
+    size_t padded = (length + 15) & ~size_t(15);
+    bytes.assign(padded, 0);
+    masks.assign(padded, 0);
+
+    for (size_t i = 0; i < length; i++) {
+        if (isFixedByte(fixed, i)) {
+            bytes[i] = signature[i];
+            masks[i] = 0xFF;
+        }
+    }
+}
+
+inline bool patternMatcher::matchesAt(const uint8_t* data) const {
+    for (size_t i = 0; i < patternLength; i++) {
+        if ((data[i] & masks[i]) != bytes[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void patternMatcher::findScalar(const uint8_t* data, size_t begin, size_t last, uintptr_t base, std::vector<uintptr_t>& out) const {
+    for (size_t i = begin; i <= last; i++) {
+        if (anyFixed && data[i + anchor] != bytes[anchor]) {
+            continue;
+        }
+        if (matchesAt(data + i)) {
+            out.push_back(base + i);
+        }
+    }
+}
+
+inline void patternMatcher::find(const uint8_t* data, size_t size, uintptr_t base, std::vector<uintptr_t>& out, simdLevel level) const {
+    if (patternLength == 0 || size < patternLength) {
+        return;
+    }
+
+    size_t begin = 0;
+
+#ifdef IMCLASS_SSE2
+    // a pattern of nothing but wildcards matches everywhere, there's nothing to filter on
+    if (anyFixed) {
+        if (level >= simd_avx2) {
+            begin = findAvx2(data, size, base, out);
+        }
+        else if (level >= simd_sse2) {
+            begin = findSse2(data, size, base, out);
+        }
+    }
+#endif
+
+    findScalar(data, begin, size - patternLength, base, out);
+}
+
+#ifdef IMCLASS_SSE2
+// full compare of one candidate, 16 bytes at a time while the padded pattern still fits in the buffer
+inline bool patternMatcher::verify(const uint8_t* data, size_t size, size_t offset) const {
+    if (offset + bytes.size() > size) {
+        return matchesAt(data + offset);
+    }
+
+    for (size_t i = 0; i < bytes.size(); i += 16) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + offset + i));
+        __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks.data() + i));
+        __m128i expected = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes.data() + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(value, mask), expected)) != 0xFFFF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// both return the first offset they didn't look at, the scalar loop finishes from there
+inline size_t patternMatcher::findSse2(const uint8_t* data, size_t size, uintptr_t base, std::vector<uintptr_t>& out) const {
+    const size_t last = size - patternLength;
+    const size_t reach = (std::max)(anchor, secondAnchor);
+    const __m128i first = _mm_set1_epi8(static_cast<char>(bytes[anchor]));
+    const __m128i second = _mm_set1_epi8(static_cast<char>(bytes[secondAnchor]));
+
+    size_t i = 0;
+    for (; i <= last && i + reach + 16 <= size; i += 16) {
+        unsigned hits = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + anchor)), first));
+        if (hits && twoAnchors) {
+            hits &= _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + secondAnchor)), second));
+        }
+
+        while (hits) {
+            size_t offset = i + std::countr_zero(hits);
+            hits &= hits - 1;
+            if (offset > last) {
+                break;
+            }
+            if (verify(data, size, offset)) {
+                out.push_back(base + offset);
+            }
+        }
+    }
+    return i;
+}
+
+IMCLASS_TARGET_AVX2 inline size_t patternMatcher::findAvx2(const uint8_t* data, size_t size, uintptr_t base, std::vector<uintptr_t>& out) const {
+    const size_t last = size - patternLength;
+    const size_t reach = (std::max)(anchor, secondAnchor);
+    const __m256i first = _mm256_set1_epi8(static_cast<char>(bytes[anchor]));
+    const __m256i second = _mm256_set1_epi8(static_cast<char>(bytes[secondAnchor]));
+
+    size_t i = 0;
+    for (; i <= last && i + reach + 32 <= size; i += 32) {
+        uint32_t hits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + anchor)), first)));
+        if (hits && twoAnchors) {
+            hits &= static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + secondAnchor)), second)));
+        }
+
+        while (hits) {
+            size_t offset = i + std::countr_zero(hits);
+            hits &= hits - 1;
+            if (offset > last) {
+                break;
+            }
+            if (verify(data, size, offset)) {
+                out.push_back(base + offset);
+            }
+        }
+    }
+    return i;
+}
+#endif
+
+// a whole signature set in one pass. every signature is filed under a key made of its rarest run of adjacent fixed
+// bytes: four when it has them, else two, else one. the pass hashes the four bytes at each offset into a bitmap
+// of the keys in use (small enough to stay in cache) and only looks further where it hits, shorter keys are kept
+// in plain tables for the few signatures that need them
+class multiMatcher {
+public:
+    multiMatcher();
+
+    // returns the id results are reported under, patterns without a single fixed byte can't be keyed and are rejected
+    std::optional<size_t> add(const uint8_t* signature, const uint64_t* fixed, size_t length);
+
+    size_t count() const { return patterns.size(); }
+    size_t maxLength() const { return longest; }
+
+    // appends base + offset of every match of pattern i to out[i], ascending per pattern
+    void find(const uint8_t* data, size_t size, uintptr_t base, std::vector<std::vector<uintptr_t>>& out) const;
+
+private:
+    static constexpr int QUAD_BITS = 18;
+
+    struct keyed {
+        uint32_t key;
+        uint32_t id;
+        uint32_t offset; // of the key inside the pattern
+    };
+
+    std::vector<patternMatcher> patterns;
+    size_t longest = 0;
+
+    std::vector<uint64_t> quadBits;
+    std::vector<keyed> quads; // sorted by key
+    std::vector<uint64_t> pairBits; // one bit per little endian byte pair
+    std::vector<std::vector<keyed>> pairs;
+    std::vector<std::vector<keyed>> singles; // by byte
+
+    static uint32_t quadHash(uint32_t key) { return (key * 0x9E3779B1u) >> (32 - QUAD_BITS); }
+
+    void check(const keyed& candidate, const uint8_t* data, size_t size, size_t position, uintptr_t base, std::vector<std::vector<uintptr_t>>& out) const;
+};
+
+inline multiMatcher::multiMatcher() : quadBits((size_t(1) << QUAD_BITS) / 64), pairBits(65536 / 64), pairs(65536), singles(256) {}
+
+inline std::optional<size_t> multiMatcher::add(const uint8_t* signature, const uint64_t* fixed, size_t length) {
+    // longest run of fixed bytes wins, the rarest one among runs of the same length
+    size_t bestWidth = 0;
+    int bestScore = INT_MAX;
+    size_t bestOffset = 0;
+
+    for (size_t i = 0; i < length; i++) {
+        size_t width = 0;
+        int score = 0;
+        while (width < 4 && i + width < length && isFixedByte(fixed, i + width)) {
+            score += byteFrequency(signature[i + width]);
+            width++;
+        }
+        width = width == 3 ? 2 : width;
+        if (width == 2) {
+            score = byteFrequency(signature[i]) + byteFrequency(signature[i + 1]);
+        }
+
+        if (width > bestWidth || (width == bestWidth && width && score < bestScore)) {
+            bestWidth = width;
+            bestScore = score;
+            bestOffset = i;
+        }
+    }
+
+    if (bestWidth == 0) {
+        return std::nullopt;
+    }
+
+    uint32_t id = static_cast<uint32_t>(patterns.size());
+    patterns.emplace_back(signature, fixed, length);
+    longest = (std::max)(longest, length);
+
+    uint32_t key = 0;
+    memcpy(&key, signature + bestOffset, bestWidth);
+    keyed entry{ key, id, static_cast<uint32_t>(bestOffset) };
+
+    if (bestWidth == 4) {
+        uint32_t hash = quadHash(key);
+        quadBits[hash >> 6] |= uint64_t(1) << (hash & 63);
+        quads.insert(std::upper_bound(quads.begin(), quads.end(), entry, [](const keyed& a, const keyed& b) { return a.key < b.key; }), entry);
+    }
+    else if (bestWidth == 2) {
+        pairBits[key >> 6] |= uint64_t(1) << (key & 63);
+        pairs[key].push_back(entry);
+    }
+    else {
+        singles[key].push_back(entry);
+    }
+
+    return id;
+}
+
+inline void multiMatcher::check(const keyed& candidate, const uint8_t* data, size_t size, size_t position, uintptr_t base,
+    std::vector<std::vector<uintptr_t>>& out) const {
+    if (position < candidate.offset) {
+        return;
+    }
+    size_t start = position - candidate.offset;
+    auto& pattern = patterns[candidate.id];
+    if (start + pattern.length() <= size && pattern.matchesAt(data + start)) {
+        out[candidate.id].push_back(base + start);
+    }
+}
+
+inline void multiMatcher::find(const uint8_t* data, size_t size, uintptr_t base, std::vector<std::vector<uintptr_t>>& out) const {
+    out.resize((std::max)(out.size(), patterns.size()));
+
+    // every pattern sits in exactly one of the tables, so a pass per table keeps each pattern's matches in order
+    if (!quads.empty() && size >= 4) {
+        const uint64_t* bits = quadBits.data();
+        for (size_t i = 0; i + 4 <= size; i++) {
+            uint32_t key;
+            memcpy(&key, data + i, 4);
+            uint32_t hash = quadHash(key);
+            if (!(bits[hash >> 6] & (uint64_t(1) << (hash & 63)))) {
+                continue;
+            }
+
+            auto it = std::lower_bound(quads.begin(), quads.end(), key, [](const keyed& a, uint32_t b) { return a.key < b; });
+            for (; it != quads.end() && it->key == key; ++it) {
+                check(*it, data, size, i, base, out);
+            }
+        }
+    }
+
+    if (std::any_of(pairBits.begin(), pairBits.end(), [](uint64_t bits) { return bits != 0; })) {
+        for (size_t i = 0; i + 2 <= size; i++) {
+            uint32_t key = data[i] | (data[i + 1] << 8);
+            if (pairBits[key >> 6] & (uint64_t(1) << (key & 63))) {
+                for (auto& candidate : pairs[key]) {
+                    check(candidate, data, size, i, base, out);
+                }
+            }
+        }
+    }
+
+    if (std::any_of(singles.begin(), singles.end(), [](const auto& list) { return !list.empty(); })) {
+        for (size_t i = 0; i < size; i++) {
+            for (auto& candidate : singles[data[i]]) {
+                check(candidate, data, size, i, base, out);
+            }
+        }
+    }
+}
+
+inline constexpr uintptr_t PATTERN_CHUNK_SIZE = 0x100000;
+
+struct patternScanOptions {
+    uintptr_t chunkSize = PATTERN_CHUNK_SIZE;
+    unsigned threads = 0; // 0 = one per core, 1 keeps matching on the calling thread
+    unsigned readAhead = 2; // chunks a worker may have read before matching them, 0 reads and matches in turn
+};
+
+struct scanRange {
+    uintptr_t base = 0;
+    uintptr_t size = 0;
+};
+
+// a chunk as it comes off the source: either a view into it or a pooled copy, and the parts that could be read
+struct patternChunk {
+    size_t index = 0;
+    std::vector<uint8_t> buffer;
+    const uint8_t* data = nullptr;
+    std::vector<std::pair<uintptr_t, uintptr_t>> runs; // offset, size
+};
+
+struct chunkSpan {
+    uintptr_t start;
+    uintptr_t end; // matches have to start before this
+    uintptr_t span; // bytes read, the chunk plus the overlap as far as its range goes
+};
+
+// ranges are cut into chunks in the order given, so sorted ranges give chunks in address order
+inline std::vector<chunkSpan> splitChunks(const std::vector<scanRange>& ranges, uintptr_t overlap, const patternScanOptions& options) {
+    const uintptr_t chunkSize = (std::max)(options.chunkSize, uintptr_t(0x1000));
+
+    std::vector<chunkSpan> chunks;
+    for (auto& range : ranges) {
+        for (uintptr_t offset = 0; offset < range.size; offset += chunkSize) {
+            uintptr_t owned = (std::min)(chunkSize, range.size - offset);
+            chunks.push_back({ range.base + offset, range.base + offset + owned, (std::min)(owned + overlap, range.size - offset) });
+        }
+    }
+    return chunks;
+}
+
+// streams the ranges of a source without ever holding more than a few chunks per worker. every chunk is read
+// together with the overlap bytes after it (as far as its range goes) so matches across a chunk border are still
+// found, callers keep only matches that start before the chunk's end. a chunk that can't be read in one go is
+// read page by page and each readable run is handed out on its own, a protected page costs the matches that
+// touch it and no more. each worker owns a block of chunks and steals from the others when it runs out, with
+// read ahead a reader thread per worker fills the next buffers while the worker scans the current one.
+// scan(chunk index, run data, run size, run address, chunk end) runs on the workers
+template <typename Fn>
+inline void scanChunks(memorySource& source, const std::vector<chunkSpan>& chunks, const patternScanOptions& options, Fn&& scan) {
+    const unsigned threads = options.threads ? options.threads : workerCount(chunks.size());
+
+    bufferPool pool;
+    rangeStealer stealer(chunks.size(), threads);
+
+    auto load = [&](size_t i) {
+        patternChunk chunk;
+        chunk.index = i;
+
+        const uintptr_t start = chunks[i].start;
+        const uintptr_t span = chunks[i].span;
+
+        // dumps usually hold the whole module in one piece
+        if ((chunk.data = source.view(start, span))) {
+            chunk.runs.push_back({ 0, span });
+            return chunk;
+        }
+
+        chunk.buffer = pool.acquire(span);
+        chunk.data = chunk.buffer.data();
+        if (source.read(start, chunk.buffer.data(), span)) {
+            chunk.runs.push_back({ 0, span });
+            return chunk;
+        }
+
+        uintptr_t runStart = 0;
+        uintptr_t position = 0;
+        while (position < span) {
+            uintptr_t pageEnd = (std::min)((((start + position) & ~uintptr_t(0xFFF)) + 0x1000) - start, span);
+            if (!source.read(start + position, chunk.buffer.data() + position, pageEnd - position)) {
+                if (position > runStart) {
+                    chunk.runs.push_back({ runStart, position - runStart });
+                }
+                runStart = pageEnd;
+            }
+            position = pageEnd;
+        }
+        if (position > runStart) {
+            chunk.runs.push_back({ runStart, position - runStart });
+        }
+        return chunk;
+    };
+
+    auto process = [&](patternChunk& chunk) {
+        auto& info = chunks[chunk.index];
+        for (auto [offset, runSize] : chunk.runs) {
+            scan(chunk.index, chunk.data + offset, runSize, info.start + offset, info.end);
+        }
+
+        if (!chunk.buffer.empty()) {
+            pool.release(std::move(chunk.buffer));
+        }
+    };
+
+    runWorkers(threads, [&](unsigned worker) {
+        size_t i;
+
+        if (options.readAhead == 0) {
+            while (stealer.next(worker, i)) {
+                auto chunk = load(i);
+                process(chunk);
+            }
+            return;
+        }
+
+        boundedQueue<patternChunk> loaded(options.readAhead);
+        std::thread reader([&]() {
+            size_t next;
+            while (stealer.next(worker, next)) {
+                loaded.push(load(next));
+            }
+            loaded.close();
+        });
+
+        patternChunk chunk;
+        while (loaded.pop(chunk)) {
+            process(chunk);
+        }
+        reader.join();
+    });
+}
+
+inline std::vector<uintptr_t> findPattern(memorySource& source, const std::vector<scanRange>& ranges, const patternMatcher& matcher,
+    const patternScanOptions& options = {}) {
+    std::vector<uintptr_t> result;
+
+    const uintptr_t length = matcher.length();
+    if (length == 0) {
+        return result;
+    }
+
+    auto chunks = splitChunks(ranges, length - 1, options);
+    std::vector<std::vector<uintptr_t>> chunkMatches(chunks.size());
+
+    scanChunks(source, chunks, options, [&](size_t chunk, const uint8_t* data, uintptr_t runSize, uintptr_t address, uintptr_t end) {
+        auto& matches = chunkMatches[chunk];
+        size_t before = matches.size();
+        matcher.find(data, runSize, address, matches);
+        while (matches.size() > before && matches.back() >= end) {
+            matches.pop_back();
+        }
+    });
+
+    // chunks are in the order of the ranges, so are the results
+    for (auto& matches : chunkMatches) {
+        result.insert(result.end(), matches.begin(), matches.end());
+    }
+    return result;
+}
+
+inline std::vector<uintptr_t> findPattern(memorySource& source, uintptr_t base, uintptr_t size, const patternMatcher& matcher,
+    const patternScanOptions& options = {}) {
+    return findPattern(source, std::vector<scanRange>{ { base, size } }, matcher, options);
+}
+
+// one pass over the ranges for a whole set, result[i] holds the matches of pattern i in range order
+inline std::vector<std::vector<uintptr_t>> findPatterns(memorySource& source, const std::vector<scanRange>& ranges, const multiMatcher& matcher,
+    const patternScanOptions& options = {}) {
+    std::vector<std::vector<uintptr_t>> result(matcher.count());
+
+    const uintptr_t length = matcher.maxLength();
+    if (length == 0) {
+        return result;
+    }
+
+    auto chunks = splitChunks(ranges, length - 1, options);
+    std::vector<std::vector<std::vector<uintptr_t>>> chunkMatches(chunks.size());
+
+    scanChunks(source, chunks, options, [&](size_t chunk, const uint8_t* data, uintptr_t runSize, uintptr_t address, uintptr_t end) {
+        auto& matches = chunkMatches[chunk];
+        matches.resize(matcher.count());
+
+        std::vector<size_t> before(matches.size());
+        for (size_t i = 0; i < matches.size(); i++) {
+            before[i] = matches[i].size();
+        }
+
+        matcher.find(data, runSize, address, matches);
+
+        for (size_t i = 0; i < matches.size(); i++) {
+            while (matches[i].size() > before[i] && matches[i].back() >= end) {
+                matches[i].pop_back();
+            }
+        }
+    });
+
+    for (auto& matches : chunkMatches) {
+        for (size_t i = 0; i < matches.size(); i++) {
+            result[i].insert(result[i].end(), matches[i].begin(), matches[i].end());
+        }
+    }
+    return result;
+}
+
+inline std::vector<std::vector<uintptr_t>> findPatterns(memorySource& source, uintptr_t base, uintptr_t size, const multiMatcher& matcher,
+    const patternScanOptions& options = {}) {
+    return findPatterns(source, std::vector<scanRange>{ { base, size } }, matcher, options);
+}
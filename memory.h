@@ -1,13 +1,35 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <string_view>
 #include <Windows.h>
 #include <vector>
 #include <tlhelp32.h>
 #include <unordered_map>
+#include <unordered_set>
 #include <winternl.h>
 #include <Psapi.h>
 
+#include "source.h"
+#include "exports.h"
+#include "cache.h"
+#include "minidump.h"
+#include "regions.h"
+#include "symbols.h"
+#include "parallel.h"
+#include "modcache.h"
+#include "rtticache.h"
+#include "rttiindex.h"
+#include "instances.h"
+#include "reader.h"
+#include "pipeline.h"
+
 struct processSnapshot {
     std::wstring name;
     DWORD pid;
@@ -17,6 +39,7 @@ struct moduleSection {
     uintptr_t base;
     DWORD size;
     char name[8];
+    DWORD characteristics; // IMAGE_SCN_*, names can't be trusted on packed images
 };
 
 struct moduleInfo {
@@ -24,6 +47,7 @@ struct moduleInfo {
     DWORD size;
     std::vector<moduleSection> sections;
     std::string name;
+    moduleIdentity identity;
 };
 
 struct pointerInfo {
@@ -53,57 +77,225 @@ struct TypeDescriptor {
     char name[60];
 };
 
-struct funcExport
-{
-	std::string name;
-	uintptr_t address;
+// milliseconds spent in each phase of the last attach
+struct attachTimings {
+    double modules = 0;
+    double sections = 0;
+    double regions = 0;
+    double exports = 0;
+    double symbols = 0;
+    unsigned threads = 0;
+    std::atomic<unsigned> cachedModules = 0; // served from the module cache
 };
 
+enum moduleEventType {
+    module_loaded,
+    module_unloaded
+};
+
+// published whenever the module list changes, caches keyed by addresses inside a module drop them on unload
+struct moduleEvent {
+    moduleEventType type;
+    std::string name;
+    uintptr_t base;
+    uintptr_t size;
+};
+
+using moduleListener = std::function<void(const moduleEvent&)>;
+
 namespace mem {
     inline std::vector<processSnapshot> processes;
-    inline HANDLE memHandle;
+    inline std::shared_ptr<memorySource> g_Source;
     inline DWORD g_pid;
     inline std::vector<moduleInfo> moduleList;
-    inline std::unordered_map<uintptr_t, std::string> g_ExportMap;
+    inline std::unordered_map<std::string, size_t> g_ModuleIndex; // lowercase name -> moduleList index
+    inline std::vector<moduleListener> g_ModuleListeners;
+    inline symbolTable g_Symbols;
+    inline attachTimings g_AttachTimings;
+    inline moduleCache g_ModuleCache;
+    inline const char* MODULE_CACHE_PATH = "ImClass.modcache";
     inline bool x32 = false;
 
     bool getProcessList();
-    HANDLE openHandle(DWORD pid);
-    uintptr_t getPEB();
-    bool getModuleInfo(DWORD pid, const wchar_t* moduleName, moduleInfo* info);
+    bool getModuleInfo(std::string_view moduleName, moduleInfo* info);
+    const moduleInfo* findModule(std::string_view name);
     void getModules();
+    bool refreshModules(attachTimings* timings = nullptr, std::vector<size_t>* added = nullptr); // true if anything was loaded or unloaded
+    bool diffModules(memorySource* source, std::vector<moduleInfo>& modules, std::vector<size_t>& added, std::vector<moduleEvent>& events);
+    void loadModuleHeaders(std::vector<moduleInfo>& modules, const std::vector<size_t>& indices);
+    void rebuildModuleIndex();
+    void pollModules();
+    void onModuleEvent(moduleListener listener);
+    std::string lowerName(std::string_view name);
+    void buildRegionIndex(const std::vector<moduleInfo>& modules);
     void getSections(const moduleInfo& info, std::vector<moduleSection>& dest);
-    bool isPointer(uintptr_t address, pointerInfo* info);
-    bool rttiInfo(uintptr_t address, std::string& out);
+    bool getModuleIdentity(const moduleInfo& info, moduleIdentity* identity);
+    bool isPointer(uintptr_t address, pointerInfo* info); // can query the target, the ui gets it from the reader
+    bool modulePointer(uintptr_t address, pointerInfo* info); // isPointer for module addresses, from the index alone
+    const std::string* rttiInfo(uintptr_t address); // " : class : base ...", nullptr if address isn't a vtable
+    const std::string* knownRtti(uintptr_t address); // rttiInfo without reading the target, nullptr until resolved
+    void describePreview(uintptr_t address, previewFacts& facts); // g_Reader's describer
+    bool resolveRtti(uintptr_t address, std::string& out);
+    void indexRtti();
+    void scanInstances(uintptr_t vtable);
+    void scanInstances(const std::string& className);
     std::vector<funcExport> gatherRemoteExports(uintptr_t moduleBase);
-    void gatherExports();
+    symbolTable buildSymbols(const std::vector<moduleInfo>& modules, attachTimings* timings = nullptr, symbolTable symbols = {});
+    symbolTable updateSymbols(const symbolTable& symbols, const std::vector<moduleInfo>& modules, const std::vector<size_t>& added);
+    void resolveForwarders(symbolTable& symbols, const std::vector<moduleInfo>& modules, std::vector<std::vector<funcExport>>& moduleExports,
+        const std::vector<std::vector<std::pair<uint32_t, uintptr_t>>>& cachedOrdinals);
     uintptr_t getExport(const std::string& moduleName, const std::string& exportName);
 
     bool read(uintptr_t address, void* buf, uintptr_t size);
+    bool readDirect(uintptr_t address, void* buf, uintptr_t size);
+    void readDirectBatch(std::vector<readRequest>& requests);
+    bool readBatch(std::vector<readRequest>& requests);
     bool write(uintptr_t address, const void* buf, uintptr_t size);
+    const uint8_t* view(uintptr_t address, uintptr_t size);
+    bool attach(std::shared_ptr<memorySource> source);
     bool initProcess(DWORD pid);
-    bool isX32(HANDLE handle);
+    bool openDump(const std::string& path);
+
+    inline pageCache g_Cache{ readDirect, readDirectBatch };
+    inline regionIndex g_Regions;
+    inline rttiCache g_Rtti;
+    inline rttiIndex g_RttiIndex;
+    inline instanceScanner g_Instances;
+    inline backgroundReader g_Reader;
+    inline stagedPipeline g_Attach;
+    inline stagedPipeline g_ModulePoll; // one stage, never runs while g_Attach does
+
+    inline constexpr DWORD RTTI_MAX_BASE_CLASSES = 256;
+    inline constexpr int FORWARDER_MAX_DEPTH = 4; // kernel32 -> kernelbase -> ntdll is the usual worst case
 
     inline bool activeProcess = false;
     inline std::chrono::steady_clock::time_point lastCheck = std::chrono::steady_clock::now();
     inline constexpr std::chrono::milliseconds PROCESS_CHECK_INTERVAL{ 1000 };
+    inline std::chrono::steady_clock::time_point lastModuleCheck = std::chrono::steady_clock::now();
+    inline constexpr std::chrono::milliseconds MODULE_CHECK_INTERVAL{ 2000 };
 
     bool isProcessAlive();
     void cleanDeadProcess();
-}
 
-inline bool mem::isX32(HANDLE handle) {
-    BOOL wow64 = FALSE;
-    if (!IsWow64Process(handle, &wow64)) {
-        return false;
+    inline double msSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
     }
-
-    return wow64;
 }
 
 template <typename T>
 T Read(uintptr_t address);
-inline bool mem::rttiInfo(uintptr_t address, std::string& out) {
+inline const std::string* mem::rttiInfo(uintptr_t address) {
+    auto lookup = g_Rtti.find(address);
+    if (lookup.names) {
+        return lookup.names;
+    }
+
+    bool inModule = g_Regions.current()->findModule(address) != nullptr;
+
+    // vtables the background index found don't need the remote walk, that includes ones the walk missed before
+    // the index got to their module
+    if (inModule) {
+        if (auto type = g_RttiIndex.current()->findVtable(address)) {
+            return g_Rtti.store(address, g_Rtti.intern(type->hierarchy), true);
+        }
+    }
+
+    if (lookup.cached) {
+        return nullptr;
+    }
+
+    std::string names;
+    if (!resolveRtti(address, names)) {
+        return g_Rtti.store(address, nullptr, inModule);
+    }
+
+    return g_Rtti.store(address, g_Rtti.intern(names), inModule);
+}
+
+inline const std::string* mem::knownRtti(uintptr_t address) {
+    if (auto names = g_Rtti.find(address).names) {
+        return names;
+    }
+
+    if (g_Regions.current()->findModule(address)) {
+        if (auto type = g_RttiIndex.current()->findVtable(address)) {
+            return g_Rtti.store(address, g_Rtti.intern(type->hierarchy), true);
+        }
+    }
+    return nullptr;
+}
+
+// runs on the reader thread, the rtti walk and region queries for values the ui is about to draw happen here
+inline void mem::describePreview(uintptr_t address, previewFacts& facts) {
+    pointerInfo info;
+    facts.pointer = isPointer(address, &info);
+    if (facts.pointer) {
+        if (auto names = rttiInfo(address)) {
+            facts.rtti = *names;
+        }
+    }
+}
+
+// read only data (.rdata) holds the locators and vtables, the type descriptors they point at live in writable
+// data (.data). sections are told apart by their characteristics like pattern scans do, packers rename them
+inline void mem::indexRtti() {
+    std::vector<rttiScanModule> modules;
+    for (auto& module : moduleList) {
+        rttiScanModule entry{ module.name, module.base, module.size };
+        bool hasReadOnly = false;
+        for (auto& section : module.sections) {
+            bool data = section.characteristics & IMAGE_SCN_CNT_INITIALIZED_DATA;
+            bool code = section.characteristics & (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE);
+            if (!data || code || (section.characteristics & IMAGE_SCN_MEM_DISCARDABLE) || !section.size) {
+                continue;
+            }
+
+            bool readOnly = !(section.characteristics & IMAGE_SCN_MEM_WRITE);
+            entry.sections.push_back({ section.base, section.size, readOnly });
+            hasReadOnly |= readOnly;
+        }
+
+        if (hasReadOnly) {
+            modules.push_back(std::move(entry));
+        }
+    }
+
+    g_RttiIndex.start(g_Source, g_Source && g_Source->is32Bit(), std::move(modules));
+}
+
+inline void mem::scanInstances(uintptr_t vtable) {
+    instanceScan scan;
+    scan.vtables = { vtable };
+    scan.is32Bit = x32;
+
+    // " : name : base ..." -> "name"
+    std::string label;
+    if (auto names = knownRtti(vtable)) {
+        label = names->substr(3, names->find(" : ", 3) - 3);
+    }
+    else {
+        char text[32];
+        snprintf(text, sizeof(text), "vtable %llX", static_cast<unsigned long long>(vtable));
+        label = text;
+    }
+
+    g_Instances.start(g_Source, std::move(scan), std::move(label));
+}
+
+// a class can show up in several modules (templates, statically linked libraries), all of them count
+inline void mem::scanInstances(const std::string& className) {
+    instanceScan scan;
+    scan.is32Bit = x32;
+    for (auto type : g_RttiIndex.current()->findClass(className)) {
+        if (type->primaryVtable) {
+            scan.vtables.push_back(type->primaryVtable);
+        }
+    }
+
+    g_Instances.start(g_Source, std::move(scan), className);
+}
+
+inline bool mem::resolveRtti(uintptr_t address, std::string& out) {
     uintptr_t objectLocatorPtr = Read<uintptr_t>(address - sizeof(void*));
     if (!objectLocatorPtr) {
         return false;
@@ -113,53 +305,67 @@ inline bool mem::rttiInfo(uintptr_t address, std::string& out) {
     auto baseModule = objectLocatorPtr - objectLocator.selfOffset;
 
     auto hierarchy = Read<RTTIClassHierarchyDescriptor>(baseModule + objectLocator.hierarchyDescriptorOffset);
-    uintptr_t classArray = baseModule + hierarchy.pBaseClassArray;
+    if (hierarchy.numBaseClasses > RTTI_MAX_BASE_CLASSES) {
+        return false;
+    }
+
+    // every hop past the hierarchy fans out over all base classes, so each level is fetched as one batch
+    std::vector<DWORD> classDescriptors(hierarchy.numBaseClasses);
+    read(baseModule + hierarchy.pBaseClassArray, classDescriptors.data(), classDescriptors.size() * sizeof(DWORD));
 
+    std::vector<DWORD> typeDescriptorOffsets(hierarchy.numBaseClasses);
+    std::vector<readRequest> requests;
     for (DWORD i = 0; i < hierarchy.numBaseClasses; i++) {
-        uintptr_t classDescriptor = baseModule + Read<DWORD>(classArray + i * sizeof(DWORD));
-        DWORD typeDescriptorOffset = Read<DWORD>(classDescriptor);
-        auto typeDescriptor = Read<TypeDescriptor>(baseModule + typeDescriptorOffset);
+        requests.push_back({ baseModule + classDescriptors[i], sizeof(DWORD), &typeDescriptorOffsets[i] });
+    }
+    readBatch(requests);
+
+    std::vector<TypeDescriptor> typeDescriptors(hierarchy.numBaseClasses);
+    requests.clear();
+    for (DWORD i = 0; i < hierarchy.numBaseClasses; i++) {
+        requests.push_back({ baseModule + typeDescriptorOffsets[i], sizeof(TypeDescriptor), &typeDescriptors[i] });
+    }
+    readBatch(requests);
 
-        std::string name = typeDescriptor.name;
-        if (!name.ends_with("@@")) {
+    for (auto& typeDescriptor : typeDescriptors) {
+        std::string_view name(typeDescriptor.name, strnlen(typeDescriptor.name, sizeof(typeDescriptor.name)));
+        if (name.size() < 6 || !name.ends_with("@@")) {
             return false;
         }
 
-        name = name.substr(4);
-        name = name.substr(0, name.size() - 2);
-
-        out = out + " : " + name;
+        // ".?AVname@@" -> "name"
+        out += " : ";
+        out += name.substr(4, name.size() - 6);
     }
 
     return true;
 }
 
-DECLSPEC_NOINLINE bool mem::isPointer(uintptr_t address, pointerInfo* info) {
-	for (auto& module : moduleList) {
-		if (module.base <= address && address <= module.base + module.size) {
-			info->moduleName = module.name;
+inline bool mem::modulePointer(uintptr_t address, pointerInfo* info) {
+    auto regions = g_Regions.current();
 
-			// default to unknown as pointers to places like the pe header don't get caught by any of these cases
-			strcpy_s(info->section, 8, "UNK");
+    if (auto module = regions->findModule(address)) {
+        info->moduleName = module->name;
 
-			for (auto& section : module.sections) {
-				if (section.base <= address && address < section.base + section.size) {
-					memcpy(info->section, section.name, 8);
-					break;
-				}
-			}
-			return true;
-		}
-	}
+        // default to unknown as pointers to places like the pe header don't get caught by any of these cases
+        strcpy_s(info->section, 8, "UNK");
 
-    MEMORY_BASIC_INFORMATION mbi;
-    if (VirtualQueryEx(memHandle, reinterpret_cast<LPCVOID>(address), &mbi, sizeof(mbi))) {
-        return (mbi.Type == MEM_PRIVATE && mbi.State == MEM_COMMIT);
+        if (auto section = regionSnapshot::findSection(*module, address)) {
+            memcpy(info->section, section->name, 8);
+        }
+        return true;
     }
-
     return false;
 }
 
+DECLSPEC_NOINLINE bool mem::isPointer(uintptr_t address, pointerInfo* info) {
+    if (modulePointer(address, info)) {
+        return true;
+    }
+
+    return g_Regions.isPrivate(*g_Regions.current(), address);
+}
+
 inline bool mem::getProcessList() {
     processes.clear();
 
@@ -190,308 +396,580 @@ inline bool mem::getProcessList() {
     return true;
 }
 
+// synchronous full reload, attach goes through the staged pipeline instead
 inline void mem::getModules() {
 	moduleList.clear();
+	g_ModuleIndex.clear();
+	refreshModules(&g_AttachTimings);
+}
 
-	uintptr_t pebAddress = getPEB();
-	if (pebAddress == NULL)
-		return;
+// diffs the loader list against moduleList, modules that are still mapped at the same base keep everything
+// parsed about them and only the new ones get their headers read
+inline bool mem::refreshModules(attachTimings* timings, std::vector<size_t>* addedOut) {
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<size_t> added;
+	std::vector<moduleEvent> events;
+	diffModules(g_Source.get(), moduleList, added, events);
+
+	if (timings) {
+		timings->modules = msSince(start);
+		timings->cachedModules = 0;
+	}
+	start = std::chrono::steady_clock::now();
 
-	uintptr_t PEBldrAddress = pebAddress + offsetof(PEB, PEB::Ldr);
-	uintptr_t PEBldr = 0;
-	read(PEBldrAddress, &PEBldr, sizeof(uintptr_t));
+	loadModuleHeaders(moduleList, added);
+	rebuildModuleIndex();
 
-	uintptr_t moduleListHead = PEBldr + offsetof(PEB_LDR_DATA, PEB_LDR_DATA::InMemoryOrderModuleList);
-	uintptr_t currentLink = 0;
-	read(moduleListHead, &currentLink, sizeof(uintptr_t));
+	if (timings) {
+		timings->sections = msSince(start);
+		timings->threads = workerCount(added.size());
+	}
+	start = std::chrono::steady_clock::now();
 
-	while (currentLink != moduleListHead)
-	{
-		uintptr_t entryBase = currentLink - offsetof(LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
+	if (events.empty()) {
+		return false;
+	}
 
-		// BaseDllName is immediately after FullDllName
-		UNICODE_STRING dllString;
-		uintptr_t linkDllNameAddress = entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::FullDllName) + sizeof(UNICODE_STRING);
-		read(linkDllNameAddress, &dllString, sizeof(UNICODE_STRING));
+	buildRegionIndex(moduleList);
 
-		size_t charCount = (dllString.Length / sizeof(wchar_t)) + 1;
-		std::vector<wchar_t> dllName(charCount, L'\0');
-		read(reinterpret_cast<uintptr_t>(dllString.Buffer), dllName.data(), dllString.Length);
+	if (timings) {
+		timings->regions = msSince(start);
+	}
 
-		uintptr_t baseAddress = 0;
-		read(entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::DllBase), &baseAddress, sizeof(baseAddress));
+	for (auto& event : events) {
+		for (auto& listener : g_ModuleListeners) {
+			listener(event);
+		}
+	}
 
-		ULONG moduleSize = 0;
-		// reserved in winternl but SizeOfImage
-		read(entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::DllBase) + 0x10, &moduleSize, sizeof(moduleSize));
+	if (addedOut) {
+		*addedOut = std::move(added);
+	}
+	return true;
+}
 
-		std::wstring lDllNameW(dllName.begin(), dllName.end());
-		moduleInfo info;
-		info.name = std::string(lDllNameW.begin(), lDllNameW.end());
-		info.base = baseAddress;
-		info.size = moduleSize;
+// replaces modules with what the loader lists now. entries still mapped at the same base are moved over as they
+// are, added holds the indices of the new ones, which have no headers read yet
+inline bool mem::diffModules(memorySource* source, std::vector<moduleInfo>& modules, std::vector<size_t>& added, std::vector<moduleEvent>& events) {
+	std::vector<sourceModule> loaded;
+	if (source) {
+		source->getModules(loaded);
+	}
+
+	std::unordered_map<uintptr_t, size_t> known;
+	known.reserve(modules.size());
+	for (size_t i = 0; i < modules.size(); i++) {
+		known.emplace(modules[i].base, i);
+	}
 
-		getSections(info, info.sections);
-		moduleList.push_back(info);
+	std::vector<moduleInfo> next;
+	std::vector<bool> kept(modules.size());
+	next.reserve(loaded.size());
+	added.clear();
+	events.clear();
+
+	for (auto& module : loaded) {
+		auto it = known.find(module.base);
+		if (it != known.end() && !kept[it->second] && modules[it->second].size == module.size && modules[it->second].name == module.name) {
+			kept[it->second] = true;
+			next.push_back(std::move(modules[it->second]));
+			continue;
+		}
 
-		read(currentLink, &currentLink, sizeof(currentLink));
+		moduleInfo info;
+		info.name = module.name;
+		info.base = module.base;
+		info.size = static_cast<DWORD>(module.size);
+		added.push_back(next.size());
+		next.push_back(std::move(info));
 	}
 
-	return;
+	for (size_t i = 0; i < modules.size(); i++) {
+		if (!kept[i]) {
+			events.push_back({ module_unloaded, modules[i].name, modules[i].base, modules[i].size });
+		}
+	}
+	for (size_t index : added) {
+		events.push_back({ module_loaded, next[index].name, next[index].base, next[index].size });
+	}
+
+	modules = std::move(next);
+	return !events.empty();
 }
 
-inline void mem::getSections(const moduleInfo& info, std::vector<moduleSection>& dest) {
-    BYTE buf[4096];
-    read(info.base, buf, sizeof(buf));
+// identity and sections of the given entries, from the module cache where possible
+inline void mem::loadModuleHeaders(std::vector<moduleInfo>& modules, const std::vector<size_t>& indices) {
+	if (!g_ModuleCache.isOpen()) {
+		g_ModuleCache.open(MODULE_CACHE_PATH);
+	}
 
-    auto dosHeader = (IMAGE_DOS_HEADER*)buf;
-    auto ntHeader = (IMAGE_NT_HEADERS*)(buf + dosHeader->e_lfanew);
-    auto sectionHeader = IMAGE_FIRST_SECTION(ntHeader);
+	parallelFor(indices.size(), [&](size_t i) {
+		auto& module = modules[indices[i]];
+		getModuleIdentity(module, &module.identity);
 
-    for (WORD i = 0; i < ntHeader->FileHeader.NumberOfSections; i++) {
-        auto section = sectionHeader[i];
-        moduleSection sectionInfo;
-        sectionInfo.base = info.base + section.VirtualAddress;
-        sectionInfo.size = section.Misc.VirtualSize;
-        memcpy(sectionInfo.name, section.Name, 8);
-        dest.push_back(sectionInfo);
-    }
+		std::vector<cachedSection> cached;
+		if (!g_ModuleCache.loadSections(module.identity, cached)) {
+			getSections(module, module.sections);
+			return;
+		}
+
+		for (auto& section : cached) {
+			moduleSection sectionInfo;
+			sectionInfo.base = module.base + section.rva;
+			sectionInfo.size = section.size;
+			memcpy(sectionInfo.name, section.name, 8);
+			sectionInfo.characteristics = section.characteristics;
+			module.sections.push_back(sectionInfo);
+		}
+	});
 }
 
+inline void mem::rebuildModuleIndex() {
+	g_ModuleIndex.clear();
+	g_ModuleIndex.reserve(moduleList.size());
+	for (size_t i = 0; i < moduleList.size(); i++) {
+		g_ModuleIndex.emplace(lowerName(moduleList[i].name), i); // first one wins if a name is loaded twice
+	}
+}
 
+// live targets load and unload dlls all the time, the list is diffed every now and then instead of walked on use.
+// the diff, the headers and exports of new modules and the region walk run on g_ModulePoll's worker, the ui only
+// swaps in the results. the worker reads g_Symbols, which nothing replaces while a poll is busy: attach stops the
+// poll first and getModuleInfo leaves the list alone until it's done
+inline void mem::pollModules() {
+	g_ModulePoll.publish();
 
-typedef NTSTATUS(*_NtQueryInformationProcess)(IN HANDLE ProcessHandle,
-	IN PROCESSINFOCLASS ProcessInformationClass,
-	OUT PVOID ProcessInformation,
-	IN ULONG ProcessInformationLength,
-	OUT PULONG ReturnLength OPTIONAL);
+	if (!g_Source || g_Source->isSnapshot() || g_Attach.busy() || g_ModulePoll.busy()) {
+		return;
+	}
 
-inline uintptr_t mem::getPEB()
-{
-    PROCESS_BASIC_INFORMATION processInformation;
-    ULONG written = 0;
+	auto curTime = std::chrono::steady_clock::now();
+	if (curTime - lastModuleCheck < MODULE_CHECK_INTERVAL) {
+		return;
+	}
+	lastModuleCheck = curTime;
+
+	auto modules = std::make_shared<std::vector<moduleInfo>>(moduleList);
+	auto target = g_Source;
+
+	g_ModulePoll.start({
+		{ "modules", [=](const std::atomic<bool>& cancel) -> stagedPipeline::publishFn {
+			std::vector<size_t> added;
+			std::vector<moduleEvent> events;
+			if (!diffModules(target.get(), *modules, added, events)) {
+				return nullptr;
+			}
+
+			loadModuleHeaders(*modules, added);
+			auto symbols = std::make_shared<symbolTable>(updateSymbols(g_Symbols, *modules, added));
+			if (cancel) {
+				return nullptr;
+			}
+			buildRegionIndex(*modules);
+
+			return [=]() {
+				moduleList = std::move(*modules);
+				rebuildModuleIndex();
+				g_Symbols = std::move(*symbols);
 
-    HMODULE hNtdll = GetModuleHandleA("ntdll.dll");
+				for (auto& event : events) {
+					for (auto& listener : g_ModuleListeners) {
+						listener(event);
+					}
+				}
 
-    static _NtQueryInformationProcess query = (_NtQueryInformationProcess)GetProcAddress(hNtdll, "NtQueryInformationProcess");
+				// modules that are still loaded keep their types, only the new ones are scanned
+				indexRtti();
+			};
+		} },
+	});
+}
 
-    NTSTATUS result = query(memHandle, ProcessBasicInformation, &processInformation, sizeof(PROCESS_BASIC_INFORMATION), &written);
+inline void mem::onModuleEvent(moduleListener listener) {
+	g_ModuleListeners.push_back(std::move(listener));
+}
 
-    return reinterpret_cast<uintptr_t>(processInformation.PebBaseAddress);
+inline std::string mem::lowerName(std::string_view name) {
+	std::string result(name);
+	std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+	return result;
 }
 
-inline bool mem::getModuleInfo(DWORD pid, const wchar_t* moduleName, moduleInfo* info) {
+inline const moduleInfo* mem::findModule(std::string_view name) {
+	auto it = g_ModuleIndex.find(lowerName(name));
+	if (it == g_ModuleIndex.end()) {
+		return nullptr;
+	}
 
-	uintptr_t pebAddress = getPEB();
+	return &moduleList[it->second];
+}
 
-	if (pebAddress == NULL)
-		return false;
+inline void mem::buildRegionIndex(const std::vector<moduleInfo>& list) {
+    std::vector<indexedModule> modules;
+    for (auto& module : list) {
+        indexedModule entry{ module.base, module.base + module.size, module.name };
+        for (auto& section : module.sections) {
+            indexedSection indexed{ section.base, section.base + section.size };
+            memcpy(indexed.name, section.name, 8);
+            entry.sections.push_back(indexed);
+        }
+        modules.push_back(std::move(entry));
+    }
 
-	uintptr_t PEBldrAddress = pebAddress + offsetof(PEB, PEB::Ldr);
-	uintptr_t PEBldr = 0;
-	read(PEBldrAddress, &PEBldr, sizeof(uintptr_t));
+    g_Regions.build(g_Source, std::move(modules));
+}
 
-	uintptr_t moduleListHead = PEBldr + offsetof(PEB_LDR_DATA, PEB_LDR_DATA::InMemoryOrderModuleList);
+inline void mem::getSections(const moduleInfo& info, std::vector<moduleSection>& dest) {
+    BYTE buf[4096];
+    if (!read(info.base, buf, sizeof(buf))) {
+        return;
+    }
 
-	uintptr_t currentLink = 0;
-	read(moduleListHead, &currentLink, sizeof(uintptr_t));
+    // not every source hands out pe images (linux targets map elf files), so don't trust the headers blindly
+    auto dosHeader = (IMAGE_DOS_HEADER*)buf;
+    if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE || dosHeader->e_lfanew < 0 || dosHeader->e_lfanew > sizeof(buf) - sizeof(IMAGE_NT_HEADERS)) {
+        return;
+    }
 
-	while (currentLink != moduleListHead)
-	{
-		uintptr_t entryBase = currentLink - offsetof(LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
+    auto ntHeader = (IMAGE_NT_HEADERS*)(buf + dosHeader->e_lfanew);
+    auto sectionHeader = IMAGE_FIRST_SECTION(ntHeader);
 
+    if (ntHeader->Signature != IMAGE_NT_SIGNATURE) {
+        return;
+    }
 
-		// https://www.geoffchappell.com/studies/windows/km/ntoskrnl/inc/api/ntldr/ldr_data_table_entry.htm
-		UNICODE_STRING dllString;
-		// base dll name is directly after full dll name
-		uintptr_t linkDllNameAddress = entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::FullDllName) + sizeof(UNICODE_STRING);
+    for (WORD i = 0; i < ntHeader->FileHeader.NumberOfSections; i++) {
+        if (reinterpret_cast<BYTE*>(&sectionHeader[i + 1]) > buf + sizeof(buf)) {
+            break;
+        }
 
-		// this is going to give an incorrect pointer to the string located inside dllString
-		// however the length will be correct, so the length will be used to construct our own string with the contents
-		// of the original
-		read(linkDllNameAddress, &dllString, sizeof(UNICODE_STRING));
+        auto section = sectionHeader[i];
+        moduleSection sectionInfo;
+        sectionInfo.base = info.base + section.VirtualAddress;
+        sectionInfo.size = section.Misc.VirtualSize;
+        memcpy(sectionInfo.name, section.Name, 8);
+        sectionInfo.characteristics = section.Characteristics;
+        dest.push_back(sectionInfo);
+    }
+}
 
-		size_t charCount = (dllString.Length / sizeof(wchar_t)) + 1;
-		std::vector<wchar_t> dllName(charCount, L'\0');
 
-		read(reinterpret_cast<uintptr_t>(dllString.Buffer), dllName.data(), dllString.Length);
 
-		uintptr_t baseAddress = 0;
-		read(entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::DllBase), &baseAddress, sizeof(baseAddress));
+// what the module cache is keyed by, everything comes from the header page that getSections reads anyway
+inline bool mem::getModuleIdentity(const moduleInfo& info, moduleIdentity* identity) {
+    *identity = moduleIdentity();
 
-		ULONG moduleSize = 0;
+    BYTE buf[4096];
+    if (!read(info.base, buf, sizeof(buf))) {
+        return false;
+    }
 
-		// reserved in winternl but SizeOfImage
-		read(entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::DllBase) + 0x10, &moduleSize, sizeof(moduleSize));
+    auto dosHeader = (IMAGE_DOS_HEADER*)buf;
+    if (dosHeader->e_magic != IMAGE_DOS_SIGNATURE || dosHeader->e_lfanew < 0 || dosHeader->e_lfanew > sizeof(buf) - sizeof(IMAGE_NT_HEADERS)) {
+        return false;
+    }
 
-		std::wstring lDllNameW(dllName.begin(), dllName.end());
-		std::string lDllName(lDllNameW.begin(), lDllNameW.end());
+    auto ntHeader = (IMAGE_NT_HEADERS*)(buf + dosHeader->e_lfanew);
+    if (ntHeader->Signature != IMAGE_NT_SIGNATURE) {
+        return false;
+    }
 
-		if (wcscmp(moduleName, dllName.data()) == 0)
-		{
-			// found it!!!
+    auto sectionHeader = reinterpret_cast<BYTE*>(IMAGE_FIRST_SECTION(ntHeader));
+    size_t sectionBytes = ntHeader->FileHeader.NumberOfSections * sizeof(IMAGE_SECTION_HEADER);
+    if (sectionHeader + sectionBytes > buf + sizeof(buf)) {
+        return false;
+    }
 
-			info->base = baseAddress;
-			info->size = moduleSize;
-			info->name = lDllName;
+    // SizeOfImage sits at the same offset in the 32 and 64 bit optional headers
+    identity->name = info.name;
+    std::transform(identity->name.begin(), identity->name.end(), identity->name.begin(), tolower);
+    identity->timeDateStamp = ntHeader->FileHeader.TimeDateStamp;
+    identity->sizeOfImage = ntHeader->OptionalHeader.SizeOfImage;
+    identity->headerHash = fnv1a(sectionHeader, sectionBytes);
+    return true;
+}
 
-			getSections(*info, info->sections);
+inline bool mem::getModuleInfo(std::string_view moduleName, moduleInfo* info) {
+	auto module = findModule(moduleName);
 
-			return true;
-		}
-		read(currentLink, &currentLink, sizeof(currentLink));
+	// a module loaded since the last poll is picked up right away instead of failing until then
+	std::vector<size_t> added;
+	if (!module && g_Source && !g_Source->isSnapshot() && !g_Attach.busy() && !g_ModulePoll.busy() && refreshModules(nullptr, &added)) {
+		g_Symbols = updateSymbols(g_Symbols, moduleList, added);
+		module = findModule(moduleName);
 	}
 
-	return false;
-}
+	if (!module) {
+		return false;
+	}
 
-inline HANDLE mem::openHandle(const DWORD pid) {
-    memHandle = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ | PROCESS_VM_WRITE, FALSE, pid);
-    return memHandle;
+	*info = *module;
+	return true;
 }
 
 inline bool mem::read(uintptr_t address, void* buf, uintptr_t size) {
-    SIZE_T sizeRead;
-    return ReadProcessMemory(memHandle, reinterpret_cast<LPCVOID>(address), buf, size, &sizeRead);
+    return g_Cache.read(address, buf, size);
 }
 
-inline bool mem::write(uintptr_t address, const void* buf, uintptr_t size) {
-    SIZE_T sizeWritten;
-    return WriteProcessMemory(memHandle, reinterpret_cast<LPVOID>(address), buf, size, &sizeWritten);
+// merged reads go through the page cache, a span that fails is retried request by request the same way
+inline bool mem::readBatch(std::vector<readRequest>& requests) {
+    return readMerged(requests, [](std::vector<readRequest>& spans) { g_Cache.readBatch(spans); },
+        [](uintptr_t address, void* buf, uintptr_t size) { return read(address, buf, size); });
 }
 
-inline std::vector<funcExport> mem::gatherRemoteExports(uintptr_t moduleBase)
-{
-	std::vector<funcExport> exports;
-	IMAGE_DOS_HEADER dosHeader;
+// bypasses the page cache, use for anything that must observe the target's current memory
+inline bool mem::readDirect(uintptr_t address, void* buf, uintptr_t size) {
+    return g_Source && g_Source->read(address, buf, size);
+}
 
-	if (!read(moduleBase, &dosHeader, sizeof(IMAGE_DOS_HEADER)) || dosHeader.e_magic != IMAGE_DOS_SIGNATURE) {
-		return exports;
-	}
+inline void mem::readDirectBatch(std::vector<readRequest>& requests) {
+    if (g_Source) {
+        g_Source->readBatch(requests);
+    }
+}
 
-	IMAGE_NT_HEADERS ntHeaders;
+inline bool mem::write(uintptr_t address, const void* buf, uintptr_t size) {
+    g_Cache.invalidate(address, size);
 
-	if (!read(moduleBase + dosHeader.e_lfanew, &ntHeaders, sizeof(IMAGE_NT_HEADERS)) ||
-		ntHeaders.Signature != IMAGE_NT_SIGNATURE) {
-		return exports;
-	}
+    return g_Source && g_Source->write(address, buf, size);
+}
 
-	DWORD exportDirRVA = ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].VirtualAddress;
-	DWORD exportDirSize = ntHeaders.OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT].Size;
+// nullptr unless the source keeps the target in local memory, callers fall back to read
+inline const uint8_t* mem::view(uintptr_t address, uintptr_t size) {
+    return g_Source ? g_Source->view(address, size) : nullptr;
+}
 
-	if (!exportDirRVA || !exportDirSize) {
-		return exports;
+// straight from the source, the export directory is only parsed once per attach and would just churn the page cache
+inline std::vector<funcExport> mem::gatherRemoteExports(uintptr_t moduleBase)
+{
+	if (!g_Source) {
+		return {};
 	}
 
-	IMAGE_EXPORT_DIRECTORY exportDir;
+	return readModuleExports(*g_Source, moduleBase);
+}
 
-	if (!read(moduleBase + exportDirRVA, &exportDir, sizeof(IMAGE_EXPORT_DIRECTORY))) {
-		return exports;
+// exports of the modules that are still loaded are carried over from the last table, only the added ones are
+// parsed or taken from the module cache. forwarders into a module that went away go with it, ones that were
+// carried over stay resolved the way they were
+inline symbolTable mem::updateSymbols(const symbolTable& symbols, const std::vector<moduleInfo>& modules, const std::vector<size_t>& added)
+{
+	std::vector<bool> isAdded(modules.size());
+	for (size_t index : added) {
+		isAdded[index] = true;
 	}
 
-	std::vector<DWORD> functionRVAs(exportDir.NumberOfFunctions);
-
-	if (!read(moduleBase + exportDir.AddressOfFunctions, functionRVAs.data(),
-		exportDir.NumberOfFunctions * sizeof(DWORD))) {
-		return exports;
+	std::vector<std::pair<uintptr_t, uintptr_t>> keptRanges;
+	std::unordered_set<std::string> keptNames;
+	std::vector<moduleInfo> addedModules;
+	for (size_t i = 0; i < modules.size(); i++) {
+		if (isAdded[i]) {
+			addedModules.push_back(modules[i]);
+			continue;
+		}
+		keptRanges.push_back({ modules[i].base, modules[i].base + modules[i].size });
+		keptNames.insert(lowerName(modules[i].name));
 	}
+	std::sort(keptRanges.begin(), keptRanges.end());
+
+	// an entry stays if the module it's listed under is still loaded and the address it points at still is
+	std::unordered_map<uint16_t, bool> keptModules;
+	auto kept = symbols.filtered([&](const symbolEntry& entry) {
+		auto module = keptModules.find(entry.module);
+		if (module == keptModules.end()) {
+			module = keptModules.emplace(entry.module, keptNames.count(lowerName(symbols.moduleOf(entry))) != 0).first;
+		}
 
-	std::vector<DWORD> nameRVAs(exportDir.NumberOfNames);
+		auto range = std::upper_bound(keptRanges.begin(), keptRanges.end(), std::pair<uintptr_t, uintptr_t>(entry.address, UINTPTR_MAX));
+		return module->second && range != keptRanges.begin() && entry.address < (range - 1)->second;
+	});
 
-	if (!read(moduleBase + exportDir.AddressOfNames, nameRVAs.data(),
-		exportDir.NumberOfNames * sizeof(DWORD))) {
-		return exports;
-	}
+	return buildSymbols(addedModules, nullptr, std::move(kept));
+}
 
-	std::vector<WORD> ordinals(exportDir.NumberOfNames);
+// symbols holds what is already known about other modules, the exports of these are added to it
+inline symbolTable mem::buildSymbols(const std::vector<moduleInfo>& modules, attachTimings* timings, symbolTable symbols)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	// every module is parsed on its own worker into its own slot, merging happens once they're all done. modules
+	// in the cache only keep their forwarders and ordinals here, their names go from the mapping straight into
+	// the table below without a string per export
+	std::vector<std::vector<funcExport>> moduleExports(modules.size());
+	std::vector<std::vector<std::pair<uint32_t, uintptr_t>>> cachedOrdinals(modules.size());
+	std::vector<std::pair<size_t, size_t>> cachedSizes(modules.size()); // exports and name bytes
+	std::vector<uint8_t> cachedModule(modules.size());
+	parallelFor(modules.size(), [&](size_t i) {
+		auto& module = modules[i];
+
+		bool cached = g_ModuleCache.visitExports(module.identity, [&](const cachedExportView& exp) {
+			if (!exp.forwarder.empty()) {
+				moduleExports[i].push_back({ std::string(exp.name), 0, exp.ordinal, std::string(exp.forwarder) });
+				return;
+			}
+			cachedOrdinals[i].push_back({ exp.ordinal, module.base + exp.rva });
+			cachedSizes[i].first++;
+			cachedSizes[i].second += exp.name.size();
+		});
+
+		if (cached) {
+			cachedModule[i] = true;
+			if (timings) {
+				timings->cachedModules++;
+			}
+			return;
+		}
 
-	if (!read(moduleBase + exportDir.AddressOfNameOrdinals, ordinals.data(),
-		exportDir.NumberOfNames * sizeof(WORD))) {
-		return exports;
-	}
+		moduleExports[i] = gatherRemoteExports(module.base);
 
+		if (module.identity.valid()) {
+			std::vector<cachedSection> sections;
+			for (auto& section : module.sections) {
+				cachedSection entry{ static_cast<uint32_t>(section.base - module.base), section.size };
+				memcpy(entry.name, section.name, 8);
+				entry.characteristics = section.characteristics;
+				sections.push_back(entry);
+			}
 
-	exports.reserve(exportDir.NumberOfNames);
+			std::vector<cachedExport> exports;
+			for (auto& exp : moduleExports[i]) {
+				uint32_t rva = exp.forwarder.empty() ? static_cast<uint32_t>(exp.address - module.base) : 0;
+				exports.push_back({ exp.name, rva, exp.ordinal, exp.forwarder });
+			}
 
-    // TODO: refactor this to use less individual read calls (most names end up in the same pages anyway...)
-	for (DWORD i = 0; i < exportDir.NumberOfNames; ++i) {
-		char nameBuffer[256] = { 0 };
-		DWORD nameRVA = nameRVAs[i];
+			g_ModuleCache.store(module.identity, std::move(sections), std::move(exports));
+		}
+	});
 
-        DWORD readSize = 255;
+	if (timings) {
+		timings->exports = msSince(start);
+	}
+	start = std::chrono::steady_clock::now();
+
+	size_t count = 0, nameBytes = 0;
+	for (size_t i = 0; i < modules.size(); i++) {
+		count += moduleExports[i].size() + cachedSizes[i].first;
+		nameBytes += cachedSizes[i].second;
+		for (auto& exp : moduleExports[i]) {
+			nameBytes += exp.name.size();
+		}
+	}
 
-        if (i + 1 < exportDir.NumberOfNames) {
-            DWORD nextNameRVA = nameRVAs[i + 1];
-            DWORD NameDelta = nextNameRVA - nameRVA;
-            if (NameDelta > 0 && NameDelta < 255)
-                readSize = NameDelta; // don't need to read more than this delta
-        }
+	symbols.reserve(count, nameBytes);
 
+	for (size_t i = 0; i < modules.size(); i++) {
+		uint16_t moduleIndex = symbols.addModule(modules[i].name);
 
-		if (!read(moduleBase + nameRVA, nameBuffer, readSize)) {
-			continue;
-		}
+		if (cachedModule[i]) {
+			bool visited = g_ModuleCache.visitExports(modules[i].identity, [&](const cachedExportView& exp) {
+				if (exp.forwarder.empty()) {
+					symbols.add(moduleIndex, exp.name, modules[i].base + exp.rva);
+				}
+			});
+			if (visited) {
+				continue;
+			}
 
-		std::string exportName = nameBuffer;
-		if (exportName.empty()) {
-			continue;
+			// a save from another thread can drop an entry once the cache is full, read it from the target after all
+			moduleExports[i] = gatherRemoteExports(modules[i].base);
 		}
 
-		WORD ordinal = ordinals[i];
-		if (ordinal >= exportDir.NumberOfFunctions) {
-			continue;
+		for (const auto& exp : moduleExports[i]) {
+			if (exp.forwarder.empty()) {
+				symbols.add(moduleIndex, exp.name, exp.address);
+			}
 		}
+	}
 
-		DWORD functionRVA = functionRVAs[ordinal];
-		if (functionRVA >= exportDirRVA && functionRVA < (exportDirRVA + exportDirSize)) {
-			continue;
-		}
+	symbols.finalize();
+	resolveForwarders(symbols, modules, moduleExports, cachedOrdinals);
 
-		uintptr_t functionAddress = moduleBase + functionRVA;
-		funcExport info;
-		info.name = exportName;
-		info.address = functionAddress;
-		exports.push_back(std::move(info));
-	}
+	g_ModuleCache.save();
 
-	return exports;
+	if (timings) {
+		timings->symbols = msSince(start);
+	}
+	return symbols;
 }
 
-inline void mem::gatherExports()
+// forwarders name their target as "module.export" without the extension, they can chain so this runs until
+// nothing new resolves. api set contracts (api-ms-win-*) aren't loaded modules and stay unresolved. modules from the
+// cache only list their forwarders in moduleExports, the ordinals of everything else are in cachedOrdinals
+inline void mem::resolveForwarders(symbolTable& symbols, const std::vector<moduleInfo>& modules, std::vector<std::vector<funcExport>>& moduleExports,
+	const std::vector<std::vector<std::pair<uint32_t, uintptr_t>>>& cachedOrdinals)
 {
-	g_ExportMap.clear();
+	std::vector<std::pair<size_t, funcExport*>> pending;
+	for (size_t i = 0; i < moduleExports.size(); i++) {
+		for (auto& exp : moduleExports[i]) {
+			if (!exp.forwarder.empty()) {
+				pending.push_back({ i, &exp });
+			}
+		}
+	}
 
-	for (auto& module : moduleList) {
-		char modulePath[MAX_PATH] = { 0 };
-		if (K32GetModuleFileNameExA(memHandle, reinterpret_cast<HMODULE>(module.base), modulePath, MAX_PATH)) {
-			auto exports = gatherRemoteExports(module.base);
+	for (int pass = 0; pass < FORWARDER_MAX_DEPTH && !pending.empty(); pass++) {
+		bool resolved = false;
 
-			for (const auto& exp : exports) {
-				g_ExportMap[exp.address] = module.name + "!" + exp.name;
+		for (auto& [i, forwarded] : pending) {
+			auto& exp = *forwarded;
+			if (exp.address) {
+				continue;
+			}
+
+			size_t dot = exp.forwarder.find('.');
+			if (dot == std::string::npos) {
+				continue;
+			}
+
+			std::string targetModule = exp.forwarder.substr(0, dot) + ".dll";
+			std::string targetName = exp.forwarder.substr(dot + 1);
+			uintptr_t address = symbols.lookup(targetModule, targetName).value_or(0);
+
+			// by ordinal, the target may well have a name for it so go through its exports instead
+			if (!address && targetName.size() > 1 && targetName[0] == '#') {
+				DWORD ordinal = strtoul(targetName.c_str() + 1, nullptr, 10);
+				for (size_t j = 0; j < modules.size() && !address; j++) {
+					if (_stricmp(modules[j].name.c_str(), targetModule.c_str()) != 0) {
+						continue;
+					}
+					for (auto& target : moduleExports[j]) {
+						if (target.ordinal == ordinal) {
+							address = target.address;
+							break;
+						}
+					}
+					for (size_t k = 0; k < cachedOrdinals[j].size() && !address; k++) {
+						if (cachedOrdinals[j][k].first == ordinal) {
+							address = cachedOrdinals[j][k].second;
+						}
+					}
+				}
+			}
+
+			if (address) {
+				exp.address = address;
+				symbols.add(symbols.addModule(modules[i].name), exp.name, address);
+				resolved = true;
 			}
 		}
+
+		if (!resolved) {
+			break;
+		}
+
+		symbols.finalize();
 	}
 }
 
 inline uintptr_t mem::getExport(const std::string& moduleName, const std::string& exportName)
 {
-	for (auto& module : moduleList) {
-		if (_stricmp(module.name.c_str(), moduleName.c_str()) == 0) {
-			for (auto& pair : g_ExportMap) {
-				std::string fullExport = module.name + "!" + exportName;
-				if (pair.second == fullExport) {
-					return pair.first;
-				}
-			}
-			return 0;
-		}
-	}
-	return 0;
+	return g_Symbols.lookup(moduleName, exportName).value_or(0);
 }
 
 inline bool mem::isProcessAlive()
 {
-	if (!memHandle || memHandle == INVALID_HANDLE_VALUE)
+	if (!g_Source)
         return false;
 
     auto curTime = std::chrono::steady_clock::now();
@@ -501,8 +979,7 @@ inline bool mem::isProcessAlive()
     
     lastCheck = curTime;
 
-    DWORD exitCode;
-	if (!GetExitCodeProcess(memHandle, &exitCode) || exitCode != STILL_ACTIVE) {
+	if (!g_Source->isAlive()) {
 		activeProcess = false;
 		return false;
 	}
@@ -513,28 +990,153 @@ inline bool mem::isProcessAlive()
 
 // used internally by ui::cleanDeadProcess
 inline void mem::cleanDeadProcess() {
-	if (memHandle && memHandle != INVALID_HANDLE_VALUE) {
-		CloseHandle(memHandle);
-		memHandle = nullptr;
-	}
+	g_Attach.stop();
+	g_ModulePoll.stop();
+	g_Source.reset();
 
 	moduleList.clear();
-	g_ExportMap.clear();
+	g_ModuleIndex.clear();
+	g_Symbols.clear();
+	g_Reader.setSource(nullptr); // first, its last pass may still be using the caches below
+	g_Cache.clear();
+	g_Regions.clear();
+	g_Rtti.clear();
+	g_RttiIndex.clear();
+	g_Instances.stop();
 	g_pid = 0;
 	activeProcess = false;
 }
 
 extern void initClasses(bool);
+// only the cheap part happens here, the node view is usable as soon as this returns. modules, their sections,
+// exports and the rtti index are filled in by g_Attach one stage after the other
+inline bool mem::attach(std::shared_ptr<memorySource> source) {
+    g_Attach.stop();
+    g_ModulePoll.stop();
+    g_Instances.stop();
+    g_RttiIndex.clear();
+
+    g_Reader.setSource(nullptr); // waits out a pass that still uses the old target's caches
+
+    g_Source = std::move(source);
+    g_Cache.clear();
+    g_Cache.enabled = !g_Source->isSnapshot();
+    g_Rtti.clear();
+    g_Regions.clear();
+    g_Reader.setSource(g_Source, describePreview);
+
+    moduleList.clear();
+    g_ModuleIndex.clear();
+    g_Symbols.clear();
+
+    g_AttachTimings.modules = g_AttachTimings.sections = g_AttachTimings.regions = 0;
+    g_AttachTimings.exports = g_AttachTimings.symbols = 0;
+    g_AttachTimings.threads = 0;
+    g_AttachTimings.cachedModules = 0;
+
+    // resolved vtables of a module that goes away could be reused by whatever gets mapped there next
+    [[maybe_unused]] static bool rttiListener = (onModuleEvent([](const moduleEvent& event) {
+        if (event.type == module_unloaded) {
+            g_Rtti.invalidate(event.base, event.base + event.size);
+        }
+    }), true);
+
+    initClasses(g_Source->is32Bit());
+
+    // stages fill in their own module list, the ui gets a copy of it each time one finishes
+    auto modules = std::make_shared<std::vector<moduleInfo>>();
+    auto timings = std::make_shared<attachTimings>();
+    auto target = g_Source;
+
+
+    g_Attach.start({
+        { "modules", [=](const std::atomic<bool>&) -> stagedPipeline::publishFn {
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<sourceModule> loaded;
+            target->getModules(loaded);
+            for (auto& module : loaded) {
+                moduleInfo info;
+                info.name = module.name;
+                info.base = module.base;
+                info.size = static_cast<DWORD>(module.size);
+                modules->push_back(std::move(info));
+            }
+
+            // module names show up on pointers right away, sections follow
+            timings->modules = msSince(start);
+            start = std::chrono::steady_clock::now();
+            buildRegionIndex(*modules);
+            timings->regions = msSince(start);
+
+            return [=, snapshot = std::make_shared<std::vector<moduleInfo>>(*modules)]() {
+                moduleList = std::move(*snapshot);
+                rebuildModuleIndex();
+                g_AttachTimings.modules = timings->modules;
+                g_AttachTimings.regions = timings->regions;
+            };
+        } },
+        { "sections", [=](const std::atomic<bool>& cancel) -> stagedPipeline::publishFn {
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<size_t> all(modules->size());
+            std::iota(all.begin(), all.end(), 0);
+            loadModuleHeaders(*modules, all);
+
+            timings->sections = msSince(start);
+            timings->threads = workerCount(all.size());
+            if (cancel) {
+                return nullptr;
+            }
+            buildRegionIndex(*modules);
+
+            return [=, snapshot = std::make_shared<std::vector<moduleInfo>>(*modules)]() {
+                moduleList = std::move(*snapshot);
+                rebuildModuleIndex();
+                g_AttachTimings.sections = timings->sections;
+                g_AttachTimings.threads = timings->threads;
+            };
+        } },
+        { "exports", [=](const std::atomic<bool>& cancel) -> stagedPipeline::publishFn {
+            if (cancel) {
+                return nullptr;
+            }
+
+            auto symbols = std::make_shared<symbolTable>(buildSymbols(*modules, timings.get()));
+
+            return [=]() {
+                g_Symbols = std::move(*symbols);
+                g_AttachTimings.exports = timings->exports;
+                g_AttachTimings.symbols = timings->symbols;
+                g_AttachTimings.cachedModules = timings->cachedModules.load();
+
+                // the index has its own worker and progress
+                indexRtti();
+            };
+        } },
+    });
+
+    return true;
+}
+
 inline bool mem::initProcess(DWORD pid) {
+    auto source = std::make_shared<winProcessSource>(pid);
+    if (!source->valid()) {
+        return false;
+    }
+
     mem::g_pid = pid;
-    if (openHandle(pid)) {
-        getModules();
-        bool newX32 = isX32(memHandle);
-        initClasses(newX32);
-        gatherExports();
-        return true;
+    return attach(source);
+}
+
+inline bool mem::openDump(const std::string& path) {
+    auto source = std::make_shared<dumpSource>(path);
+    if (!source->valid()) {
+        return false;
     }
-    return false;
+
+    mem::g_pid = 0;
+    return attach(source);
 }
 
 template <typename T>
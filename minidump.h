@@ -0,0 +1,362 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+#include "source.h"
+
+// crash dumps are opened as a read only memorySource, the file is mapped and never copied so only the
+// pages actually looked at get touched, which keeps opening multi gigabyte dumps instant
+
+// https://learn.microsoft.com/en-us/windows/win32/api/minidumpapiset/ (the sdk headers aren't used so this
+// builds without dbghelp on any platform)
+#pragma pack(push, 4)
+struct dumpLocation {
+    uint32_t dataSize;
+    uint32_t rva;
+};
+
+struct dumpHeader {
+    uint32_t signature;
+    uint32_t version;
+    uint32_t numberOfStreams;
+    uint32_t streamDirectoryRva;
+    uint32_t checkSum;
+    uint32_t timeDateStamp;
+    uint64_t flags;
+};
+
+struct dumpDirectory {
+    uint32_t streamType;
+    dumpLocation location;
+};
+
+struct dumpModule {
+    uint64_t baseOfImage;
+    uint32_t sizeOfImage;
+    uint32_t checkSum;
+    uint32_t timeDateStamp;
+    uint32_t moduleNameRva;
+    uint32_t versionInfo[13];
+    dumpLocation cvRecord;
+    dumpLocation miscRecord;
+    uint64_t reserved0;
+    uint64_t reserved1;
+};
+
+struct dumpMemoryDescriptor {
+    uint64_t startOfMemoryRange;
+    dumpLocation memory;
+};
+
+struct dumpMemoryDescriptor64 {
+    uint64_t startOfMemoryRange;
+    uint64_t dataSize;
+};
+
+struct dumpMemoryInfoHeader {
+    uint32_t sizeOfHeader;
+    uint32_t sizeOfEntry;
+    uint64_t numberOfEntries;
+};
+
+struct dumpMemoryInfo {
+    uint64_t baseAddress;
+    uint64_t allocationBase;
+    uint32_t allocationProtect;
+    uint32_t alignment1;
+    uint64_t regionSize;
+    uint32_t state;
+    uint32_t protect;
+    uint32_t type;
+    uint32_t alignment2;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(dumpModule) == 108, "MINIDUMP_MODULE layout");
+static_assert(sizeof(dumpMemoryInfo) == 48, "MINIDUMP_MEMORY_INFO layout");
+
+inline constexpr uint32_t DUMP_SIGNATURE = 0x504D444D; // "MDMP"
+inline constexpr uint32_t DUMP_MODULE_LIST_STREAM = 4;
+inline constexpr uint32_t DUMP_MEMORY_LIST_STREAM = 5;
+inline constexpr uint32_t DUMP_SYSTEM_INFO_STREAM = 7;
+inline constexpr uint32_t DUMP_MEMORY64_LIST_STREAM = 9;
+inline constexpr uint32_t DUMP_MEMORY_INFO_LIST_STREAM = 16;
+inline constexpr uint16_t DUMP_ARCH_X86 = 0;
+
+class dumpSource : public memorySource {
+public:
+    dumpSource(const std::string& path);
+
+    bool valid() const { return data != nullptr; }
+
+    bool read(uintptr_t address, void* buf, uintptr_t size) override;
+    bool write(uintptr_t /*address*/, const void* /*buf*/, uintptr_t /*size*/) override { return false; }
+    const uint8_t* view(uintptr_t address, uintptr_t size) override;
+    bool queryRegion(uintptr_t address, memoryRegion* region) override;
+    bool getRegions(std::vector<memoryRegion>& regions) override;
+    bool getModules(std::vector<sourceModule>& modules) override;
+    bool isAlive() override { return valid(); }
+    bool is32Bit() override { return x32; }
+    bool isSnapshot() override { return true; }
+
+private:
+    struct memoryRange {
+        uintptr_t start;
+        uintptr_t size;
+        uint64_t offset; // into the file
+    };
+
+    const uint8_t* data = nullptr;
+    uint64_t fileSize = 0;
+    bool x32 = false;
+
+    std::vector<memoryRange> ranges; // sorted by start
+    std::vector<memoryRegion> regions; // from the memory info stream, sorted by base
+    std::vector<sourceModule> modules;
+
+    mappedFile file;
+
+    bool parse();
+    const memoryRange* findRange(uintptr_t address) const;
+
+    template <typename T>
+    const T* at(uint64_t rva, uint64_t count = 1) const {
+        if (rva > fileSize || count > (fileSize - rva) / sizeof(T)) {
+            return nullptr;
+        }
+        return reinterpret_cast<const T*>(data + rva);
+    }
+};
+
+inline dumpSource::dumpSource(const std::string& path) {
+    if (file.open(path)) {
+        data = file.data();
+        fileSize = file.size();
+    }
+
+    if (data && !parse()) {
+        file.close();
+        data = nullptr;
+    }
+}
+
+// only the stream directory and the small metadata streams are touched here, the memory itself stays
+// on disk until something reads it
+inline bool dumpSource::parse() {
+    auto header = at<dumpHeader>(0);
+    if (!header || header->signature != DUMP_SIGNATURE) {
+        return false;
+    }
+
+    auto directory = at<dumpDirectory>(header->streamDirectoryRva, header->numberOfStreams);
+    if (!directory) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->numberOfStreams; i++) {
+        const dumpLocation& location = directory[i].location;
+
+        // a stream reaching past the end of the file means the directory itself is damaged
+        if (!at<uint8_t>(location.rva, location.dataSize)) {
+            return false;
+        }
+
+        switch (directory[i].streamType) {
+        case DUMP_MODULE_LIST_STREAM:
+        {
+            auto count = at<uint32_t>(location.rva);
+            auto list = count ? at<dumpModule>(location.rva + sizeof(uint32_t), *count) : nullptr;
+            if (!list) {
+                break;
+            }
+
+            for (uint32_t j = 0; j < *count; j++) {
+                auto length = at<uint32_t>(list[j].moduleNameRva);
+                auto name = length ? at<char16_t>(list[j].moduleNameRva + sizeof(uint32_t), *length / sizeof(char16_t)) : nullptr;
+
+                // full path in utf16, only the file name is kept to match what the loader list gives us
+                std::string moduleName;
+                for (uint32_t k = 0; name && k < *length / sizeof(char16_t); k++) {
+                    moduleName += static_cast<char>(name[k]);
+                }
+                moduleName = moduleName.substr(moduleName.find_last_of("\\/") + 1);
+
+                modules.push_back({ moduleName, static_cast<uintptr_t>(list[j].baseOfImage), list[j].sizeOfImage });
+            }
+            break;
+        }
+        case DUMP_MEMORY_LIST_STREAM:
+        {
+            auto count = at<uint32_t>(location.rva);
+            auto list = count ? at<dumpMemoryDescriptor>(location.rva + sizeof(uint32_t), *count) : nullptr;
+            for (uint32_t j = 0; list && j < *count; j++) {
+                if (at<uint8_t>(list[j].memory.rva, list[j].memory.dataSize)) {
+                    ranges.push_back({ static_cast<uintptr_t>(list[j].startOfMemoryRange), list[j].memory.dataSize, list[j].memory.rva });
+                }
+            }
+            break;
+        }
+        case DUMP_MEMORY64_LIST_STREAM:
+        {
+            auto count = at<uint64_t>(location.rva);
+            auto baseRva = at<uint64_t>(location.rva + sizeof(uint64_t));
+            auto list = (count && baseRva) ? at<dumpMemoryDescriptor64>(location.rva + 2 * sizeof(uint64_t), *count) : nullptr;
+
+            // full memory dumps store every range back to back starting at baseRva
+            uint64_t offset = list ? *baseRva : 0;
+            for (uint64_t j = 0; list && j < *count; j++) {
+                if (!at<uint8_t>(offset, list[j].dataSize)) {
+                    break;
+                }
+                ranges.push_back({ static_cast<uintptr_t>(list[j].startOfMemoryRange), static_cast<uintptr_t>(list[j].dataSize), offset });
+                offset += list[j].dataSize;
+            }
+            break;
+        }
+        case DUMP_MEMORY_INFO_LIST_STREAM:
+        {
+            auto infoHeader = at<dumpMemoryInfoHeader>(location.rva);
+            if (!infoHeader || infoHeader->sizeOfEntry < sizeof(dumpMemoryInfo)) {
+                break;
+            }
+
+            for (uint64_t j = 0; j < infoHeader->numberOfEntries; j++) {
+                auto info = at<dumpMemoryInfo>(location.rva + infoHeader->sizeOfHeader + j * infoHeader->sizeOfEntry);
+                if (!info) {
+                    break;
+                }
+
+                memoryRegion region;
+                region.base = static_cast<uintptr_t>(info->baseAddress);
+                region.size = static_cast<uintptr_t>(info->regionSize);
+                region.committed = (info->state == WIN_MEM_COMMIT);
+                region.type = fromWinType(info->type);
+                region.protect = region.committed ? fromWinProtect(info->protect) : protect_none;
+                regions.push_back(region);
+            }
+            break;
+        }
+        case DUMP_SYSTEM_INFO_STREAM:
+        {
+            auto architecture = at<uint16_t>(location.rva);
+            x32 = architecture && *architecture == DUMP_ARCH_X86;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+    std::sort(ranges.begin(), ranges.end(), [](const memoryRange& a, const memoryRange& b) { return a.start < b.start; });
+    std::sort(regions.begin(), regions.end(), [](const memoryRegion& a, const memoryRegion& b) { return a.base < b.base; });
+    std::sort(modules.begin(), modules.end(), [](const sourceModule& a, const sourceModule& b) { return a.base < b.base; });
+
+    return !ranges.empty();
+}
+
+inline const dumpSource::memoryRange* dumpSource::findRange(uintptr_t address) const {
+    auto it = std::upper_bound(ranges.begin(), ranges.end(), address, [](uintptr_t value, const memoryRange& range) {
+        return value < range.start;
+    });
+
+    if (it == ranges.begin()) {
+        return nullptr;
+    }
+
+    --it;
+    if (address - it->start >= it->size) {
+        return nullptr;
+    }
+
+    return &*it;
+}
+
+inline const uint8_t* dumpSource::view(uintptr_t address, uintptr_t size) {
+    auto range = findRange(address);
+    if (!range || size > range->size - (address - range->start)) {
+        return nullptr;
+    }
+
+    return data + range->offset + (address - range->start);
+}
+
+// a read may straddle several captured ranges as long as they are contiguous in the target
+inline bool dumpSource::read(uintptr_t address, void* buf, uintptr_t size) {
+    auto out = static_cast<uint8_t*>(buf);
+
+    while (size > 0) {
+        auto range = findRange(address);
+        if (!range) {
+            return false;
+        }
+
+        uintptr_t offset = address - range->start;
+        uintptr_t chunk = (std::min)(size, range->size - offset);
+        memcpy(out, data + range->offset + offset, chunk);
+
+        out += chunk;
+        address += chunk;
+        size -= chunk;
+    }
+
+    return true;
+}
+
+inline bool dumpSource::queryRegion(uintptr_t address, memoryRegion* region) {
+    if (!regions.empty()) {
+        auto it = std::upper_bound(regions.begin(), regions.end(), address, [](uintptr_t value, const memoryRegion& entry) {
+            return value < entry.base;
+        });
+
+        if (it != regions.begin() && address - (it - 1)->base < (it - 1)->size) {
+            *region = *(it - 1);
+            return true;
+        }
+    }
+
+    // no memory info stream (or the address isn't in it), all we know is whether the dump has the bytes
+    auto range = findRange(address);
+    if (range) {
+        region->base = range->start;
+        region->size = range->size;
+        region->protect = protect_read;
+        region->type = region_private;
+        region->committed = true;
+        return true;
+    }
+
+    region->base = address & ~static_cast<uintptr_t>(0xFFF);
+    region->size = 0x1000;
+    region->protect = protect_none;
+    region->type = region_free;
+    region->committed = false;
+    return true;
+}
+
+inline bool dumpSource::getRegions(std::vector<memoryRegion>& out) {
+    out.clear();
+
+    if (!regions.empty()) {
+        for (auto& region : regions) {
+            if (region.type != region_free) {
+                out.push_back(region);
+            }
+        }
+        return true;
+    }
+
+    for (auto& range : ranges) {
+        out.push_back({ range.start, range.size, protect_read, region_private, true });
+    }
+    return !out.empty();
+}
+
+inline bool dumpSource::getModules(std::vector<sourceModule>& out) {
+    out = modules;
+    return !out.empty();
+}
@@ -0,0 +1,374 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "mappedfile.h"
+
+// parsed sections and exports of every module seen before, keyed by what identifies a build of an image.
+// system dlls don't change between sessions, so a warm attach maps one file and only rebases rvas instead of
+// reading and parsing every header and export directory again
+
+struct moduleIdentity {
+    std::string name; // lowercase, empty when the module isn't a pe image
+    uint32_t timeDateStamp = 0;
+    uint32_t sizeOfImage = 0;
+    uint64_t headerHash = 0; // of the section table, catches rebuilds that kept the timestamp
+
+    bool valid() const { return !name.empty(); }
+    uint64_t key() const;
+};
+
+struct cachedSection {
+    uint32_t rva;
+    uint32_t size;
+    char name[8];
+    uint32_t characteristics;
+};
+
+struct cachedExport {
+    std::string name;
+    uint32_t rva; // 0 for forwarders
+    uint32_t ordinal;
+    std::string forwarder;
+};
+
+// an export as it sits in the mapping, the strings point into the file
+struct cachedExportView {
+    std::string_view name;
+    uint32_t rva;
+    uint32_t ordinal;
+    std::string_view forwarder;
+};
+
+inline uint64_t fnv1a(const void* data, size_t size, uint64_t seed = 0xcbf29ce484222325ull) {
+    auto bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        seed ^= bytes[i];
+        seed *= 0x100000001b3ull;
+    }
+    return seed;
+}
+
+inline uint64_t moduleIdentity::key() const {
+    uint64_t result = fnv1a(name.data(), name.size());
+    result = fnv1a(&timeDateStamp, sizeof(timeDateStamp), result);
+    result = fnv1a(&sizeOfImage, sizeof(sizeOfImage), result);
+    return fnv1a(&headerHash, sizeof(headerHash), result);
+}
+
+class moduleCache {
+public:
+    static constexpr uint32_t MAGIC = 0x4D434D49; // "IMCM"
+    static constexpr uint32_t VERSION = 2;
+    static constexpr size_t MAX_MODULES = 4096;
+
+    bool open(const std::string& path);
+    bool isOpen() const { return file.isOpen(); }
+
+    // lookups hold the mapping shared and save() remaps it exclusively, so they're safe from any number of
+    // threads, also while another one saves
+    bool loadSections(const moduleIdentity& identity, std::vector<cachedSection>& out) const;
+
+    // fn(const cachedExportView&) for every export of the module, nothing is copied. the views are only valid
+    // during the call, a warm attach interns the names from them straight into the symbol table
+    template <typename Fn>
+    bool visitExports(const moduleIdentity& identity, Fn&& fn) const;
+
+    void store(const moduleIdentity& identity, std::vector<cachedSection> sections, std::vector<cachedExport> exports);
+    bool save(); // writes everything stored since open next to the old entries, then maps the result
+
+private:
+#pragma pack(push, 4)
+    struct fileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t moduleCount;
+        uint32_t sectionCount;
+        uint32_t exportCount;
+        uint32_t stringsSize;
+    };
+
+    struct fileModule {
+        uint64_t key;
+        uint64_t headerHash;
+        uint32_t timeDateStamp;
+        uint32_t sizeOfImage;
+        uint32_t nameOffset;
+        uint32_t nameLength;
+        uint32_t firstSection;
+        uint32_t sectionCount;
+        uint32_t firstExport;
+        uint32_t exportCount;
+    };
+
+    struct fileExport {
+        uint32_t rva;
+        uint32_t ordinal;
+        uint32_t nameOffset;
+        uint32_t forwarderOffset;
+        uint16_t nameLength;
+        uint16_t forwarderLength;
+    };
+#pragma pack(pop)
+
+    struct pendingModule {
+        moduleIdentity identity;
+        std::vector<cachedSection> sections;
+        std::vector<cachedExport> exports;
+    };
+
+    std::string path;
+    mappedFile file;
+
+    // views into the mapping, set up by validate()
+    const fileHeader* header = nullptr;
+    const fileModule* modules = nullptr; // sorted by key
+    const cachedSection* sections = nullptr;
+    const fileExport* exports = nullptr;
+    const char* strings = nullptr;
+
+    mutable std::shared_mutex mappingMutex; // guards the mapping and the views into it
+    std::mutex mutex; // guards pending, taken before mappingMutex
+    std::unordered_map<uint64_t, pendingModule> pending;
+
+    bool validate();
+    const fileModule* find(const moduleIdentity& identity) const;
+    std::string_view stringAt(uint32_t offset, uint32_t length) const { return std::string_view(strings + offset, length); }
+};
+
+inline bool moduleCache::open(const std::string& cachePath) {
+    std::lock_guard lock(mutex);
+    std::unique_lock mapping(mappingMutex);
+    path = cachePath;
+    header = nullptr;
+
+    if (!file.open(path)) {
+        return false;
+    }
+
+    if (!validate()) {
+        file.close();
+        header = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+// everything is bounds checked once here so lookups can trust the offsets
+inline bool moduleCache::validate() {
+    uint64_t size = file.size();
+    if (size < sizeof(fileHeader)) {
+        return false;
+    }
+
+    auto candidate = reinterpret_cast<const fileHeader*>(file.data());
+    if (candidate->magic != MAGIC || candidate->version != VERSION) {
+        return false;
+    }
+
+    uint64_t modulesOffset = sizeof(fileHeader);
+    uint64_t sectionsOffset = modulesOffset + uint64_t(candidate->moduleCount) * sizeof(fileModule);
+    uint64_t exportsOffset = sectionsOffset + uint64_t(candidate->sectionCount) * sizeof(cachedSection);
+    uint64_t stringsOffset = exportsOffset + uint64_t(candidate->exportCount) * sizeof(fileExport);
+    if (stringsOffset + candidate->stringsSize > size) {
+        return false;
+    }
+
+    auto moduleTable = reinterpret_cast<const fileModule*>(file.data() + modulesOffset);
+    auto exportTable = reinterpret_cast<const fileExport*>(file.data() + exportsOffset);
+
+    for (uint32_t i = 0; i < candidate->moduleCount; i++) {
+        auto& module = moduleTable[i];
+        if (uint64_t(module.firstSection) + module.sectionCount > candidate->sectionCount ||
+            uint64_t(module.firstExport) + module.exportCount > candidate->exportCount ||
+            uint64_t(module.nameOffset) + module.nameLength > candidate->stringsSize ||
+            (i > 0 && moduleTable[i - 1].key > module.key)) {
+            return false;
+        }
+    }
+
+    for (uint32_t i = 0; i < candidate->exportCount; i++) {
+        auto& entry = exportTable[i];
+        if (uint64_t(entry.nameOffset) + entry.nameLength > candidate->stringsSize ||
+            uint64_t(entry.forwarderOffset) + entry.forwarderLength > candidate->stringsSize) {
+            return false;
+        }
+    }
+
+    header = candidate;
+    modules = moduleTable;
+    sections = reinterpret_cast<const cachedSection*>(file.data() + sectionsOffset);
+    exports = exportTable;
+    strings = reinterpret_cast<const char*>(file.data() + stringsOffset);
+    return true;
+}
+
+inline const moduleCache::fileModule* moduleCache::find(const moduleIdentity& identity) const {
+    if (!header || !identity.valid()) {
+        return nullptr;
+    }
+
+    uint64_t key = identity.key();
+    auto end = modules + header->moduleCount;
+    auto it = std::lower_bound(modules, end, key, [](const fileModule& module, uint64_t value) { return module.key < value; });
+
+    for (; it != end && it->key == key; ++it) {
+        if (it->timeDateStamp == identity.timeDateStamp && it->sizeOfImage == identity.sizeOfImage &&
+            it->headerHash == identity.headerHash && stringAt(it->nameOffset, it->nameLength) == identity.name) {
+            return it;
+        }
+    }
+
+    return nullptr;
+}
+
+inline bool moduleCache::loadSections(const moduleIdentity& identity, std::vector<cachedSection>& out) const {
+    std::shared_lock mapping(mappingMutex);
+    auto module = find(identity);
+    if (!module) {
+        return false;
+    }
+
+    out.assign(sections + module->firstSection, sections + module->firstSection + module->sectionCount);
+    return true;
+}
+
+template <typename Fn>
+inline bool moduleCache::visitExports(const moduleIdentity& identity, Fn&& fn) const {
+    std::shared_lock mapping(mappingMutex);
+    auto module = find(identity);
+    if (!module) {
+        return false;
+    }
+
+    for (uint32_t i = module->firstExport; i < module->firstExport + module->exportCount; i++) {
+        auto& entry = exports[i];
+        fn(cachedExportView{ stringAt(entry.nameOffset, entry.nameLength), entry.rva, entry.ordinal,
+            stringAt(entry.forwarderOffset, entry.forwarderLength) });
+    }
+    return true;
+}
+
+inline void moduleCache::store(const moduleIdentity& identity, std::vector<cachedSection> moduleSections, std::vector<cachedExport> moduleExports) {
+    if (!identity.valid()) {
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+    pending[identity.key()] = { identity, std::move(moduleSections), std::move(moduleExports) };
+}
+
+inline bool moduleCache::save() {
+    std::lock_guard lock(mutex);
+    if (pending.empty() || path.empty()) {
+        return false;
+    }
+
+    std::vector<fileModule> outModules;
+    std::vector<cachedSection> outSections;
+    std::vector<fileExport> outExports;
+    std::string outStrings;
+
+    auto addString = [&](std::string_view str, uint32_t& offset, auto& length) {
+        offset = static_cast<uint32_t>(outStrings.size());
+        length = static_cast<std::remove_reference_t<decltype(length)>>(str.size());
+        outStrings.append(str.substr(0, length));
+    };
+
+    for (auto& [key, module] : pending) {
+        fileModule entry{};
+        entry.key = key;
+        entry.headerHash = module.identity.headerHash;
+        entry.timeDateStamp = module.identity.timeDateStamp;
+        entry.sizeOfImage = module.identity.sizeOfImage;
+        addString(module.identity.name, entry.nameOffset, entry.nameLength);
+
+        entry.firstSection = static_cast<uint32_t>(outSections.size());
+        entry.sectionCount = static_cast<uint32_t>(module.sections.size());
+        outSections.insert(outSections.end(), module.sections.begin(), module.sections.end());
+
+        entry.firstExport = static_cast<uint32_t>(outExports.size());
+        entry.exportCount = static_cast<uint32_t>(module.exports.size());
+        for (auto& exp : module.exports) {
+            fileExport out{};
+            out.rva = exp.rva;
+            out.ordinal = exp.ordinal;
+            addString(exp.name, out.nameOffset, out.nameLength);
+            addString(exp.forwarder, out.forwarderOffset, out.forwarderLength);
+            outExports.push_back(out);
+        }
+
+        outModules.push_back(entry);
+    }
+
+    // old entries are carried over as long as they weren't replaced and there's room
+    for (uint32_t i = 0; header && i < header->moduleCount && outModules.size() < MAX_MODULES; i++) {
+        auto& module = modules[i];
+        if (pending.count(module.key)) {
+            continue;
+        }
+
+        fileModule entry = module;
+        addString(stringAt(module.nameOffset, module.nameLength), entry.nameOffset, entry.nameLength);
+
+        entry.firstSection = static_cast<uint32_t>(outSections.size());
+        outSections.insert(outSections.end(), sections + module.firstSection, sections + module.firstSection + module.sectionCount);
+
+        entry.firstExport = static_cast<uint32_t>(outExports.size());
+        for (uint32_t j = module.firstExport; j < module.firstExport + module.exportCount; j++) {
+            fileExport out = exports[j];
+            addString(stringAt(exports[j].nameOffset, exports[j].nameLength), out.nameOffset, out.nameLength);
+            addString(stringAt(exports[j].forwarderOffset, exports[j].forwarderLength), out.forwarderOffset, out.forwarderLength);
+            outExports.push_back(out);
+        }
+
+        outModules.push_back(entry);
+    }
+
+    std::sort(outModules.begin(), outModules.end(), [](const fileModule& a, const fileModule& b) { return a.key < b.key; });
+
+    fileHeader outHeader{ MAGIC, VERSION, static_cast<uint32_t>(outModules.size()), static_cast<uint32_t>(outSections.size()),
+        static_cast<uint32_t>(outExports.size()), static_cast<uint32_t>(outStrings.size()) };
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&outHeader), sizeof(outHeader));
+        out.write(reinterpret_cast<const char*>(outModules.data()), outModules.size() * sizeof(fileModule));
+        out.write(reinterpret_cast<const char*>(outSections.data()), outSections.size() * sizeof(cachedSection));
+        out.write(reinterpret_cast<const char*>(outExports.data()), outExports.size() * sizeof(fileExport));
+        out.write(outStrings.data(), outStrings.size());
+        if (!out) {
+            return false;
+        }
+    }
+
+    // windows won't replace a file that is still mapped. readers wait here rather than see the mapping go away
+    std::unique_lock mapping(mappingMutex);
+    file.close();
+    header = nullptr;
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    pending.clear();
+
+    if (!file.open(path) || !validate()) {
+        file.close();
+        header = nullptr;
+        return false;
+    }
+
+    return !error;
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// attach time work is a list of independent per-module jobs. every job only writes its own slot of a result
+// vector, so workers just pull the next index off a shared counter and nothing has to be locked
+
+inline unsigned workerCount(size_t jobs) {
+    unsigned cores = std::thread::hardware_concurrency();
+    if (cores == 0) {
+        cores = 4;
+    }
+
+    return static_cast<unsigned>((std::min)(jobs, static_cast<size_t>(cores)));
+}
+
+template <typename Fn>
+inline void parallelFor(size_t count, Fn&& fn, unsigned threads = 0) {
+    if (threads == 0) {
+        threads = workerCount(count);
+    }
+
+    if (threads <= 1) {
+        for (size_t i = 0; i < count; i++) {
+            fn(i);
+        }
+        return;
+    }
+
+    std::atomic<size_t> next = 0;
+    auto worker = [&]() {
+        for (size_t i = next++; i < count; i = next++) {
+            fn(i);
+        }
+    };
+
+    // the calling thread works too instead of just waiting
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+
+    worker();
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+// scratch buffers for chunked scans. a pool only ever holds as many buffers as were in use at once, so memory
+// stays at workers * chunk size however much gets streamed through it
+class bufferPool {
+public:
+    std::vector<uint8_t> acquire(size_t size);
+    void release(std::vector<uint8_t> buffer);
+
+private:
+    std::mutex mutex;
+    std::vector<std::vector<uint8_t>> available;
+};
+
+inline std::vector<uint8_t> bufferPool::acquire(size_t size) {
+    std::vector<uint8_t> buffer;
+    {
+        std::lock_guard lock(mutex);
+        if (!available.empty()) {
+            buffer = std::move(available.back());
+            available.pop_back();
+        }
+    }
+
+    buffer.resize(size);
+    return buffer;
+}
+
+inline void bufferPool::release(std::vector<uint8_t> buffer) {
+    std::lock_guard lock(mutex);
+    available.push_back(std::move(buffer));
+}
+
+// runs fn(worker) on that many threads, the calling thread being worker 0
+template <typename Fn>
+inline void runWorkers(unsigned threads, Fn&& fn) {
+    std::vector<std::thread> pool;
+    pool.reserve(threads > 1 ? threads - 1 : 0);
+    for (unsigned i = 1; i < threads; i++) {
+        pool.emplace_back([&fn, i]() { fn(i); });
+    }
+
+    fn(0u);
+
+    for (auto& thread : pool) {
+        thread.join();
+    }
+}
+
+// scans want every worker walking memory in address order, so instead of handing out single indices each worker
+// starts with its own contiguous block. one that runs dry steals the back half of whichever block has the most
+// left, a few slow pages in one part of a module don't leave the others idle
+class rangeStealer {
+public:
+    rangeStealer(size_t count, unsigned workers);
+
+    bool next(unsigned worker, size_t& index);
+
+private:
+    struct range {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    std::vector<std::unique_ptr<range>> ranges;
+};
+
+inline rangeStealer::rangeStealer(size_t count, unsigned workers) {
+    workers = (std::max)(workers, 1u);
+    for (unsigned i = 0; i < workers; i++) {
+        auto block = std::make_unique<range>();
+        block->begin = count * i / workers;
+        block->end = count * (i + 1) / workers;
+        ranges.push_back(std::move(block));
+    }
+}
+
+inline bool rangeStealer::next(unsigned worker, size_t& index) {
+    auto& own = *ranges[worker];
+    {
+        std::lock_guard lock(own.mutex);
+        if (own.begin < own.end) {
+            index = own.begin++;
+            return true;
+        }
+    }
+
+    while (true) {
+        range* victim = nullptr;
+        size_t most = 0;
+        for (auto& block : ranges) {
+            std::lock_guard lock(block->mutex);
+            if (block->end - block->begin > most) {
+                most = block->end - block->begin;
+                victim = block.get();
+            }
+        }
+
+        if (!victim) {
+            return false;
+        }
+
+        size_t begin, end;
+        {
+            std::lock_guard lock(victim->mutex);
+            if (victim->begin >= victim->end) {
+                continue; // someone else got there first
+            }
+            end = victim->end;
+            begin = victim->begin + (victim->end - victim->begin) / 2;
+            victim->end = begin;
+        }
+
+        // items are only in a block until they're started, so a block with one left is taken whole
+        std::lock_guard lock(own.mutex);
+        own.begin = begin + 1;
+        own.end = end;
+        index = begin;
+        return true;
+    }
+}
+
+// hands items from a producer to a consumer thread, push blocks while the queue is full
+template <typename T>
+class boundedQueue {
+public:
+    explicit boundedQueue(size_t capacity) : capacity((std::max)(capacity, size_t(1))) {}
+
+    void push(T item);
+    bool pop(T& item); // false once the queue is closed and empty
+    void close();
+
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<T> items;
+    size_t capacity;
+    bool closed = false;
+};
+
+template <typename T>
+inline void boundedQueue<T>::push(T item) {
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [this]() { return items.size() < capacity; });
+    items.push_back(std::move(item));
+    changed.notify_all();
+}
+
+template <typename T>
+inline bool boundedQueue<T>::pop(T& item) {
+    std::unique_lock lock(mutex);
+    changed.wait(lock, [this]() { return !items.empty() || closed; });
+    if (items.empty()) {
+        return false;
+    }
+    item = std::move(items.front());
+    items.pop_front();
+    changed.notify_all();
+    return true;
+}
+
+template <typename T>
+inline void boundedQueue<T>::close() {
+    std::lock_guard lock(mutex);
+    closed = true;
+    changed.notify_all();
+}
@@ -86,9 +86,8 @@ inline uintptr_t addressParser::parseInput(const char* str) {
 
 			for (const std::string& ending : g_fileEndings) {
 				if (curToken.find(ending) != std::string::npos) {
-					std::wstring token(curToken.begin(), curToken.end());
 					moduleInfo info;
-					if (mem::getModuleInfo(mem::g_pid, token.c_str(), &info)) {
+					if (mem::getModuleInfo(curToken, &info)) {
 						value = info.base;
 						isModule = true;
 					}
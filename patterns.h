@@ -1,249 +1,636 @@
 #pragma once
 
-#include <ios>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <mutex>
 #include <optional>
-#include <regex>
 #include <string>
+#include <string_view>
+#include <thread>
 
 #include "memory.h"
+#include "matcher.h"
+#include "sigcache.h"
+#include "sigparse.h"
+#include "siggen.h"
+#include "strscan.h"
+
+enum class ScanScope {
+	MODULE,
+	ALL_MODULES,
+	PRIVATE_MEMORY, // heaps, stacks, jit code, anything committed that isn't an image or a mapped file
+	RANGE
+};
 
+// which sections of a module are scanned, told apart by their characteristics so renamed sections still count
+enum class SectionFilter {
+	ANY, // the whole image, headers included
+	CODE,
+	DATA
+};
 
-enum class PatternType {
-	IDA_SIGNATURE,
-	BYTE_PATTERN,
-	UNKNOWN
+struct ScanTarget {
+	ScanScope scope = ScanScope::MODULE;
+	SectionFilter sections = SectionFilter::CODE; // module scopes only, signatures are for code unless asked otherwise
+	std::string module;
+	uintptr_t start = 0; // RANGE only, end exclusive
+	uintptr_t end = 0;
+	uint32_t protect = protect_read; // regionProtect flags a region needs to be scanned
 };
 
 struct PatternScanResult {
 	std::vector<uintptr_t> matches; // include multiple matches to allow for user selection
+	std::vector<std::string> labels; // per match, string scans label each with its encoding
 };
 
-class PatternInfo {
-public:
-	PatternType type;
-	std::string pattern; // always trimmed on creation to not have whitespace
+struct SignatureEntry {
+	std::string name;
+	std::string module;
+	std::string pattern;
+	std::vector<uintptr_t> matches;
+	std::string error; // why it couldn't be scanned for, empty if it was
+};
 
+// a file of named signatures, resolved all at once with one pass per module
+struct SignatureSet {
+	std::string path;
+	std::vector<SignatureEntry> entries;
+	size_t modules = 0;
+	double ms = 0;
+};
 
-	inline std::string toString()
-	{
-		switch (this->type)
-		{
-		case PatternType::IDA_SIGNATURE:
-			return "IDA Signature";
-		case PatternType::BYTE_PATTERN:
-			return "Byte Pattern";
-		case PatternType::UNKNOWN:
-		default:
-			return "Unknown";
-		}
-	}
+// a pattern that matches only at the address it was made for, within its module
+struct GeneratedSignature {
+	std::string pattern; // IDA format
+	std::string module;
+	uintptr_t address = 0;
+	uintptr_t rva = 0;
+	size_t length = 0;
+	double ms = 0;
+	std::string error; // why there is no pattern, empty if there is one
 };
 
 namespace pattern
 {
-	std::string stringToSignature(const std::string& in);
-	std::optional<PatternInfo> detectPatternType(const std::string& in);
+	// generates one signature at a time on a worker, a whole module is scanned for it so it can take a moment
+	class signatureGenerator {
+	public:
+		~signatureGenerator() { stop(); }
+
+		void start(uintptr_t address);
+		void stop();
+
+		bool busy() const { return running; }
+		std::optional<GeneratedSignature> take(); // the finished result, once
+
+	private:
+		std::mutex mutex;
+		std::thread worker;
+		std::atomic<bool> running = false;
+		std::optional<GeneratedSignature> finished;
+	};
+
+	inline patternScanOptions g_ScanOptions;
+	inline signatureGenerator g_SignatureGenerator;
+	inline signatureCache g_SignatureCache;
+	inline const char* SIGNATURE_CACHE_PATH = "ImClass.sigcache";
+
+	bool sectionMatches(const moduleSection& section, SectionFilter filter);
+	void addModuleRanges(const moduleInfo& module, SectionFilter filter, std::vector<scanRange>& out);
+	std::vector<scanRange> scanRanges(const ScanTarget& target);
+	std::vector<scanRange> committedRanges(memorySource& source, std::vector<scanRange> wanted, const ScanTarget& target);
+	uint64_t moduleCodeHash(const moduleInfo& module);
+	std::optional<signatureKey> cacheKey(const moduleInfo& module, uint32_t filter);
+	uint64_t patternHash(const CompiledPattern& compiled);
+	bool loadCachedMatches(const moduleInfo& module, const signatureKey& key, const patternMatcher& matcher, std::vector<uintptr_t>& out);
+	void storeCachedMatches(const moduleInfo& module, const signatureKey& key, const std::vector<uintptr_t>& matches);
+	std::optional<PatternScanResult> scanPattern(PatternInfo& patternInfo, const ScanTarget& target, std::optional<PatternType> patternType);
 	std::optional<PatternScanResult> scanPattern(PatternInfo& patternInfo, const std::string& dllName, std::optional<PatternType> patternType);
-	std::optional<PatternScanResult> findBytePattern(uintptr_t baseAddress, size_t size, const uint8_t* signature, const char* mask);
-	bool patternToMask(const PatternInfo& patternInfo, std::vector<uint8_t>& outBytes, std::string& outMask);
+	std::optional<PatternScanResult> findBytePattern(const std::vector<scanRange>& ranges, const CompiledPattern& compiled);
+	std::optional<PatternScanResult> findBytePattern(uintptr_t baseAddress, size_t size, const CompiledPattern& compiled);
+	std::optional<PatternScanResult> scanString(const std::string& text, const ScanTarget& target, const stringSearchOptions& options);
+	GeneratedSignature generateSignature(memorySource& source, const moduleInfo& module, uintptr_t address, bool is64Bit);
+	bool loadSignatureSet(const std::string& path, SignatureSet& out);
+	void resolveSignatureSet(SignatureSet& set);
 }
 
-inline std::string pattern::stringToSignature(const std::string& in) {
-	std::stringstream result;
+inline std::optional<PatternScanResult> pattern::findBytePattern(const std::vector<scanRange>& ranges, const CompiledPattern& compiled) {
+	PatternScanResult result;
 
-	for (size_t i = 0; i < in.length(); i++) {
+	if (compiled.length == 0)
+		return std::nullopt;
+
+	if (!mem::g_Source)
+		return std::nullopt;
 
-		result << "\\\\x" << std::uppercase << std::setfill('0') << std::setw(2)
-			<< std::hex << (static_cast<int>(in[i]) & 0xFF);
+	// streamed in chunks, a module with a few protected pages still gives every match in the rest of it
+	result.matches = findPattern(*mem::g_Source, ranges, compiled.matcher(), g_ScanOptions);
+
+	if (!result.matches.empty()) {
+		return result;
 	}
 
-	return result.str();
+	return std::nullopt;
 }
 
-inline std::optional<PatternInfo> pattern::detectPatternType(const std::string& in)
-{
-	auto trimmedInput = in;
-	trimmedInput.erase(0, trimmedInput.find_first_not_of(" \t\n\r\f\v"));
-	trimmedInput.erase(trimmedInput.find_last_not_of(" \t\n\r\f\v") + 1);
+inline std::optional<PatternScanResult> pattern::findBytePattern(uintptr_t baseAddress, size_t size, const CompiledPattern& compiled) {
+	return findBytePattern(std::vector<scanRange>{ { baseAddress, size } }, compiled);
+}
+
+// every encoding asked for in one pass over the target, strings aren't cached as their matches are mostly in data
+inline std::optional<PatternScanResult> pattern::scanString(const std::string& text, const ScanTarget& target, const stringSearchOptions& options) {
+	if (!mem::g_Source)
+		return std::nullopt;
 
-	if (trimmedInput.empty()) {
+	auto matchers = compileStringQuery(text, options);
+	if (matchers.empty())
 		return std::nullopt;
+
+	PatternScanResult result;
+	for (auto& match : findStrings(*mem::g_Source, scanRanges(target), matchers, g_ScanOptions)) {
+		result.matches.push_back(match.address);
+		result.labels.push_back(encodingName(match.encoding));
 	}
 
-	// double check these, I don't use byte patterns ever
-	std::regex idaRegex(R"(^([0-9A-Fa-f]{2}|\?{1,2})(\s+([0-9A-Fa-f]{2}|\?{1,2}))*$)");
-	std::regex byteRegex(R"(^(\\x[0-9A-Fa-f]{2}|\\x\?)*(\\x[0-9A-Fa-f]{2}|\\x\?)+$)");
+	if (!result.matches.empty()) {
+		return result;
+	}
+
+	return std::nullopt;
+}
 
-	PatternInfo info;
+inline bool pattern::sectionMatches(const moduleSection& section, SectionFilter filter)
+{
+	bool code = section.characteristics & (IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE);
+	bool data = section.characteristics & (IMAGE_SCN_CNT_INITIALIZED_DATA | IMAGE_SCN_CNT_UNINITIALIZED_DATA);
+
+	switch (filter) {
+	case SectionFilter::CODE:
+		return code;
+	case SectionFilter::DATA:
+		return data && !code && !(section.characteristics & IMAGE_SCN_MEM_DISCARDABLE); // relocations and the like
+	case SectionFilter::ANY:
+	default:
+		return true;
+	}
+}
 
-	if (std::regex_match(trimmedInput, idaRegex)) {
-		info.type = PatternType::IDA_SIGNATURE;
-		info.pattern = trimmedInput;
-		return info;
+inline void pattern::addModuleRanges(const moduleInfo& module, SectionFilter filter, std::vector<scanRange>& out)
+{
+	// images without parsed sections (elf files, broken headers) are scanned whole
+	if (filter == SectionFilter::ANY || module.sections.empty()) {
+		out.push_back({ module.base, module.size });
+		return;
 	}
 
-	/*
-	if (std::regex_match(trimmedInput, byteRegex)) {
-		info.type = PatternType::BYTE_PATTERN;
-		info.pattern = trimmedInput;
-		return info;
+	for (auto& section : module.sections) {
+		if (section.size && sectionMatches(section, filter)) {
+			out.push_back({ section.base, section.size });
+		}
 	}
-	*/
+}
 
-	// TODO: fix byte pattern regex, temporary solution below.
-	if (trimmedInput.find("\\x") != std::string::npos) {
-		info.type = PatternType::BYTE_PATTERN;
-		info.pattern = trimmedInput;
-		return info;
+// what a target covers, cut down to the committed regions that have the wanted protection. touching regions are
+// merged so a match across their border is still found
+inline std::vector<scanRange> pattern::scanRanges(const ScanTarget& target)
+{
+	std::vector<scanRange> wanted;
+	if (!mem::g_Source)
+		return wanted;
+
+	switch (target.scope) {
+	case ScanScope::MODULE: {
+		moduleInfo moduleData;
+		if (mem::getModuleInfo(target.module, &moduleData)) {
+			addModuleRanges(moduleData, target.sections, wanted);
+		}
+		break;
+	}
+	case ScanScope::ALL_MODULES:
+		for (auto& module : mem::moduleList) {
+			addModuleRanges(module, target.sections, wanted);
+		}
+		break;
+	case ScanScope::RANGE:
+		if (target.end > target.start) {
+			wanted.push_back({ target.start, target.end - target.start });
+		}
+		break;
+	case ScanScope::PRIVATE_MEMORY:
+		break;
 	}
 
-	return std::nullopt;
+	return committedRanges(*mem::g_Source, std::move(wanted), target);
 }
 
-inline bool pattern::patternToMask(const PatternInfo& patternInfo, std::vector<uint8_t>& outBytes, std::string& outMask)
+// only touches the source, so it can run off the ui thread once the wanted ranges are known
+inline std::vector<scanRange> pattern::committedRanges(memorySource& source, std::vector<scanRange> wanted, const ScanTarget& target)
 {
-	const std::string& signature = patternInfo.pattern;
+	std::sort(wanted.begin(), wanted.end(), [](const scanRange& a, const scanRange& b) { return a.base < b.base; });
 
-	outBytes.clear();
-	outMask.clear();
+	std::vector<memoryRegion> regions;
+	source.getRegions(regions);
 
-	if (patternInfo.type == PatternType::IDA_SIGNATURE) {
+	std::vector<scanRange> ranges;
+	if (regions.empty()) {
+		// nothing to filter with, scan what was asked for and let unreadable pages be skipped
+		if (target.scope != ScanScope::PRIVATE_MEMORY) {
+			ranges = wanted;
+		}
+	}
+	else {
+		std::sort(regions.begin(), regions.end(), [](const memoryRegion& a, const memoryRegion& b) { return a.base < b.base; });
 
-		std::string byteStr;
-		size_t length = signature.length();
-		for (size_t i = 0; i <= length; i++) {
-			char c = signature[i];
+		for (auto& region : regions) {
+			if (!region.committed || (region.protect & (target.protect | protect_read)) != (target.protect | protect_read)) {
+				continue;
+			}
 
-			if (c == ' ' || i == length) { // processes the last byte at spaces, but it will skip the last byte if not specified otherwise
-				if (!byteStr.empty()) {
-					if (byteStr == "?" || byteStr == "??") {
-						outBytes.push_back(0);
-						outMask += '?';
-					}
-					else {
-						outBytes.push_back((uint8_t)(std::stoi(byteStr, nullptr, 16)));
-						outMask += 'x';
-					}
-					byteStr.clear();
+			if (target.scope == ScanScope::PRIVATE_MEMORY) {
+				if (region.type == region_private) {
+					ranges.push_back({ region.base, region.size });
 				}
+				continue;
 			}
-			else {
-				byteStr += c;
+
+			uintptr_t regionEnd = region.base + region.size;
+			for (auto& range : wanted) {
+				uintptr_t begin = (std::max)(range.base, region.base);
+				uintptr_t end = (std::min)(range.base + range.size, regionEnd);
+				if (begin < end) {
+					ranges.push_back({ begin, end - begin });
+				}
 			}
 		}
 
-		return true;
-
+		std::sort(ranges.begin(), ranges.end(), [](const scanRange& a, const scanRange& b) { return a.base < b.base; });
 	}
 
-	if (patternInfo.type == PatternType::BYTE_PATTERN) {
-		for (size_t i = 0; i < signature.length();) { // don't iterate here, it can be incremented by varying numbers
-
-			auto currentCharacter = signature[i];
+	std::vector<scanRange> merged;
+	for (auto& range : ranges) {
+		if (!merged.empty() && merged.back().base + merged.back().size >= range.base) {
+			uintptr_t end = (std::max)(merged.back().base + merged.back().size, range.base + range.size);
+			merged.back().size = end - merged.back().base;
+		}
+		else {
+			merged.push_back(range);
+		}
+	}
+	return merged;
+}
 
-			if (currentCharacter == '\\' && i + 3 < signature.length() && signature[i + 1] == 'x')
-			{
-				std::string byteStr = signature.substr(i + 2, 2);
-				outBytes.push_back((uint8_t)(std::stoi(byteStr, nullptr, 16)));
-				outMask += 'x';
-				i += 4;
-			}
-			else if (currentCharacter == '?') {
-				outBytes.push_back(0);  // just a placeholder, never used
-				outMask += '?';
+// the cheap half of telling builds apart, the first, middle and last page of every code section in one batch.
+// the rest of the identity was read when the module was loaded
+inline uint64_t pattern::moduleCodeHash(const moduleInfo& module)
+{
+	std::vector<scanRange> pages;
+	for (auto& section : module.sections) {
+		if (!section.size || !sectionMatches(section, SectionFilter::CODE)) {
+			continue;
+		}
 
-				while (i < signature.length() && signature[i] == '?') {
-					i++;
-				}
-			}
-			else {
-				i++;
+		uintptr_t size = section.size;
+		for (uintptr_t offset : { uintptr_t(0), (size / 2) & ~uintptr_t(0xFFF), (size - 1) & ~uintptr_t(0xFFF) }) {
+			if (pages.empty() || pages.back().base != section.base + offset) {
+				pages.push_back({ section.base + offset, (std::min)(uintptr_t(0x1000), size - offset) });
 			}
 		}
-		return true;
 	}
-	return false;
-}
+	if (pages.empty()) {
+		pages.push_back({ module.base, (std::min)(uintptr_t(0x1000), uintptr_t(module.size)) });
+	}
 
-inline std::optional<PatternScanResult> pattern::findBytePattern(uintptr_t baseAddress, size_t size, const uint8_t* signature, const char* mask) {
-	PatternScanResult result;
+	std::vector<uint8_t> buffer(pages.size() * 0x1000);
+	std::vector<readRequest> requests;
+	for (size_t i = 0; i < pages.size(); i++) {
+		requests.push_back({ pages[i].base, pages[i].size, buffer.data() + i * 0x1000 });
+	}
+	mem::g_Source->readBatch(requests);
 
-	size_t patternLength = strlen(mask);
+	uint64_t hash = fnv1a(nullptr, 0);
+	for (size_t i = 0; i < pages.size(); i++) {
+		// a page that can't be read hashes as zeroes, it has to be unreadable next time too
+		hash = fnv1a(&pages[i].size, sizeof(pages[i].size), hash);
+		hash = fnv1a(buffer.data() + i * 0x1000, requests[i].success ? pages[i].size : 0, hash);
+	}
+	return hash;
+}
 
-	if (patternLength == 0)
+// everything but the pattern, one key serves every signature scanned for in the module
+inline std::optional<signatureKey> pattern::cacheKey(const moduleInfo& module, uint32_t filter)
+{
+	if (!module.identity.valid() || !mem::g_Source) {
 		return std::nullopt;
+	}
 
-	if (size < patternLength)
-		return std::nullopt;
+	if (!g_SignatureCache.isOpen()) {
+		g_SignatureCache.open(SIGNATURE_CACHE_PATH);
+	}
 
-	std::vector<uint8_t> buffer(size);
+	signatureKey key;
+	key.module = module.identity;
+	key.codeHash = moduleCodeHash(module);
+	key.filter = filter;
+	return key;
+}
 
-	if (!mem::read(baseAddress, buffer.data(), size)) {
-		return std::nullopt;
-	}
+inline uint64_t pattern::patternHash(const CompiledPattern& compiled)
+{
+	uint64_t hash = fnv1a(&compiled.length, sizeof(compiled.length));
+	hash = fnv1a(compiled.bytes.data(), compiled.length, hash);
+	return fnv1a(compiled.fixed.data(), (compiled.length + 63) / 64 * sizeof(uint64_t), hash);
+}
 
-	for (size_t i = 0; i <= size - patternLength; i++) {
-		bool found = true;
+inline bool pattern::loadCachedMatches(const moduleInfo& module, const signatureKey& key, const patternMatcher& matcher, std::vector<uintptr_t>& out)
+{
+	return loadVerifiedMatches(g_SignatureCache, *mem::g_Source, key, module.base, matcher, out);
+}
 
-		for (size_t j = 0; j < patternLength; j++) {
+inline void pattern::storeCachedMatches(const moduleInfo& module, const signatureKey& key, const std::vector<uintptr_t>& matches)
+{
+	storeModuleMatches(g_SignatureCache, key, module.base, module.size, matches);
+}
 
-			if (mask[j] == '?')
-				continue;
+inline std::optional<PatternScanResult> pattern::scanPattern(PatternInfo& patternInfo, const ScanTarget& target, std::optional<PatternType> inputPatternType = std::nullopt)
+{
+	// an explicit type wins, everything else is told apart by its format. parsed once, before anything is read
+	auto compiled = compilePattern(patternInfo.pattern, inputPatternType);
+	patternInfo.type = compiled ? compiled->type : (inputPatternType ? *inputPatternType : PatternType::UNKNOWN);
 
-			if (buffer[i + j] != signature[j]) {
-				found = false;
-				break;
-			}
-		}
+	if (!compiled || !mem::g_Source)
+		return std::nullopt;
 
-		if (found) {
-			result.matches.push_back(baseAddress + i);
+	// a module scanned in this build before comes out of the signature cache, if the pattern still matches at every cached address
+	const moduleInfo* module = target.scope == ScanScope::MODULE ? mem::findModule(target.module) : nullptr;
+	auto key = module ? cacheKey(*module, static_cast<uint32_t>(target.sections) | (target.protect << 8)) : std::nullopt;
+	if (key) {
+		key->patternHash = patternHash(*compiled);
+		PatternScanResult cached;
+		if (loadCachedMatches(*module, *key, compiled->matcher(), cached.matches)) {
+			return cached;
 		}
 	}
 
-	if (!result.matches.empty()) {
-		return result;
+	auto ranges = scanRanges(target);
+	if (ranges.empty())
+	{
+		return std::nullopt; // TODO: add failure reasons to the ui such as not finding the module
 	}
 
-	return std::nullopt;
+	auto result = findBytePattern(ranges, *compiled);
+	if (key) {
+		storeCachedMatches(*module, *key, result ? result->matches : std::vector<uintptr_t>());
+		g_SignatureCache.save();
+	}
+	return result;
 }
 
-
 inline std::optional<PatternScanResult> pattern::scanPattern(PatternInfo& patternInfo, const std::string& dllName, std::optional<PatternType> inputPatternType = std::nullopt)
 {
-	if (inputPatternType != std::nullopt) {
-		auto patternType = detectPatternType(patternInfo.pattern);
+	ScanTarget target;
+	target.module = dllName;
+	return scanPattern(patternInfo, target, inputPatternType);
+}
+
+// unique within the whole image, so it holds for a module scan with any section filter and for signature sets.
+// only reads through the source, the module was copied off the ui thread's list by signatureGenerator::start
+inline GeneratedSignature pattern::generateSignature(memorySource& source, const moduleInfo& module, uintptr_t address, bool is64Bit)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	GeneratedSignature result;
+	result.address = address;
+	result.module = module.name;
+	result.rva = address - module.base;
 
-		if (patternType != std::nullopt) {
-			patternInfo.type = patternType->type;
+	ScanTarget target;
+	target.module = module.name;
+	target.sections = SectionFilter::ANY;
+
+	std::vector<scanRange> wanted;
+	addModuleRanges(module, target.sections, wanted);
+
+	signatureOptions options;
+	options.scan = g_ScanOptions;
+
+	generatedPattern generated;
+	if (!generatePattern(source, committedRanges(source, std::move(wanted), target), address, is64Bit, generated, options)) {
+		if (generated.bytes.empty()) {
+			result.error = "No instruction could be decoded at the address.";
+		}
+		else {
+			result.error = "Still matches " + std::to_string(generated.candidates) + " places after " + std::to_string(generated.bytes.size()) + " bytes.";
+		}
+	}
+	else {
+		char hex[4];
+		for (size_t i = 0; i < generated.bytes.size(); i++) {
+			snprintf(hex, sizeof(hex), "%02X", generated.bytes[i]);
+			result.pattern += i ? " " : "";
+			result.pattern += generated.masks[i] ? hex : "?";
 		}
+		result.length = generated.bytes.size();
 	}
 
-	std::wstring wideName(dllName.begin(), dllName.end()); // windows api requires widestring, maybe change input type?
-	DWORD pid = mem::g_pid;
+	result.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	return result;
+}
 
-	if (!pid)
-		return std::nullopt;
+inline void pattern::signatureGenerator::stop()
+{
+	if (worker.joinable()) {
+		worker.join();
+	}
+}
+
+// ui thread, the module list is only read here. the scan itself runs on the worker and the result is picked up
+// with take() once it is done
+inline void pattern::signatureGenerator::start(uintptr_t address)
+{
+	stop();
 
-	moduleInfo moduleData;
-	if (!mem::getModuleInfo(pid, wideName.c_str(), &moduleData))
 	{
-		return std::nullopt; // TODO: add failure reasons to the ui such as not finding the module
+		std::lock_guard lock(mutex);
+		finished.reset();
 	}
 
-	std::vector<uint8_t> patternBytes;
-	std::string mask;
+	auto module = std::find_if(mem::moduleList.begin(), mem::moduleList.end(), [&](const moduleInfo& info) { return address >= info.base && address - info.base < info.size; });
+	if (!mem::g_Source || module == mem::moduleList.end()) {
+		GeneratedSignature result;
+		result.address = address;
+		result.error = "The selected address is not inside a module!";
 
-	if (!patternToMask(patternInfo, patternBytes, mask)) {
-		return std::nullopt;
+		std::lock_guard lock(mutex);
+		finished = std::move(result);
+		return;
 	}
 
-	auto result = findBytePattern(
-		moduleData.base,
-		moduleData.size,
-		patternBytes.data(),
-		mask.c_str()
-	);
+	running = true;
+	worker = std::thread([this, source = mem::g_Source, module = *module, address, is64Bit = !mem::x32]() {
+		auto result = generateSignature(*source, module, address, is64Bit);
+
+		std::lock_guard lock(mutex);
+		finished = std::move(result);
+		running = false;
+	});
+}
 
+inline std::optional<GeneratedSignature> pattern::signatureGenerator::take()
+{
+	std::lock_guard lock(mutex);
+	auto result = std::move(finished);
+	finished.reset();
 	return result;
-}
\ No newline at end of file
+}
+
+// one signature per line as "name = pattern", either format. a "[module.dll]" line sets the module for the lines
+// after it, a "name = module.dll!pattern" overrides it for one. blank lines and lines starting with # or ; are skipped
+inline bool pattern::loadSignatureSet(const std::string& path, SignatureSet& out)
+{
+	std::ifstream file(path);
+	if (!file) {
+		return false;
+	}
+
+	auto trim = [](std::string text) {
+		text.erase(0, text.find_first_not_of(" \t\r"));
+		text.erase(text.find_last_not_of(" \t\r") + 1);
+		return text;
+	};
+
+	out.path = path;
+	out.entries.clear();
+	out.modules = 0;
+	out.ms = 0;
+
+	std::string module;
+	std::string line;
+	while (std::getline(file, line)) {
+		line = trim(line);
+		if (line.empty() || line[0] == '#' || line[0] == ';') {
+			continue;
+		}
+
+		if (line.front() == '[' && line.back() == ']') {
+			module = trim(line.substr(1, line.size() - 2));
+			continue;
+		}
+
+		SignatureEntry entry;
+		size_t equals = line.find('=');
+		if (equals == std::string::npos) {
+			entry.name = line;
+			entry.error = "expected name = pattern";
+			out.entries.push_back(entry);
+			continue;
+		}
+
+		entry.name = trim(line.substr(0, equals));
+		entry.pattern = trim(line.substr(equals + 1));
+		entry.module = module;
+
+		size_t bang = entry.pattern.find('!');
+		if (bang != std::string::npos) {
+			entry.module = trim(entry.pattern.substr(0, bang));
+			entry.pattern = trim(entry.pattern.substr(bang + 1));
+		}
+
+		if (entry.module.empty()) {
+			entry.error = "no module";
+		}
+
+		out.entries.push_back(entry);
+	}
+
+	return true;
+}
+
+// every signature of a module goes into one multiMatcher, so the module is read once however many there are
+inline void pattern::resolveSignatureSet(SignatureSet& set)
+{
+	auto start = std::chrono::steady_clock::now();
+
+	std::vector<std::pair<std::string, std::vector<size_t>>> byModule;
+	for (size_t i = 0; i < set.entries.size(); i++) {
+		auto& entry = set.entries[i];
+		entry.matches.clear();
+		if (entry.pattern.empty() || entry.module.empty()) {
+			continue; // keeps the error it was loaded with
+		}
+		entry.error.clear();
+
+		auto it = std::find_if(byModule.begin(), byModule.end(), [&](const auto& group) { return mem::lowerName(group.first) == mem::lowerName(entry.module); });
+		if (it == byModule.end()) {
+			byModule.push_back({ entry.module, {} });
+			it = byModule.end() - 1;
+		}
+		it->second.push_back(i);
+	}
+
+	set.modules = 0;
+	for (auto& [module, indices] : byModule) {
+		moduleInfo moduleData;
+		if (!mem::g_Source || !mem::getModuleInfo(module, &moduleData)) {
+			for (size_t i : indices) {
+				set.entries[i].error = "module not loaded";
+			}
+			continue;
+		}
+
+		// signatures point at code, so only the code sections are scanned. the target and the cache key are those of
+		// a default module scan, so both share cached results
+		ScanTarget target;
+		target.module = module;
+
+		// signatures already resolved in this build come out of the cache, only the rest are scanned for
+		auto loaded = mem::findModule(module);
+		auto moduleKey = loaded ? cacheKey(*loaded, static_cast<uint32_t>(target.sections) | (target.protect << 8)) : std::nullopt;
+		multiMatcher matcher;
+		std::vector<size_t> ids; // matcher id -> entry
+		std::vector<uint64_t> hashes;
+		for (size_t i : indices) {
+			auto& entry = set.entries[i];
+
+			auto compiled = compilePattern(entry.pattern);
+			if (!compiled) {
+				entry.error = "invalid pattern";
+				continue;
+			}
+
+			uint64_t hash = patternHash(*compiled);
+			if (moduleKey) {
+				moduleKey->patternHash = hash;
+				if (loadCachedMatches(*loaded, *moduleKey, compiled->matcher(), entry.matches)) {
+					continue;
+				}
+			}
+
+			if (!matcher.add(compiled->bytes.data(), compiled->fixed.data(), compiled->length)) {
+				entry.error = "invalid pattern";
+				continue;
+			}
+			ids.push_back(i);
+			hashes.push_back(hash);
+		}
+
+		if (ids.empty()) {
+			continue;
+		}
+
+		auto results = findPatterns(*mem::g_Source, scanRanges(target), matcher, g_ScanOptions);
+		for (size_t id = 0; id < ids.size(); id++) {
+			if (moduleKey) {
+				moduleKey->patternHash = hashes[id];
+				storeCachedMatches(*loaded, *moduleKey, results[id]);
+			}
+			set.entries[ids[id]].matches = std::move(results[id]);
+		}
+		set.modules++;
+		g_SignatureCache.save();
+	}
+
+	set.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
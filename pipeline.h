@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// attach runs as a list of stages on a worker thread. a stage does its remote reads and parsing there and hands
+// back a closure that publishes the result, those closures run on the ui thread at the start of a frame. the ui
+// can keep using everything it reads without locks, it just sees it fill in stage by stage
+
+struct stageTiming {
+    std::string name;
+    double ms = 0;
+    bool done = false;
+};
+
+class stagedPipeline {
+public:
+    using publishFn = std::function<void()>;
+    using stageFn = std::function<publishFn(const std::atomic<bool>& cancel)>;
+
+    ~stagedPipeline() { stop(); }
+
+    void start(std::vector<std::pair<std::string, stageFn>> stages);
+    void stop(); // cancels, waits for the worker and drops whatever wasn't published yet
+    void publish(); // ui thread only
+
+    bool busy() const;
+    std::vector<stageTiming> timings() const;
+    std::string currentStage() const;
+
+private:
+    mutable std::mutex mutex;
+    std::thread worker;
+    std::atomic<bool> cancel = false;
+    std::atomic<bool> running = false;
+
+    std::vector<stageTiming> stageTimings;
+    std::vector<publishFn> finished;
+};
+
+inline void stagedPipeline::stop() {
+    cancel = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    cancel = false;
+
+    std::lock_guard lock(mutex);
+    finished.clear();
+}
+
+inline void stagedPipeline::start(std::vector<std::pair<std::string, stageFn>> stages) {
+    stop();
+
+    {
+        std::lock_guard lock(mutex);
+        stageTimings.clear();
+        for (auto& [name, fn] : stages) {
+            stageTimings.push_back({ name });
+        }
+    }
+
+    running = true;
+    worker = std::thread([this, stages = std::move(stages)]() {
+        for (size_t i = 0; i < stages.size() && !cancel; i++) {
+            auto start = std::chrono::steady_clock::now();
+            publishFn result = stages[i].second(cancel);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            std::lock_guard lock(mutex);
+            stageTimings[i].ms = ms;
+            stageTimings[i].done = true;
+            if (result && !cancel) {
+                finished.push_back(std::move(result));
+            }
+        }
+        running = false;
+    });
+}
+
+inline void stagedPipeline::publish() {
+    std::vector<publishFn> ready;
+    {
+        std::lock_guard lock(mutex);
+        ready.swap(finished);
+    }
+
+    for (auto& fn : ready) {
+        fn();
+    }
+
+    if (!running && worker.joinable()) {
+        worker.join();
+    }
+}
+
+inline bool stagedPipeline::busy() const {
+    std::lock_guard lock(mutex);
+    return running || !finished.empty();
+}
+
+inline std::vector<stageTiming> stagedPipeline::timings() const {
+    std::lock_guard lock(mutex);
+    return stageTimings;
+}
+
+inline std::string stagedPipeline::currentStage() const {
+    std::lock_guard lock(mutex);
+    for (auto& stage : stageTimings) {
+        if (!stage.done) {
+            return stage.name;
+        }
+    }
+    return {};
+}
@@ -0,0 +1,325 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "source.h"
+
+// the node view used to read every class synchronously while drawing, so a slow target dragged the frame
+// rate down with it. open classes are now refreshed by a reader thread at their own rate, each into a triple
+// buffer: the thread fills its back buffer and swaps it with the ready one, the ui swaps ready with front when
+// something new arrived. neither side ever waits on the other for longer than a pointer swap. what the ui shows
+// for a pointer (whether it points anywhere, the class of a vtable) can take reads and region queries of its own,
+// so the reader works that out too and the ui only ever looks at the snapshot
+
+inline constexpr uintptr_t READER_PREVIEW_SIZE = 64; // bytes read behind every pointer a visible hex node holds
+
+// what the reader found out about a preview address besides its bytes
+struct previewFacts {
+    bool described = false; // false until a reader pass got to the address
+    bool pointer = false; // into a module or committed private memory
+    std::string rtti; // " : class : base ..." when it's a vtable
+};
+
+using previewDescriber = std::function<void(uintptr_t address, previewFacts& facts)>;
+
+struct readerSnapshot {
+    uintptr_t address = 0;
+    std::vector<uint8_t> data;
+    bool valid = false;
+
+    std::vector<uintptr_t> previewAddresses; // sorted
+    std::vector<uint8_t> previews; // READER_PREVIEW_SIZE bytes per address, zero where unreadable
+    std::vector<previewFacts> facts; // one per address
+
+    const uint8_t* preview(uintptr_t address) const;
+    const previewFacts* describe(uintptr_t address) const;
+
+private:
+    size_t previewIndex(uintptr_t address) const; // previewAddresses.size() if it isn't there
+};
+
+class readerSlot {
+public:
+    std::atomic<int> intervalMs; // how often the class is re-read
+
+    explicit readerSlot(int interval) : intervalMs(interval) {}
+
+    // the newest completed snapshot, stays valid until the next call
+    const readerSnapshot& latest();
+
+    double rate() const; // completed reads per second
+    double latency() const; // milliseconds the last read took
+
+private:
+    friend class backgroundReader;
+
+    mutable std::mutex mutex;
+    uintptr_t address = 0;
+    size_t size = 0;
+    std::vector<uintptr_t> previewAddresses;
+
+    std::unique_ptr<readerSnapshot> front = std::make_unique<readerSnapshot>();
+    std::unique_ptr<readerSnapshot> ready = std::make_unique<readerSnapshot>();
+    std::unique_ptr<readerSnapshot> back = std::make_unique<readerSnapshot>(); // only touched by the reader thread
+    bool fresh = false;
+
+    std::chrono::steady_clock::time_point nextRead;
+    std::chrono::steady_clock::time_point lastCompleted;
+    double averageInterval = 0;
+    double lastLatency = 0;
+};
+
+class backgroundReader {
+public:
+    std::chrono::milliseconds defaultInterval{ 16 };
+
+    ~backgroundReader() { stop(); }
+
+    // describe runs on the reader thread for every preview address of every pass. waits for a pass that is
+    // still using the old source or describer
+    void setSource(std::shared_ptr<memorySource> source, previewDescriber describe = {});
+    std::shared_ptr<readerSlot> subscribe();
+
+    // what the slot should read from now on, a changed address or size is read right away
+    void request(readerSlot& slot, uintptr_t address, size_t size, std::vector<uintptr_t> previews);
+
+    void stop();
+
+private:
+    std::mutex mutex;
+    std::mutex passMutex; // held by the reader thread while it reads
+    std::condition_variable wake;
+    std::thread worker;
+    bool stopping = false;
+    bool woken = false;
+
+    std::shared_ptr<memorySource> source;
+    previewDescriber describer;
+    std::vector<std::weak_ptr<readerSlot>> slots;
+
+    void run();
+    static void refresh(memorySource& source, const previewDescriber& describe, readerSlot& slot);
+};
+
+inline size_t readerSnapshot::previewIndex(uintptr_t target) const {
+    auto it = std::lower_bound(previewAddresses.begin(), previewAddresses.end(), target);
+    if (it == previewAddresses.end() || *it != target) {
+        return previewAddresses.size();
+    }
+    return it - previewAddresses.begin();
+}
+
+inline const uint8_t* readerSnapshot::preview(uintptr_t target) const {
+    size_t index = previewIndex(target);
+    return index < previewAddresses.size() ? previews.data() + index * READER_PREVIEW_SIZE : nullptr;
+}
+
+inline const previewFacts* readerSnapshot::describe(uintptr_t target) const {
+    size_t index = previewIndex(target);
+    return index < facts.size() ? &facts[index] : nullptr;
+}
+
+inline const readerSnapshot& readerSlot::latest() {
+    std::lock_guard lock(mutex);
+    if (fresh) {
+        std::swap(front, ready);
+        fresh = false;
+    }
+    return *front;
+}
+
+inline double readerSlot::rate() const {
+    std::lock_guard lock(mutex);
+    return averageInterval > 0 ? 1000.0 / averageInterval : 0;
+}
+
+inline double readerSlot::latency() const {
+    std::lock_guard lock(mutex);
+    return lastLatency;
+}
+
+inline void backgroundReader::setSource(std::shared_ptr<memorySource> newSource, previewDescriber describe) {
+    {
+        std::lock_guard lock(mutex);
+        source = std::move(newSource);
+        describer = std::move(describe);
+        woken = true;
+    }
+    wake.notify_one();
+
+    // a pass that started with the old source is over once this returns, so whatever it used can go
+    std::lock_guard pass(passMutex);
+}
+
+inline std::shared_ptr<readerSlot> backgroundReader::subscribe() {
+    auto slot = std::make_shared<readerSlot>(static_cast<int>(defaultInterval.count()));
+
+    std::lock_guard lock(mutex);
+    slots.push_back(slot);
+    if (!worker.joinable()) {
+        stopping = false;
+        worker = std::thread(&backgroundReader::run, this);
+    }
+    return slot;
+}
+
+inline void backgroundReader::request(readerSlot& slot, uintptr_t address, size_t size, std::vector<uintptr_t> previews) {
+    std::sort(previews.begin(), previews.end());
+    previews.erase(std::unique(previews.begin(), previews.end()), previews.end());
+
+    bool changed = false;
+    {
+        std::lock_guard lock(slot.mutex);
+        changed = (slot.address != address || slot.size != size);
+        slot.address = address;
+        slot.size = size;
+        slot.previewAddresses = std::move(previews);
+        if (changed) {
+            slot.nextRead = {};
+        }
+    }
+
+    if (changed) {
+        std::lock_guard lock(mutex);
+        woken = true;
+        wake.notify_one();
+    }
+}
+
+inline void backgroundReader::stop() {
+    {
+        std::lock_guard lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+inline void backgroundReader::refresh(memorySource& source, const previewDescriber& describe, readerSlot& slot) {
+    uintptr_t address;
+    size_t size;
+    std::vector<uintptr_t> previews;
+    {
+        std::lock_guard lock(slot.mutex);
+        address = slot.address;
+        size = slot.size;
+        previews = slot.previewAddresses;
+    }
+
+    auto& snapshot = *slot.back;
+    snapshot.address = address;
+    snapshot.data.assign(size, 0);
+    snapshot.previewAddresses = std::move(previews);
+    snapshot.previews.assign(snapshot.previewAddresses.size() * READER_PREVIEW_SIZE, 0);
+    snapshot.facts.resize(snapshot.previewAddresses.size());
+
+    // the class and everything its visible pointers lead to go out as one batch, pointers into the class or close
+    // to each other share a read
+    std::vector<readRequest> requests;
+    requests.reserve(snapshot.previewAddresses.size() + 1);
+    if (address && size) {
+        requests.push_back({ address, size, snapshot.data.data() });
+    }
+    for (size_t i = 0; i < snapshot.previewAddresses.size(); i++) {
+        requests.push_back({ snapshot.previewAddresses[i], READER_PREVIEW_SIZE, snapshot.previews.data() + i * READER_PREVIEW_SIZE });
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    readMerged(requests, [&](std::vector<readRequest>& spans) { source.readBatch(spans); },
+        [&](uintptr_t at, void* buf, uintptr_t bytes) { return source.read(at, buf, bytes); });
+
+    for (size_t i = 0; i < snapshot.facts.size(); i++) {
+        auto& facts = snapshot.facts[i];
+        facts.described = false;
+        facts.pointer = false;
+        facts.rtti.clear();
+        if (describe) {
+            describe(snapshot.previewAddresses[i], facts);
+            facts.described = true;
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    snapshot.valid = (address && size && requests.front().success);
+
+    std::lock_guard lock(slot.mutex);
+    std::swap(slot.back, slot.ready);
+    slot.fresh = true;
+
+    slot.lastLatency = std::chrono::duration<double, std::milli>(end - start).count();
+    if (slot.lastCompleted.time_since_epoch().count()) {
+        double interval = std::chrono::duration<double, std::milli>(end - slot.lastCompleted).count();
+        slot.averageInterval = slot.averageInterval > 0 ? slot.averageInterval * 0.9 + interval * 0.1 : interval;
+    }
+    slot.lastCompleted = end;
+
+    // a request that moved the slot while this was reading already asked for an immediate read
+    if (slot.address == address && slot.size == size) {
+        slot.nextRead = start + std::chrono::milliseconds(slot.intervalMs.load());
+    }
+}
+
+inline void backgroundReader::run() {
+    std::unique_lock lock(mutex);
+
+    while (!stopping) {
+        std::erase_if(slots, [](const std::weak_ptr<readerSlot>& slot) { return slot.expired(); });
+
+        std::vector<std::shared_ptr<readerSlot>> live;
+        for (auto& slot : slots) {
+            if (auto locked = slot.lock()) {
+                live.push_back(std::move(locked));
+            }
+        }
+
+        // held for the whole pass, see setSource
+        std::unique_lock pass(passMutex);
+        auto target = source;
+        auto describe = describer;
+
+        lock.unlock();
+
+        auto now = std::chrono::steady_clock::now();
+        auto nextWake = now + std::chrono::milliseconds(100);
+
+        for (auto& slot : live) {
+            if (!target) {
+                break;
+            }
+
+            std::chrono::steady_clock::time_point due;
+            {
+                std::lock_guard slotLock(slot->mutex);
+                due = slot->nextRead;
+            }
+
+            if (due <= now) {
+                refresh(*target, describe, *slot);
+                std::lock_guard slotLock(slot->mutex);
+                due = slot->nextRead;
+            }
+
+            nextWake = (std::min)(nextWake, due);
+        }
+
+        live.clear(); // slots of closed classes shouldn't outlive them while the thread sleeps
+        pass.unlock();
+
+        lock.lock();
+        wake.wait_until(lock, nextWake, [this]() { return stopping || woken; });
+        woken = false;
+    }
+}
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "source.h"
+
+// isPointer runs for every visible hex node every frame and most of the values it gets are not pointers, so
+// "what is this address" is answered from a sorted snapshot of modules, sections and memory regions taken
+// at attach time. anything the snapshot doesn't know is asked once and remembered for a while, including
+// holes, so garbage values don't turn into a syscall each
+
+struct indexedSection {
+    uintptr_t base;
+    uintptr_t end;
+    char name[8];
+};
+
+struct indexedModule {
+    uintptr_t base;
+    uintptr_t end;
+    std::string name;
+    std::vector<indexedSection> sections; // sorted by base
+};
+
+struct indexedRegion {
+    uintptr_t base;
+    uintptr_t end;
+    bool isPrivate; // committed private memory, everything else mapped is not treated as a pointer target
+};
+
+struct regionSnapshot {
+    std::vector<indexedModule> modules; // sorted by base
+    std::vector<indexedRegion> regions; // every non-free region, sorted and merged
+    std::chrono::steady_clock::time_point builtAt;
+
+    const indexedModule* findModule(uintptr_t address) const;
+    const indexedRegion* findRegion(uintptr_t address) const;
+    static const indexedSection* findSection(const indexedModule& module, uintptr_t address);
+};
+
+class regionIndex {
+public:
+    ~regionIndex();
+
+    std::chrono::milliseconds refreshInterval{ 10000 }; // regions are re-enumerated this often
+    std::chrono::milliseconds learnedLifetime{ 1000 }; // how long a single queried region is trusted
+    size_t maxLearned = 16384;
+
+    void build(std::shared_ptr<memorySource> source, std::vector<indexedModule> modules);
+    void clear();
+
+    std::shared_ptr<const regionSnapshot> current() const;
+    bool isPrivate(const regionSnapshot& regions, uintptr_t address);
+
+private:
+    struct learnedRange {
+        uintptr_t end;
+        bool isPrivate;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    std::shared_ptr<const regionSnapshot> snapshot = std::make_shared<regionSnapshot>();
+    std::shared_ptr<memorySource> source;
+
+    mutable std::mutex mutex;
+    std::map<uintptr_t, learnedRange> learned; // keyed by region base
+    std::thread worker;
+    bool refreshing = false;
+
+    static std::vector<indexedRegion> collectRegions(memorySource& source);
+    void startRefresh();
+    void refreshRegions(std::shared_ptr<memorySource> target);
+};
+
+template <typename T>
+inline const T* findContaining(const std::vector<T>& entries, uintptr_t address) {
+    auto it = std::upper_bound(entries.begin(), entries.end(), address, [](uintptr_t value, const T& entry) {
+        return value < entry.base;
+    });
+
+    if (it == entries.begin() || address >= (it - 1)->end) {
+        return nullptr;
+    }
+
+    return &*(it - 1);
+}
+
+inline const indexedModule* regionSnapshot::findModule(uintptr_t address) const {
+    return findContaining(modules, address);
+}
+
+inline const indexedSection* regionSnapshot::findSection(const indexedModule& module, uintptr_t address) {
+    return findContaining(module.sections, address);
+}
+
+inline const indexedRegion* regionSnapshot::findRegion(uintptr_t address) const {
+    return findContaining(regions, address);
+}
+
+inline std::vector<indexedRegion> regionIndex::collectRegions(memorySource& source) {
+    std::vector<memoryRegion> regions;
+    source.getRegions(regions);
+
+    std::sort(regions.begin(), regions.end(), [](const memoryRegion& a, const memoryRegion& b) { return a.base < b.base; });
+
+    std::vector<indexedRegion> ranges;
+    for (auto& region : regions) {
+        if (region.type == region_free || region.size == 0) {
+            continue;
+        }
+
+        bool isPrivate = (region.type == region_private && region.committed);
+
+        // neighbouring allocations of the same kind are merged, a heap is usually a long run of them
+        if (!ranges.empty() && ranges.back().end == region.base && ranges.back().isPrivate == isPrivate) {
+            ranges.back().end = region.base + region.size;
+        }
+        else {
+            ranges.push_back({ region.base, region.base + region.size, isPrivate });
+        }
+    }
+
+    return ranges;
+}
+
+// readers only hold the lock long enough to copy the pointer, the snapshot itself is never modified
+inline std::shared_ptr<const regionSnapshot> regionIndex::current() const {
+    std::lock_guard lock(mutex);
+    return snapshot;
+}
+
+inline void regionIndex::build(std::shared_ptr<memorySource> newSource, std::vector<indexedModule> modules) {
+    auto regions = std::make_shared<regionSnapshot>();
+
+    std::sort(modules.begin(), modules.end(), [](const indexedModule& a, const indexedModule& b) { return a.base < b.base; });
+    for (auto& module : modules) {
+        std::sort(module.sections.begin(), module.sections.end(), [](const indexedSection& a, const indexedSection& b) { return a.base < b.base; });
+    }
+
+    regions->modules = std::move(modules);
+    if (newSource) {
+        regions->regions = collectRegions(*newSource);
+    }
+    regions->builtAt = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(mutex);
+    source = std::move(newSource);
+    learned.clear();
+    snapshot = std::move(regions);
+}
+
+inline void regionIndex::clear() {
+    std::lock_guard lock(mutex);
+    source.reset();
+    learned.clear();
+    snapshot = std::make_shared<const regionSnapshot>();
+}
+
+inline regionIndex::~regionIndex() {
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+// a full region walk is far too slow for the caller, which is usually drawing a frame. it runs on a worker
+// and lookups keep using the old snapshot until the new one is published
+inline void regionIndex::startRefresh() {
+    std::lock_guard lock(mutex);
+    if (refreshing || !source) {
+        return;
+    }
+    refreshing = true;
+
+    // the last refresh cleared the flag as its final step, so this join doesn't wait
+    if (worker.joinable()) {
+        worker.join();
+    }
+    worker = std::thread(&regionIndex::refreshRegions, this, source);
+}
+
+// modules are left alone, they only change through build()
+inline void regionIndex::refreshRegions(std::shared_ptr<memorySource> target) {
+    auto old = current();
+    auto regions = std::make_shared<regionSnapshot>();
+    regions->modules = old->modules;
+    regions->regions = collectRegions(*target);
+    regions->builtAt = std::chrono::steady_clock::now();
+
+    std::lock_guard lock(mutex);
+    refreshing = false;
+    if (source == target) {
+        learned.clear();
+        snapshot = std::move(regions);
+    }
+}
+
+inline bool regionIndex::isPrivate(const regionSnapshot& regions, uintptr_t address) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (now - regions.builtAt > refreshInterval) {
+        startRefresh();
+    }
+
+    // regions that existed at the last refresh rarely change kind, only the holes between them need asking
+    if (auto region = regions.findRegion(address)) {
+        return region->isPrivate;
+    }
+
+    std::shared_ptr<memorySource> target;
+    {
+        std::lock_guard lock(mutex);
+        auto it = learned.upper_bound(address);
+        if (it != learned.begin()) {
+            --it;
+            if (address < it->second.end && now - it->second.time <= learnedLifetime) {
+                return it->second.isPrivate;
+            }
+        }
+        target = source;
+    }
+
+    memoryRegion region;
+    if (!target || !target->queryRegion(address, &region)) {
+        return false;
+    }
+
+    bool result = (region.type == region_private && region.committed);
+
+    std::lock_guard lock(mutex);
+    if (learned.size() >= maxLearned) {
+        learned.clear();
+    }
+
+    // regions can be split or merged since they were learned, drop whatever overlaps the new one
+    uintptr_t end = (region.base + region.size > region.base) ? region.base + region.size : UINTPTR_MAX;
+    auto first = learned.upper_bound(region.base);
+    if (first != learned.begin() && std::prev(first)->second.end > region.base) {
+        --first;
+    }
+    learned.erase(first, learned.lower_bound(end));
+    learned[region.base] = { end, result, now };
+
+    return result;
+}
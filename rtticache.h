@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+// resolving the class hierarchy behind a vtable takes a handful of dependent reads, but the answer never
+// changes while the module that holds it stays loaded. results are kept per vtable address, including the
+// "not rtti" ones since most values that get asked about are plain heap pointers. addresses inside a module
+// are trusted until it unloads, anything else (heap, manually mapped code) only for a short while
+
+struct rttiLookup {
+    bool cached = false;
+    const std::string* names = nullptr; // nullptr when the address isn't a vtable
+};
+
+class rttiCache {
+public:
+    std::chrono::milliseconds transientLifetime{ 1000 }; // for addresses outside any known module
+    size_t maxEntries = 65536;
+
+    rttiLookup find(uintptr_t address) const;
+
+    // names are interned and stay valid until clear()
+    const std::string* store(uintptr_t address, const std::string* names, bool inModule);
+    const std::string* intern(const std::string& names);
+
+    void invalidate(uintptr_t base, uintptr_t end); // drops every entry in [base, end)
+    void clear();
+
+private:
+    struct entry {
+        const std::string* names;
+        bool inModule;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<uintptr_t, entry> entries;
+    std::unordered_set<std::string> strings;
+};
+
+inline rttiLookup rttiCache::find(uintptr_t address) const {
+    std::lock_guard lock(mutex);
+    auto it = entries.find(address);
+    if (it == entries.end()) {
+        return {};
+    }
+
+    auto& result = it->second;
+    if (!result.inModule && std::chrono::steady_clock::now() - result.time > transientLifetime) {
+        return {};
+    }
+
+    return { true, result.names };
+}
+
+inline const std::string* rttiCache::intern(const std::string& names) {
+    std::lock_guard lock(mutex);
+    return &*strings.insert(names).first;
+}
+
+inline const std::string* rttiCache::store(uintptr_t address, const std::string* names, bool inModule) {
+    std::lock_guard lock(mutex);
+
+    // expired transient entries are only ever overwritten, so they're dropped in bulk once there are too many
+    if (entries.size() >= maxEntries) {
+        auto now = std::chrono::steady_clock::now();
+        std::erase_if(entries, [&](const auto& item) { return !item.second.inModule && now - item.second.time > transientLifetime; });
+
+        if (entries.size() >= maxEntries) {
+            entries.clear();
+        }
+    }
+
+    entries[address] = { names, inModule, std::chrono::steady_clock::now() };
+    return names;
+}
+
+inline void rttiCache::invalidate(uintptr_t base, uintptr_t end) {
+    std::lock_guard lock(mutex);
+    std::erase_if(entries, [&](const auto& item) { return item.first >= base && item.first < end; });
+}
+
+inline void rttiCache::clear() {
+    std::lock_guard lock(mutex);
+    entries.clear();
+    strings.clear();
+}
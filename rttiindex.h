@@ -0,0 +1,460 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "source.h"
+#include "parallel.h"
+
+// every polymorphic class in a module has a complete object locator sitting in .rdata right before its
+// vtable(s). instead of discovering them one hex node at a time, each module's .rdata is swept once in the
+// background for locators, the pointers to them give the vtables, and the hierarchy is resolved locally from
+// the section bytes. the result is a vtable -> class and class -> vtables index per module
+
+struct rttiType {
+    std::string name; // most derived class, "Player"
+    std::string hierarchy; // " : Player : Entity", same format as mem::rttiInfo
+    std::vector<uintptr_t> vtables; // one per base that brings its own vtable
+    uintptr_t primaryVtable = 0; // the one at offset 0 of a complete object, what instances start with
+};
+
+struct rttiModuleTypes {
+    std::string module;
+    uintptr_t base;
+    uintptr_t end;
+    std::vector<rttiType> types; // sorted by name
+    std::unordered_map<uintptr_t, uint32_t> vtables; // vtable -> index into types
+};
+
+struct rttiSnapshot {
+    std::vector<std::shared_ptr<const rttiModuleTypes>> modules; // sorted by base
+
+    const rttiModuleTypes* findModule(uintptr_t address) const;
+    const rttiType* findVtable(uintptr_t vtable) const;
+    std::vector<const rttiType*> findClass(std::string_view name) const;
+    size_t typeCount() const;
+};
+
+struct rttiScanSection {
+    uintptr_t base;
+    uintptr_t size;
+    bool scan; // .rdata is searched for locators and vtables, .data is only read for type descriptors
+};
+
+struct rttiScanModule {
+    std::string name;
+    uintptr_t base;
+    uintptr_t size;
+    std::vector<rttiScanSection> sections;
+};
+
+class rttiIndex {
+public:
+    static constexpr uintptr_t CHUNK_SIZE = 0x40000;
+    static constexpr uint32_t MAX_BASE_CLASSES = 256;
+    static constexpr size_t MAX_NAME = 512;
+
+    std::atomic<size_t> modulesDone = 0;
+    std::atomic<size_t> modulesTotal = 0;
+
+    ~rttiIndex() { stop(); }
+
+    // indexes every module that isn't already, modules no longer in the list are dropped
+    void start(std::shared_ptr<memorySource> source, bool is32Bit, std::vector<rttiScanModule> modules);
+    void stop();
+    void clear();
+
+    bool busy() const { return running; }
+    std::shared_ptr<const rttiSnapshot> current() const;
+
+    static std::shared_ptr<rttiModuleTypes> scanModule(memorySource& source, bool is32Bit, const rttiScanModule& module, const std::atomic<bool>& cancel);
+
+private:
+    mutable std::mutex mutex;
+    std::shared_ptr<const rttiSnapshot> snapshot = std::make_shared<rttiSnapshot>();
+    std::thread worker;
+    std::atomic<bool> cancel = false;
+    std::atomic<bool> running = false;
+
+    void publish(std::shared_ptr<const rttiModuleTypes> types);
+};
+
+inline const rttiModuleTypes* rttiSnapshot::findModule(uintptr_t address) const {
+    auto it = std::upper_bound(modules.begin(), modules.end(), address, [](uintptr_t value, const auto& module) {
+        return value < module->base;
+    });
+
+    if (it == modules.begin() || address >= (*(it - 1))->end) {
+        return nullptr;
+    }
+
+    return (it - 1)->get();
+}
+
+inline const rttiType* rttiSnapshot::findVtable(uintptr_t vtable) const {
+    auto module = findModule(vtable);
+    if (!module) {
+        return nullptr;
+    }
+
+    auto it = module->vtables.find(vtable);
+    return it != module->vtables.end() ? &module->types[it->second] : nullptr;
+}
+
+inline std::vector<const rttiType*> rttiSnapshot::findClass(std::string_view name) const {
+    std::vector<const rttiType*> result;
+    for (auto& module : modules) {
+        auto it = std::lower_bound(module->types.begin(), module->types.end(), name, [](const rttiType& type, std::string_view value) {
+            return type.name < value;
+        });
+        for (; it != module->types.end() && it->name == name; ++it) {
+            result.push_back(&*it);
+        }
+    }
+    return result;
+}
+
+inline size_t rttiSnapshot::typeCount() const {
+    size_t count = 0;
+    for (auto& module : modules) {
+        count += module->types.size();
+    }
+    return count;
+}
+
+inline std::shared_ptr<const rttiSnapshot> rttiIndex::current() const {
+    std::lock_guard lock(mutex);
+    return snapshot;
+}
+
+inline void rttiIndex::publish(std::shared_ptr<const rttiModuleTypes> types) {
+    std::lock_guard lock(mutex);
+    auto next = std::make_shared<rttiSnapshot>(*snapshot);
+    auto it = std::lower_bound(next->modules.begin(), next->modules.end(), types->base, [](const auto& module, uintptr_t value) {
+        return module->base < value;
+    });
+    next->modules.insert(it, std::move(types));
+    snapshot = std::move(next);
+}
+
+inline void rttiIndex::stop() {
+    cancel = true;
+    if (worker.joinable()) {
+        worker.join();
+    }
+    cancel = false;
+}
+
+inline void rttiIndex::clear() {
+    stop();
+    std::lock_guard lock(mutex);
+    snapshot = std::make_shared<rttiSnapshot>();
+    modulesDone = 0;
+    modulesTotal = 0;
+}
+
+inline void rttiIndex::start(std::shared_ptr<memorySource> source, bool is32Bit, std::vector<rttiScanModule> modules) {
+    stop();
+
+    // modules that are still loaded where they were keep their types
+    std::vector<rttiScanModule> pending;
+    {
+        std::lock_guard lock(mutex);
+        std::unordered_map<uintptr_t, std::shared_ptr<const rttiModuleTypes>> known;
+        for (auto& types : snapshot->modules) {
+            known.emplace(types->base, types);
+        }
+
+        auto next = std::make_shared<rttiSnapshot>();
+        for (auto& module : modules) {
+            auto it = known.find(module.base);
+            if (it != known.end() && it->second->end == module.base + module.size && it->second->module == module.name) {
+                next->modules.push_back(it->second);
+            }
+            else {
+                pending.push_back(std::move(module));
+            }
+        }
+
+        std::sort(next->modules.begin(), next->modules.end(), [](const auto& a, const auto& b) { return a->base < b->base; });
+        snapshot = std::move(next);
+    }
+
+    modulesDone = 0;
+    modulesTotal = pending.size();
+    if (pending.empty() || !source) {
+        return;
+    }
+
+    running = true;
+    worker = std::thread([this, source = std::move(source), is32Bit, pending = std::move(pending)]() {
+        for (auto& module : pending) {
+            if (cancel) {
+                break;
+            }
+
+            if (auto types = scanModule(*source, is32Bit, module, cancel)) {
+                publish(std::move(types));
+            }
+            modulesDone++;
+        }
+        running = false;
+    });
+}
+
+inline std::string_view rttiStripName(std::string_view name) {
+    // ".?AVname@@" -> "name", ".?AU" for structs
+    if (name.size() < 6 || !name.starts_with(".?A") || !name.ends_with("@@")) {
+        return {};
+    }
+    return name.substr(4, name.size() - 6);
+}
+
+inline std::shared_ptr<rttiModuleTypes> rttiIndex::scanModule(memorySource& source, bool is32Bit, const rttiScanModule& module, const std::atomic<bool>& cancel) {
+    const uintptr_t pointerSize = is32Bit ? 4 : 8;
+    const uintptr_t moduleEnd = module.base + module.size;
+
+    // sections the source already holds locally (dumps) are used in place, the rest are copied a chunk at a time
+    // so a protected page only sends its own chunk back to page by page reads. unreadable pages stay zero
+    std::vector<const uint8_t*> data(module.sections.size());
+    std::vector<std::vector<uint8_t>> buffers(module.sections.size());
+    std::vector<std::pair<size_t, uintptr_t>> copies; // section, offset
+    for (size_t i = 0; i < module.sections.size(); i++) {
+        auto& section = module.sections[i];
+        if ((data[i] = source.view(section.base, section.size))) {
+            continue;
+        }
+
+        buffers[i].resize(section.size);
+        data[i] = buffers[i].data();
+        for (uintptr_t offset = 0; offset < section.size; offset += CHUNK_SIZE) {
+            copies.push_back({ i, offset });
+        }
+    }
+
+    parallelFor(copies.size(), [&](size_t i) {
+        if (cancel) {
+            return;
+        }
+
+        auto [index, start] = copies[i];
+        auto& section = module.sections[index];
+        uintptr_t size = (std::min)(CHUNK_SIZE, section.size - start);
+        if (source.read(section.base + start, buffers[index].data() + start, size)) {
+            return;
+        }
+        for (uintptr_t offset = start; offset < start + size; offset += 0x1000) {
+            uintptr_t pageSize = (std::min)(uintptr_t(0x1000), start + size - offset);
+            if (!source.read(section.base + offset, buffers[index].data() + offset, pageSize)) {
+                memset(buffers[index].data() + offset, 0, pageSize);
+            }
+        }
+    });
+
+    if (cancel) {
+        return nullptr;
+    }
+
+    // pointer to the bytes of address and how many follow it in the same section
+    auto locate = [&](uintptr_t address, uintptr_t* remaining) -> const uint8_t* {
+        for (size_t i = 0; i < module.sections.size(); i++) {
+            auto& section = module.sections[i];
+            if (address >= section.base && address - section.base < section.size) {
+                *remaining = section.size - (address - section.base);
+                return data[i] + (address - section.base);
+            }
+        }
+        return nullptr;
+    };
+
+    auto at = [&](uintptr_t address, uintptr_t size) -> const uint8_t* {
+        uintptr_t remaining = 0;
+        auto data = locate(address, &remaining);
+        return (data && remaining >= size) ? data : nullptr;
+    };
+
+    auto readDword = [&](uintptr_t address, uint32_t* out) {
+        auto data = at(address, 4);
+        if (data) {
+            memcpy(out, data, 4);
+        }
+        return data != nullptr;
+    };
+
+    // x64 stores image relative offsets, x86 absolute pointers
+    auto resolve = [&](uint32_t value) -> uintptr_t { return is32Bit ? value : module.base + value; };
+
+    auto typeName = [&](uintptr_t typeDescriptor) -> std::string_view {
+        uintptr_t remaining = 0;
+        auto name = reinterpret_cast<const char*>(locate(typeDescriptor + 2 * pointerSize, &remaining));
+        if (!name) {
+            return {};
+        }
+        return rttiStripName(std::string_view(name, strnlen(name, (std::min)(remaining, uintptr_t(MAX_NAME)))));
+    };
+
+    // locators: signature 1 and a selfOffset pointing back at itself on x64, signature 0 and in-module pointers on x86
+    std::vector<std::pair<uintptr_t, uintptr_t>> chunks;
+    for (auto& section : module.sections) {
+        if (!section.scan) {
+            continue;
+        }
+        for (uintptr_t offset = 0; offset < section.size; offset += CHUNK_SIZE) {
+            chunks.push_back({ section.base + offset, (std::min)(CHUNK_SIZE, section.size - offset) });
+        }
+    }
+
+    std::vector<std::vector<uintptr_t>> chunkLocators(chunks.size());
+    parallelFor(chunks.size(), [&](size_t i) {
+        if (cancel) {
+            return;
+        }
+
+        auto [chunkBase, chunkSize] = chunks[i];
+        for (uintptr_t address = chunkBase; address < chunkBase + chunkSize; address += 4) {
+            uint32_t fields[6];
+            auto data = at(address, is32Bit ? 20 : 24);
+            if (!data) {
+                break;
+            }
+            memcpy(fields, data, is32Bit ? 20 : 24);
+
+            uintptr_t typeDescriptor = resolve(fields[3]);
+            uintptr_t hierarchy = resolve(fields[4]);
+            if (is32Bit) {
+                if (fields[0] != 0) {
+                    continue;
+                }
+            }
+            else if (fields[0] != 1 || fields[5] != address - module.base) {
+                continue;
+            }
+
+            if (typeDescriptor < module.base || typeDescriptor >= moduleEnd || hierarchy < module.base || hierarchy >= moduleEnd) {
+                continue;
+            }
+
+            if (!typeName(typeDescriptor).empty()) {
+                chunkLocators[i].push_back(address);
+            }
+        }
+    });
+
+    std::unordered_set<uintptr_t> locators;
+    for (auto& found : chunkLocators) {
+        locators.insert(found.begin(), found.end());
+    }
+
+    // every pointer-sized slot that holds a locator address sits right in front of a vtable
+    std::vector<std::vector<std::pair<uintptr_t, uintptr_t>>> chunkVtables(chunks.size());
+    parallelFor(chunks.size(), [&](size_t i) {
+        if (cancel || locators.empty()) {
+            return;
+        }
+
+        auto [chunkBase, chunkSize] = chunks[i];
+        uintptr_t first = (chunkBase + pointerSize - 1) & ~(pointerSize - 1);
+        for (uintptr_t address = first; address < chunkBase + chunkSize; address += pointerSize) {
+            auto data = at(address, pointerSize);
+            if (!data) {
+                break;
+            }
+
+            uintptr_t value = 0;
+            memcpy(&value, data, pointerSize);
+            if (value >= module.base && value < moduleEnd && locators.count(value)) {
+                chunkVtables[i].push_back({ address + pointerSize, value });
+            }
+        }
+    });
+
+    if (cancel) {
+        return nullptr;
+    }
+
+    auto result = std::make_shared<rttiModuleTypes>();
+    result->module = module.name;
+    result->base = module.base;
+    result->end = moduleEnd;
+
+    std::unordered_map<std::string, rttiType> byName;
+    std::unordered_map<uintptr_t, std::pair<std::string, uint32_t>> locatorNames; // name and offset of the subobject
+
+    for (uintptr_t locator : locators) {
+        uint32_t fields[5];
+        memcpy(fields, at(locator, 20), sizeof(fields));
+
+        auto name = typeName(resolve(fields[3]));
+        uintptr_t hierarchy = resolve(fields[4]);
+
+        uint32_t numBaseClasses = 0;
+        uint32_t baseClassArray = 0;
+        if (!readDword(hierarchy + 8, &numBaseClasses) || !readDword(hierarchy + 12, &baseClassArray) || numBaseClasses > MAX_BASE_CLASSES) {
+            continue;
+        }
+
+        std::string names;
+        bool valid = true;
+        for (uint32_t i = 0; i < numBaseClasses && valid; i++) {
+            uint32_t classDescriptor = 0;
+            uint32_t typeDescriptor = 0;
+            valid = readDword(resolve(baseClassArray) + i * 4, &classDescriptor) && readDword(resolve(classDescriptor), &typeDescriptor);
+
+            auto baseName = valid ? typeName(resolve(typeDescriptor)) : std::string_view();
+            valid = !baseName.empty();
+            names += " : ";
+            names += baseName;
+        }
+
+        if (!valid) {
+            continue;
+        }
+
+        auto& type = byName[std::string(name)];
+        if (type.name.empty()) {
+            type.name = name;
+            type.hierarchy = std::move(names);
+        }
+        locatorNames.emplace(locator, std::make_pair(type.name, fields[1]));
+    }
+
+    for (auto& found : chunkVtables) {
+        for (auto& [vtable, locator] : found) {
+            auto it = locatorNames.find(locator);
+            if (it != locatorNames.end()) {
+                auto& type = byName[it->second.first];
+                type.vtables.push_back(vtable);
+                if (it->second.second == 0) {
+                    type.primaryVtable = vtable;
+                }
+            }
+        }
+    }
+
+    for (auto& [name, type] : byName) {
+        if (type.vtables.empty()) {
+            continue;
+        }
+        std::sort(type.vtables.begin(), type.vtables.end());
+        result->types.push_back(std::move(type));
+    }
+
+    std::sort(result->types.begin(), result->types.end(), [](const rttiType& a, const rttiType& b) { return a.name < b.name; });
+    for (uint32_t i = 0; i < result->types.size(); i++) {
+        for (uintptr_t vtable : result->types[i].vtables) {
+            result->vtables.emplace(vtable, i);
+        }
+    }
+
+    return result;
+}
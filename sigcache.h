@@ -0,0 +1,301 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mappedfile.h"
+#include "matcher.h"
+#include "modcache.h"
+#include "source.h"
+
+// where signatures matched in builds of modules seen before, as rvas so they hold wherever the module is loaded
+// next time. restarting the target gives the same binaries, a scan of one of them only has to check it really is
+// the same build and that the pattern still matches at every cached rva instead of reading the whole module again
+
+struct signatureKey {
+    moduleIdentity module;
+    uint64_t codeHash = 0; // of a few pages of every code section, only a sample
+    uint64_t patternHash = 0; // of the compiled bytes and mask
+    uint32_t filter = 0; // sections and protection the scan was limited to
+
+    uint64_t key() const;
+};
+
+inline uint64_t signatureKey::key() const {
+    uint64_t result = module.key();
+    result = fnv1a(&codeHash, sizeof(codeHash), result);
+    result = fnv1a(&patternHash, sizeof(patternHash), result);
+    return fnv1a(&filter, sizeof(filter), result);
+}
+
+class signatureCache {
+public:
+    static constexpr uint32_t MAGIC = 0x53434D49; // "IMCS"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr size_t MAX_ENTRIES = 65536;
+
+    bool open(const std::string& path);
+    bool isOpen() const { return file.isOpen(); }
+
+    // false if the signature wasn't scanned for in this build yet. safe from any number of threads, save() remaps
+    // the file under an exclusive lock
+    bool load(const signatureKey& key, std::vector<uint32_t>& rvas) const;
+
+    void store(const signatureKey& key, std::vector<uint32_t> rvas);
+    bool save(); // same as moduleCache::save
+
+private:
+#pragma pack(push, 4)
+    struct fileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t rvaCount;
+    };
+
+    struct fileEntry {
+        uint64_t key;
+        uint64_t nameHash;
+        uint64_t headerHash;
+        uint64_t codeHash;
+        uint64_t patternHash;
+        uint32_t timeDateStamp;
+        uint32_t sizeOfImage;
+        uint32_t filter;
+        uint32_t firstRva;
+        uint32_t rvaCount;
+        uint32_t reserved; // keeps entries 8 byte aligned
+    };
+#pragma pack(pop)
+
+    std::string path;
+    mappedFile file;
+
+    const fileHeader* header = nullptr;
+    const fileEntry* entries = nullptr; // sorted by key
+    const uint32_t* rvas = nullptr;
+
+    mutable std::shared_mutex mappingMutex; // guards the mapping and the views into it
+    std::mutex mutex; // guards pending, taken before mappingMutex
+    std::unordered_map<uint64_t, std::pair<signatureKey, std::vector<uint32_t>>> pending;
+
+    bool validate();
+    static fileEntry describe(const signatureKey& key);
+    static bool sameBuild(const fileEntry& a, const fileEntry& b);
+};
+
+inline bool signatureCache::open(const std::string& cachePath) {
+    std::lock_guard lock(mutex);
+    std::unique_lock mapping(mappingMutex);
+    path = cachePath;
+    header = nullptr;
+
+    if (!file.open(path)) {
+        return false;
+    }
+
+    if (!validate()) {
+        file.close();
+        header = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+inline bool signatureCache::validate() {
+    uint64_t size = file.size();
+    if (size < sizeof(fileHeader)) {
+        return false;
+    }
+
+    auto candidate = reinterpret_cast<const fileHeader*>(file.data());
+    if (candidate->magic != MAGIC || candidate->version != VERSION) {
+        return false;
+    }
+
+    uint64_t entriesOffset = sizeof(fileHeader);
+    uint64_t rvasOffset = entriesOffset + uint64_t(candidate->entryCount) * sizeof(fileEntry);
+    if (rvasOffset + uint64_t(candidate->rvaCount) * sizeof(uint32_t) > size) {
+        return false;
+    }
+
+    auto entryTable = reinterpret_cast<const fileEntry*>(file.data() + entriesOffset);
+    for (uint32_t i = 0; i < candidate->entryCount; i++) {
+        auto& entry = entryTable[i];
+        if (uint64_t(entry.firstRva) + entry.rvaCount > candidate->rvaCount || (i > 0 && entryTable[i - 1].key > entry.key)) {
+            return false;
+        }
+    }
+
+    header = candidate;
+    entries = entryTable;
+    rvas = reinterpret_cast<const uint32_t*>(file.data() + rvasOffset);
+    return true;
+}
+
+// the module name only goes in as a hash, entries are matched on every field and not just the key
+inline signatureCache::fileEntry signatureCache::describe(const signatureKey& key) {
+    fileEntry entry{};
+    entry.key = key.key();
+    entry.nameHash = fnv1a(key.module.name.data(), key.module.name.size());
+    entry.headerHash = key.module.headerHash;
+    entry.codeHash = key.codeHash;
+    entry.patternHash = key.patternHash;
+    entry.timeDateStamp = key.module.timeDateStamp;
+    entry.sizeOfImage = key.module.sizeOfImage;
+    entry.filter = key.filter;
+    return entry;
+}
+
+inline bool signatureCache::sameBuild(const fileEntry& a, const fileEntry& b) {
+    return a.key == b.key && a.nameHash == b.nameHash && a.headerHash == b.headerHash && a.codeHash == b.codeHash &&
+        a.patternHash == b.patternHash && a.timeDateStamp == b.timeDateStamp && a.sizeOfImage == b.sizeOfImage && a.filter == b.filter;
+}
+
+inline bool signatureCache::load(const signatureKey& key, std::vector<uint32_t>& out) const {
+    std::shared_lock mapping(mappingMutex);
+    if (!header || !key.module.valid()) {
+        return false;
+    }
+
+    fileEntry wanted = describe(key);
+    auto end = entries + header->entryCount;
+    auto it = std::lower_bound(entries, end, wanted.key, [](const fileEntry& entry, uint64_t value) { return entry.key < value; });
+
+    for (; it != end && it->key == wanted.key; ++it) {
+        if (sameBuild(*it, wanted)) {
+            out.assign(rvas + it->firstRva, rvas + it->firstRva + it->rvaCount);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void signatureCache::store(const signatureKey& key, std::vector<uint32_t> matches) {
+    if (!key.module.valid()) {
+        return;
+    }
+
+    std::lock_guard lock(mutex);
+    pending[key.key()] = { key, std::move(matches) };
+}
+
+inline bool signatureCache::save() {
+    std::lock_guard lock(mutex);
+    if (pending.empty() || path.empty()) {
+        return false;
+    }
+
+    std::vector<fileEntry> outEntries;
+    std::vector<uint32_t> outRvas;
+
+    for (auto& [key, value] : pending) {
+        fileEntry entry = describe(value.first);
+        entry.firstRva = static_cast<uint32_t>(outRvas.size());
+        entry.rvaCount = static_cast<uint32_t>(value.second.size());
+        outRvas.insert(outRvas.end(), value.second.begin(), value.second.end());
+        outEntries.push_back(entry);
+    }
+
+    for (uint32_t i = 0; header && i < header->entryCount && outEntries.size() < MAX_ENTRIES; i++) {
+        auto& old = entries[i];
+        if (pending.count(old.key)) {
+            continue;
+        }
+
+        fileEntry entry = old;
+        entry.firstRva = static_cast<uint32_t>(outRvas.size());
+        outRvas.insert(outRvas.end(), rvas + old.firstRva, rvas + old.firstRva + old.rvaCount);
+        outEntries.push_back(entry);
+    }
+
+    std::sort(outEntries.begin(), outEntries.end(), [](const fileEntry& a, const fileEntry& b) { return a.key < b.key; });
+
+    fileHeader outHeader{ MAGIC, VERSION, static_cast<uint32_t>(outEntries.size()), static_cast<uint32_t>(outRvas.size()) };
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&outHeader), sizeof(outHeader));
+        out.write(reinterpret_cast<const char*>(outEntries.data()), outEntries.size() * sizeof(fileEntry));
+        out.write(reinterpret_cast<const char*>(outRvas.data()), outRvas.size() * sizeof(uint32_t));
+        if (!out) {
+            return false;
+        }
+    }
+
+    std::unique_lock mapping(mappingMutex);
+    file.close();
+    header = nullptr;
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, path, error);
+    pending.clear();
+
+    if (!file.open(path) || !validate()) {
+        file.close();
+        header = nullptr;
+        return false;
+    }
+
+    return !error;
+}
+
+// the cached matches of a signature in the module at moduleBase, read back in one batch and compared under the
+// mask. the key only samples the image, so a single rva that doesn't match anymore turns the whole entry into a
+// miss. an entry without matches has nothing to check and is a miss as well
+inline bool loadVerifiedMatches(const signatureCache& cache, memorySource& source, const signatureKey& key, uintptr_t moduleBase,
+    const patternMatcher& matcher, std::vector<uintptr_t>& out) {
+    std::vector<uint32_t> rvas;
+    if (!cache.load(key, rvas) || rvas.empty() || matcher.length() == 0) {
+        return false;
+    }
+
+    const size_t length = matcher.length();
+    std::vector<uint8_t> buffer(rvas.size() * length);
+    std::vector<readRequest> requests;
+    requests.reserve(rvas.size());
+    for (size_t i = 0; i < rvas.size(); i++) {
+        requests.push_back({ moduleBase + rvas[i], length, buffer.data() + i * length });
+    }
+    source.readBatch(requests);
+
+    for (size_t i = 0; i < rvas.size(); i++) {
+        if (!requests[i].success || !matcher.matchesAt(buffer.data() + i * length)) {
+            return false;
+        }
+    }
+
+    out.clear();
+    for (uint32_t rva : rvas) {
+        out.push_back(moduleBase + rva);
+    }
+    return true;
+}
+
+// only matches inside the image can be stored relative to it, and only a signature that matched can be verified
+inline void storeModuleMatches(signatureCache& cache, const signatureKey& key, uintptr_t moduleBase, uintptr_t moduleSize,
+    const std::vector<uintptr_t>& matches) {
+    if (matches.empty()) {
+        return;
+    }
+
+    std::vector<uint32_t> rvas;
+    for (uintptr_t match : matches) {
+        if (match < moduleBase || match - moduleBase >= moduleSize) {
+            return;
+        }
+        rvas.push_back(static_cast<uint32_t>(match - moduleBase));
+    }
+    cache.store(key, std::move(rvas));
+}
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "source.h"
+#include "matcher.h"
+#include "x86decode.h"
+
+// builds the shortest pattern starting at an address that matches nowhere else in the given ranges. the first few
+// fixed bytes are searched for in one streamed pass over the ranges, after that only the bytes behind the offsets
+// that matched are read, so no length is ever scanned for twice and memory stays at a few chunks however large
+// the module is
+
+struct signatureOptions {
+    size_t maxLength = 128;
+    size_t seedBytes = 4; // fixed bytes the first pass searches for, later bytes only filter
+    bool wildcardImmediates = true; // 32 and 64 bit immediates, imm8 and imm16 are mostly constants and stay
+    size_t windowBatch = 4096; // candidates whose bytes are fetched in one batch
+    patternScanOptions scan; // for the seed pass
+};
+
+struct generatedPattern {
+    std::vector<uint8_t> bytes; // wildcards are zero
+    std::vector<uint8_t> masks; // 0xFF where the byte has to match
+    size_t candidates = 0; // offsets that still matched when generation stopped, 1 on success
+    uint64_t bytesScanned = 0;
+    bool unique = false;
+};
+
+// an instruction's displacement is wildcarded when it is 32 bits (rip relative, an absolute address or a large
+// field offset), branch targets and absolute addresses always, other immediates when they are 32 bits or wider
+inline size_t layoutPattern(const uint8_t* code, size_t size, bool is64Bit, const signatureOptions& options,
+    std::vector<uint8_t>& bytes, std::vector<uint8_t>& masks) {
+    bytes.clear();
+    masks.clear();
+
+    size_t offset = 0;
+    while (offset < size && bytes.size() < options.maxLength) {
+        instructionLayout layout;
+        if (!decodeInstruction(code + offset, size - offset, is64Bit, &layout)) {
+            break; // past the end of the function or into data, the pattern can't go on from here
+        }
+
+        for (size_t i = 0; i < layout.length; i++) {
+            bool wildcard = (layout.dispSize == 4 && i >= layout.dispOffset && i < layout.dispOffset + layout.dispSize) ||
+                (layout.immSize && i >= layout.immOffset && i < layout.immOffset + layout.immSize &&
+                    (layout.relative || layout.address || (options.wildcardImmediates && layout.immSize >= 4)));
+
+            bytes.push_back(wildcard ? 0 : code[offset + i]);
+            masks.push_back(wildcard ? 0 : 0xFF);
+        }
+        offset += layout.length;
+    }
+
+    if (bytes.size() > options.maxLength) {
+        bytes.resize(options.maxLength);
+        masks.resize(options.maxLength);
+    }
+    return bytes.size();
+}
+
+inline bool generatePattern(memorySource& source, const std::vector<scanRange>& ranges, uintptr_t address, bool is64Bit,
+    generatedPattern& out, const signatureOptions& options = {}) {
+    out = generatedPattern();
+
+    // the code to describe, as far as it can be read
+    std::vector<uint8_t> code(options.maxLength + 15);
+    size_t readable = 0;
+    while (readable < code.size()) {
+        uintptr_t pageEnd = ((address + readable) | 0xFFF) + 1;
+        size_t size = (std::min)(code.size() - readable, static_cast<size_t>(pageEnd - (address + readable)));
+        if (!source.read(address + readable, code.data() + readable, size)) {
+            break;
+        }
+        readable += size;
+    }
+
+    std::vector<uint8_t> bytes, masks;
+    size_t length = layoutPattern(code.data(), readable, is64Bit, options, bytes, masks);
+    if (length == 0) {
+        return false;
+    }
+
+    auto rangeOf = [&](uintptr_t at) {
+        return std::find_if(ranges.begin(), ranges.end(), [&](const scanRange& range) { return at >= range.base && at - range.base < range.size; });
+    };
+    if (rangeOf(address) == ranges.end()) {
+        return false;
+    }
+
+    // the seed runs up to the seedBytes-th fixed byte
+    size_t seed = 0;
+    for (size_t fixed = 0; seed < length && fixed < options.seedBytes; seed++) {
+        fixed += masks[seed] != 0;
+    }
+
+    std::vector<uint64_t> fixedBits((seed + 63) / 64);
+    for (size_t i = 0; i < seed; i++) {
+        if (masks[i]) {
+            fixedBits[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    patternMatcher matcher(bytes.data(), fixedBits.data(), seed);
+
+    // unreadable pages are skipped, nothing can match in them
+    auto candidates = findPattern(source, ranges, matcher, options.scan);
+    for (auto& range : ranges) {
+        out.bytesScanned += range.size;
+    }
+
+    // every further fixed byte drops the candidates it doesn't match, and those the pattern would run off the end
+    // of their range at. wildcards can't drop anything but the latter, which is left to the next fixed byte. so
+    // each other candidate is out at its first such byte and the pattern has to reach one past the last of those.
+    // the bytes behind the seed are fetched a batch of candidates at a time, unreadable ones stay zero, which can
+    // only keep a candidate alive longer than it should
+    size_t used = seed;
+    size_t alive = 0;
+    bool selfFound = false;
+    std::vector<readRequest> requests;
+    std::vector<uint8_t> windows;
+    std::vector<uintptr_t> ends;
+
+    for (size_t first = 0; first < candidates.size(); first += options.windowBatch) {
+        size_t count = (std::min)(options.windowBatch, candidates.size() - first);
+        requests.clear();
+        ends.assign(count, 0);
+        windows.assign(count * length, 0);
+
+        for (size_t i = 0; i < count; i++) {
+            uintptr_t candidate = candidates[first + i];
+            auto range = rangeOf(candidate);
+            ends[i] = range->base + range->size;
+            uintptr_t size = (std::min)(static_cast<uintptr_t>(length), ends[i] - candidate);
+            if (size > seed) {
+                requests.push_back({ candidate + seed, size - seed, windows.data() + i * length + seed });
+            }
+        }
+
+        if (!requests.empty()) {
+            readMerged(requests, [&](std::vector<readRequest>& spans) { source.readBatch(spans); },
+                [&](uintptr_t at, void* buf, uintptr_t size) { return source.read(at, buf, size); });
+        }
+
+        for (size_t i = 0; i < count; i++) {
+            uintptr_t candidate = candidates[first + i];
+            if (candidate == address) {
+                selfFound = true;
+                continue;
+            }
+
+            const uint8_t* window = windows.data() + i * length;
+            size_t position = seed;
+            for (; position < length; position++) {
+                if (masks[position] && (candidate + position >= ends[i] || window[position] != bytes[position])) {
+                    break;
+                }
+            }
+
+            if (position == length) {
+                alive++;
+            }
+            else {
+                used = (std::max)(used, position + 1);
+            }
+        }
+    }
+
+    out.unique = selfFound && alive == 0;
+    if (!out.unique) {
+        used = length;
+    }
+
+    out.bytes.assign(bytes.begin(), bytes.begin() + used);
+    out.masks.assign(masks.begin(), masks.begin() + used);
+    out.candidates = alive + selfFound;
+    return out.unique;
+}
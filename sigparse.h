@@ -0,0 +1,194 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "matcher.h"
+
+// the signature text formats and their parser, kept apart from the scanning in patterns.h so it builds without
+// windows and can be checked at compile time
+
+enum class PatternType {
+    IDA_SIGNATURE,
+    BYTE_PATTERN,
+    UNKNOWN
+};
+
+inline constexpr size_t MAX_PATTERN_LENGTH = 512; // bytes, enough for anything the scanner windows take
+
+// a signature parsed once into what the matcher works on, scans never look at the text again
+struct CompiledPattern {
+    PatternType type = PatternType::UNKNOWN;
+    size_t length = 0;
+    std::array<uint8_t, MAX_PATTERN_LENGTH> bytes{}; // wildcards are zero
+    std::array<uint64_t, MAX_PATTERN_LENGTH / 64> fixed{}; // bit i set when byte i has to match
+    patternAnchors anchors;
+
+    constexpr bool isFixed(size_t i) const { return isFixedByte(fixed.data(), i); }
+    patternMatcher matcher() const { return patternMatcher(bytes.data(), fixed.data(), length, anchors); }
+};
+
+class PatternInfo {
+public:
+    PatternType type;
+    std::string pattern; // always trimmed on creation to not have whitespace
+
+
+    inline std::string toString()
+    {
+        switch (this->type)
+        {
+        case PatternType::IDA_SIGNATURE:
+            return "IDA Signature";
+        case PatternType::BYTE_PATTERN:
+            return "Byte Pattern";
+        case PatternType::UNKNOWN:
+        default:
+            return "Unknown";
+        }
+    }
+};
+
+namespace pattern
+{
+    constexpr std::optional<CompiledPattern> compilePattern(std::string_view text, std::optional<PatternType> type = std::nullopt);
+    consteval CompiledPattern compileSignature(std::string_view text);
+    std::optional<PatternInfo> detectPatternType(const std::string& in);
+
+    constexpr bool isPatternSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v';
+    }
+
+    constexpr int hexDigit(char c) {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'a' && c <= 'f')
+            return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    // not constexpr, a signature that fails to parse inside compileSignature stops the build here
+    inline void invalidSignature() {}
+}
+
+// "48 8B ?? 05" (IDA) or "\x48\x8B\x?\x05" (byte pattern), told apart by whether there is a \x in it. a wildcard is
+// "?" or "??" in both, runs of backslashes count as one so escaped strings can be pasted as they are. anything else
+// is a format error
+constexpr std::optional<CompiledPattern> pattern::compilePattern(std::string_view text, std::optional<PatternType> type)
+{
+    CompiledPattern compiled;
+    compiled.type = type ? *type : (text.find("\\x") != std::string_view::npos ? PatternType::BYTE_PATTERN : PatternType::IDA_SIGNATURE);
+
+    auto push = [&](int value) {
+        if (compiled.length == MAX_PATTERN_LENGTH)
+            return false;
+        if (value >= 0) {
+            compiled.bytes[compiled.length] = static_cast<uint8_t>(value);
+            compiled.fixed[compiled.length / 64] |= uint64_t(1) << (compiled.length % 64);
+        }
+        compiled.length++;
+        return true;
+    };
+
+    size_t i = 0;
+    auto wildcard = [&]() {
+        size_t count = 0;
+        while (i < text.size() && text[i] == '?') {
+            i++;
+            count++;
+        }
+        return count;
+    };
+
+    while (true) {
+        while (i < text.size() && isPatternSpace(text[i]))
+            i++;
+        if (i == text.size())
+            break;
+
+        if (compiled.type == PatternType::IDA_SIGNATURE) {
+            size_t questions = wildcard();
+            if (questions) {
+                if (questions > 2 || !push(-1))
+                    return std::nullopt;
+            }
+            else {
+                if (i + 1 >= text.size() || hexDigit(text[i]) < 0 || hexDigit(text[i + 1]) < 0 || !push(hexDigit(text[i]) * 16 + hexDigit(text[i + 1])))
+                    return std::nullopt;
+                i += 2;
+            }
+
+            // tokens have to be separated
+            if (i < text.size() && !isPatternSpace(text[i]))
+                return std::nullopt;
+        }
+        else if (compiled.type == PatternType::BYTE_PATTERN) {
+            if (text[i] == '\\') {
+                while (i < text.size() && text[i] == '\\')
+                    i++;
+                if (i == text.size() || text[i] != 'x')
+                    return std::nullopt;
+                i++;
+            }
+
+            size_t questions = wildcard();
+            if (questions) {
+                if (!push(-1))
+                    return std::nullopt;
+            }
+            else {
+                if (i + 1 >= text.size() || hexDigit(text[i]) < 0 || hexDigit(text[i + 1]) < 0 || !push(hexDigit(text[i]) * 16 + hexDigit(text[i + 1])))
+                    return std::nullopt;
+                i += 2;
+            }
+        }
+        else {
+            return std::nullopt;
+        }
+    }
+
+    if (compiled.length == 0)
+        return std::nullopt;
+
+    compiled.anchors = choosePatternAnchors(compiled.bytes.data(), compiled.fixed.data(), compiled.length);
+    return compiled;
+}
+
+// for signatures written into the source, a malformed one is a compile error instead of a failed scan
+consteval CompiledPattern pattern::compileSignature(std::string_view text)
+{
+    auto compiled = compilePattern(text);
+    if (!compiled)
+        invalidSignature();
+    return *compiled;
+}
+
+namespace pattern::literals
+{
+    // auto sig = "48 8B 05 ? ? ? ? 48 85 C0"_sig;
+    consteval CompiledPattern operator""_sig(const char* text, size_t length) {
+        return compileSignature(std::string_view(text, length));
+    }
+}
+
+inline std::optional<PatternInfo> pattern::detectPatternType(const std::string& in)
+{
+    auto trimmedInput = in;
+    trimmedInput.erase(0, trimmedInput.find_first_not_of(" \t\n\r\f\v"));
+    trimmedInput.erase(trimmedInput.find_last_not_of(" \t\n\r\f\v") + 1);
+
+    auto compiled = compilePattern(trimmedInput);
+    if (!compiled) {
+        return std::nullopt;
+    }
+
+    PatternInfo info;
+    info.type = compiled->type;
+    info.pattern = trimmedInput;
+    return info;
+}
@@ -0,0 +1,616 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// everything that touches the target goes through a memorySource, the engines (page cache, scanners, rtti,
+// export parsing) only ever talk to mem::g_Source and never to a platform api directly
+
+enum regionProtect : uint32_t {
+    protect_none = 0,
+    protect_read = 1 << 0,
+    protect_write = 1 << 1,
+    protect_execute = 1 << 2,
+};
+
+enum regionType {
+    region_free,
+    region_image,
+    region_mapped,
+    region_private,
+};
+
+struct memoryRegion {
+    uintptr_t base = 0;
+    uintptr_t size = 0;
+    uint32_t protect = protect_none;
+    regionType type = region_free;
+    bool committed = false;
+};
+
+struct sourceModule {
+    std::string name;
+    uintptr_t base = 0;
+    uintptr_t size = 0;
+};
+
+struct readRequest {
+    uintptr_t address;
+    uintptr_t size;
+    void* dest;
+    bool success = false;
+};
+
+// windows MEM_* / PAGE_* values, spelled out so dumps can be decoded without Windows.h
+inline constexpr uint32_t WIN_MEM_COMMIT = 0x1000;
+inline constexpr uint32_t WIN_MEM_PRIVATE = 0x20000;
+inline constexpr uint32_t WIN_MEM_MAPPED = 0x40000;
+inline constexpr uint32_t WIN_MEM_IMAGE = 0x1000000;
+
+inline regionType fromWinType(uint32_t type) {
+    switch (type) {
+    case WIN_MEM_IMAGE:
+        return region_image;
+    case WIN_MEM_MAPPED:
+        return region_mapped;
+    case WIN_MEM_PRIVATE:
+        return region_private;
+    default:
+        return region_free;
+    }
+}
+
+inline uint32_t fromWinProtect(uint32_t protect) {
+    constexpr uint32_t noAccess = 0x01, guard = 0x100;
+    constexpr uint32_t readable = 0x02 | 0x04 | 0x08 | 0x20 | 0x40 | 0x80; // READONLY, READWRITE, WRITECOPY, EXECUTE_READ/READWRITE/WRITECOPY
+    constexpr uint32_t writable = 0x04 | 0x08 | 0x40 | 0x80;
+    constexpr uint32_t executable = 0x10 | 0x20 | 0x40 | 0x80;
+
+    if (protect & (noAccess | guard)) {
+        return protect_none;
+    }
+
+    uint32_t result = protect_none;
+    if (protect & readable) result |= protect_read;
+    if (protect & writable) result |= protect_write;
+    if (protect & executable) result |= protect_execute;
+    return result;
+}
+
+class memorySource {
+public:
+    virtual ~memorySource() = default;
+
+    virtual bool read(uintptr_t address, void* buf, uintptr_t size) = 0;
+    virtual bool write(uintptr_t address, const void* buf, uintptr_t size) = 0;
+
+    // backends that can scatter/gather in one call override this, the default is one read per request
+    virtual void readBatch(std::vector<readRequest>& requests) {
+        for (auto& request : requests) {
+            request.success = read(request.address, request.dest, request.size);
+        }
+    }
+
+    // fills in the region containing address, unmapped holes are reported as region_free with their extent
+    virtual bool queryRegion(uintptr_t address, memoryRegion* region) = 0;
+    virtual bool getRegions(std::vector<memoryRegion>& regions) = 0;
+    virtual bool getModules(std::vector<sourceModule>& modules) = 0;
+
+    virtual bool isAlive() = 0;
+    virtual bool is32Bit() = 0;
+
+    // backends holding the target in local memory (dumps) hand out pointers instead of copying, nullptr otherwise
+    virtual const uint8_t* view(uintptr_t /*address*/, uintptr_t /*size*/) { return nullptr; }
+
+    // contents never change, caching reads is pointless
+    virtual bool isSnapshot() { return false; }
+};
+
+inline constexpr uintptr_t BATCH_MERGE_GAP = 64; // small holes between requests are read through instead of split
+inline constexpr uintptr_t BATCH_MAX_SPAN = 0x100000; // keeps the scratch buffer of a merged read bounded
+
+// reads many small ranges with as few underlying reads as possible, requests are sorted by address and
+// overlapping or nearby ranges are merged into one read. if a merged read fails its requests are retried
+// one by one, so every request still reports its own success (failed destinations are zeroed).
+// batch(spans) does the merged reads, single(address, buf, size) the retries
+template <typename Batch, typename Single>
+inline bool readMerged(std::vector<readRequest>& requests, Batch&& batch, Single&& single) {
+    std::vector<size_t> order(requests.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&requests](size_t a, size_t b) {
+        return requests[a].address < requests[b].address;
+    });
+
+    struct span {
+        size_t first;
+        size_t last;
+        size_t scratchOffset;
+    };
+
+    std::vector<span> spans;
+    std::vector<readRequest> spanReads;
+    size_t scratchSize = 0;
+
+    size_t groupStart = 0;
+    while (groupStart < order.size()) {
+        auto& first = requests[order[groupStart]];
+        uintptr_t spanStart = first.address;
+        uintptr_t spanEnd = first.address + first.size;
+
+        size_t groupEnd = groupStart + 1;
+        for (; groupEnd < order.size(); groupEnd++) {
+            auto& next = requests[order[groupEnd]];
+            uintptr_t nextEnd = (std::max)(spanEnd, next.address + next.size);
+
+            if (next.address > spanEnd + BATCH_MERGE_GAP || nextEnd - spanStart > BATCH_MAX_SPAN || nextEnd < spanStart) {
+                break;
+            }
+
+            spanEnd = nextEnd;
+        }
+
+        // lone requests are read straight into their destination, merged ones through a shared scratch buffer
+        if (groupEnd - groupStart == 1) {
+            spans.push_back({ groupStart, groupEnd, SIZE_MAX });
+            spanReads.push_back({ first.address, first.size, first.dest });
+        }
+        else {
+            spans.push_back({ groupStart, groupEnd, scratchSize });
+            spanReads.push_back({ spanStart, spanEnd - spanStart, nullptr });
+            scratchSize += spanEnd - spanStart;
+        }
+
+        groupStart = groupEnd;
+    }
+
+    std::vector<uint8_t> scratch(scratchSize);
+    for (size_t i = 0; i < spans.size(); i++) {
+        if (spans[i].scratchOffset != SIZE_MAX) {
+            spanReads[i].dest = scratch.data() + spans[i].scratchOffset;
+        }
+    }
+
+    batch(spanReads);
+
+    for (size_t i = 0; i < spans.size(); i++) {
+        for (size_t j = spans[i].first; j < spans[i].last; j++) {
+            auto& request = requests[order[j]];
+
+            if (spans[i].scratchOffset == SIZE_MAX) {
+                request.success = spanReads[i].success;
+            }
+            else if (spanReads[i].success) {
+                memcpy(request.dest, scratch.data() + spans[i].scratchOffset + (request.address - spanReads[i].address), request.size);
+                request.success = true;
+            }
+            else {
+                // something inside the merged span is unreadable, find out which requests that actually affects
+                request.success = single(request.address, request.dest, request.size);
+            }
+
+            if (!request.success) {
+                memset(request.dest, 0, request.size);
+            }
+        }
+    }
+
+    return std::all_of(requests.begin(), requests.end(), [](const readRequest& request) { return request.success; });
+}
+
+#ifdef _WIN32
+
+#include <Windows.h>
+#include <winternl.h>
+
+typedef NTSTATUS(*_NtQueryInformationProcess)(IN HANDLE ProcessHandle,
+	IN PROCESSINFOCLASS ProcessInformationClass,
+	OUT PVOID ProcessInformation,
+	IN ULONG ProcessInformationLength,
+	OUT PULONG ReturnLength OPTIONAL);
+
+class winProcessSource : public memorySource {
+public:
+    winProcessSource(DWORD pid);
+    ~winProcessSource() override;
+
+    bool valid() const { return handle != nullptr; }
+
+    bool read(uintptr_t address, void* buf, uintptr_t size) override;
+    bool write(uintptr_t address, const void* buf, uintptr_t size) override;
+    bool queryRegion(uintptr_t address, memoryRegion* region) override;
+    bool getRegions(std::vector<memoryRegion>& regions) override;
+    bool getModules(std::vector<sourceModule>& modules) override;
+    bool isAlive() override;
+    bool is32Bit() override;
+
+private:
+    HANDLE handle = nullptr;
+
+    uintptr_t getPEB();
+    static void toRegion(const MEMORY_BASIC_INFORMATION& mbi, memoryRegion* region);
+};
+
+inline winProcessSource::winProcessSource(DWORD pid) {
+    handle = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ | PROCESS_VM_WRITE, FALSE, pid);
+}
+
+inline winProcessSource::~winProcessSource() {
+    if (handle && handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(handle);
+    }
+}
+
+inline bool winProcessSource::read(uintptr_t address, void* buf, uintptr_t size) {
+    SIZE_T sizeRead;
+    return ReadProcessMemory(handle, reinterpret_cast<LPCVOID>(address), buf, size, &sizeRead);
+}
+
+inline bool winProcessSource::write(uintptr_t address, const void* buf, uintptr_t size) {
+    SIZE_T sizeWritten;
+    return WriteProcessMemory(handle, reinterpret_cast<LPVOID>(address), buf, size, &sizeWritten);
+}
+
+inline void winProcessSource::toRegion(const MEMORY_BASIC_INFORMATION& mbi, memoryRegion* region) {
+    region->base = reinterpret_cast<uintptr_t>(mbi.BaseAddress);
+    region->size = mbi.RegionSize;
+    region->committed = (mbi.State == MEM_COMMIT);
+    region->type = fromWinType(mbi.Type);
+    region->protect = region->committed ? fromWinProtect(mbi.Protect) : protect_none;
+}
+
+inline bool winProcessSource::queryRegion(uintptr_t address, memoryRegion* region) {
+    MEMORY_BASIC_INFORMATION mbi;
+    if (!VirtualQueryEx(handle, reinterpret_cast<LPCVOID>(address), &mbi, sizeof(mbi))) {
+        return false;
+    }
+
+    toRegion(mbi, region);
+    return true;
+}
+
+inline bool winProcessSource::getRegions(std::vector<memoryRegion>& regions) {
+    regions.clear();
+
+    uintptr_t address = 0;
+    MEMORY_BASIC_INFORMATION mbi;
+    while (VirtualQueryEx(handle, reinterpret_cast<LPCVOID>(address), &mbi, sizeof(mbi))) {
+        memoryRegion region;
+        toRegion(mbi, &region);
+
+        if (region.type != region_free) {
+            regions.push_back(region);
+        }
+
+        uintptr_t next = region.base + region.size;
+        if (next <= address) {
+            break;
+        }
+        address = next;
+    }
+
+    return !regions.empty();
+}
+
+inline uintptr_t winProcessSource::getPEB()
+{
+    PROCESS_BASIC_INFORMATION processInformation;
+    ULONG written = 0;
+
+    HMODULE hNtdll = GetModuleHandleA("ntdll.dll");
+
+    static _NtQueryInformationProcess query = (_NtQueryInformationProcess)GetProcAddress(hNtdll, "NtQueryInformationProcess");
+
+    NTSTATUS result = query(handle, ProcessBasicInformation, &processInformation, sizeof(PROCESS_BASIC_INFORMATION), &written);
+
+    return reinterpret_cast<uintptr_t>(processInformation.PebBaseAddress);
+}
+
+inline bool winProcessSource::getModules(std::vector<sourceModule>& modules) {
+	modules.clear();
+
+	uintptr_t pebAddress = getPEB();
+	if (pebAddress == NULL)
+		return false;
+
+	uintptr_t PEBldrAddress = pebAddress + offsetof(PEB, PEB::Ldr);
+	uintptr_t PEBldr = 0;
+	read(PEBldrAddress, &PEBldr, sizeof(uintptr_t));
+
+	uintptr_t moduleListHead = PEBldr + offsetof(PEB_LDR_DATA, PEB_LDR_DATA::InMemoryOrderModuleList);
+	uintptr_t currentLink = 0;
+	read(moduleListHead, &currentLink, sizeof(uintptr_t));
+
+	while (currentLink != moduleListHead)
+	{
+		uintptr_t entryBase = currentLink - offsetof(LDR_DATA_TABLE_ENTRY, InMemoryOrderLinks);
+
+		// https://www.geoffchappell.com/studies/windows/km/ntoskrnl/inc/api/ntldr/ldr_data_table_entry.htm
+		// BaseDllName is immediately after FullDllName
+		UNICODE_STRING dllString;
+		uintptr_t linkDllNameAddress = entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::FullDllName) + sizeof(UNICODE_STRING);
+		read(linkDllNameAddress, &dllString, sizeof(UNICODE_STRING));
+
+		size_t charCount = (dllString.Length / sizeof(wchar_t)) + 1;
+		std::vector<wchar_t> dllName(charCount, L'\0');
+		read(reinterpret_cast<uintptr_t>(dllString.Buffer), dllName.data(), dllString.Length);
+
+		uintptr_t baseAddress = 0;
+		read(entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::DllBase), &baseAddress, sizeof(baseAddress));
+
+		ULONG moduleSize = 0;
+		// reserved in winternl but SizeOfImage
+		read(entryBase + offsetof(LDR_DATA_TABLE_ENTRY, LDR_DATA_TABLE_ENTRY::DllBase) + 0x10, &moduleSize, sizeof(moduleSize));
+
+		std::wstring lDllNameW(dllName.data());
+		sourceModule info;
+		info.name = std::string(lDllNameW.begin(), lDllNameW.end());
+		info.base = baseAddress;
+		info.size = moduleSize;
+		modules.push_back(info);
+
+		if (!read(currentLink, &currentLink, sizeof(currentLink))) {
+			break;
+		}
+	}
+
+	return true;
+}
+
+inline bool winProcessSource::isAlive() {
+    DWORD exitCode;
+    return GetExitCodeProcess(handle, &exitCode) && exitCode == STILL_ACTIVE;
+}
+
+inline bool winProcessSource::is32Bit() {
+    BOOL wow64 = FALSE;
+    if (!IsWow64Process(handle, &wow64)) {
+        return false;
+    }
+
+    return wow64;
+}
+
+#endif
+
+#ifdef __linux__
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <signal.h>
+#include <sstream>
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// lets the engines run against live processes on linux analysis boxes, regions and modules come from
+// /proc/<pid>/maps and reads use process_vm_readv with as many iovecs per call as the kernel allows
+class linuxProcessSource : public memorySource {
+public:
+    linuxProcessSource(pid_t pid) : pid(pid) {}
+
+    bool valid() { return isAlive(); }
+
+    bool read(uintptr_t address, void* buf, uintptr_t size) override;
+    bool write(uintptr_t address, const void* buf, uintptr_t size) override;
+    void readBatch(std::vector<readRequest>& requests) override;
+    bool queryRegion(uintptr_t address, memoryRegion* region) override;
+    bool getRegions(std::vector<memoryRegion>& regions) override;
+    bool getModules(std::vector<sourceModule>& modules) override;
+    bool isAlive() override;
+    bool is32Bit() override;
+
+private:
+    struct mapping {
+        memoryRegion region;
+        std::string path;
+    };
+
+    pid_t pid;
+    std::mutex mapsMutex;
+    std::shared_ptr<const std::vector<mapping>> maps;
+    std::chrono::steady_clock::time_point mapsTime;
+
+    static constexpr std::chrono::milliseconds MAPS_INTERVAL{ 250 };
+
+    bool parseMaps(std::vector<mapping>& out);
+    std::shared_ptr<const std::vector<mapping>> currentMaps();
+};
+
+inline bool linuxProcessSource::read(uintptr_t address, void* buf, uintptr_t size) {
+    iovec local{ buf, size };
+    iovec remote{ reinterpret_cast<void*>(address), size };
+    return process_vm_readv(pid, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(size);
+}
+
+inline bool linuxProcessSource::write(uintptr_t address, const void* buf, uintptr_t size) {
+    iovec local{ const_cast<void*>(buf), size };
+    iovec remote{ reinterpret_cast<void*>(address), size };
+    return process_vm_writev(pid, &local, 1, &remote, 1, 0) == static_cast<ssize_t>(size);
+}
+
+inline void linuxProcessSource::readBatch(std::vector<readRequest>& requests) {
+    std::vector<iovec> local;
+    std::vector<iovec> remote;
+
+    size_t next = 0;
+    while (next < requests.size()) {
+        size_t count = (std::min)(requests.size() - next, static_cast<size_t>(IOV_MAX));
+
+        local.clear();
+        remote.clear();
+        for (size_t i = next; i < next + count; i++) {
+            local.push_back({ requests[i].dest, requests[i].size });
+            remote.push_back({ reinterpret_cast<void*>(requests[i].address), requests[i].size });
+        }
+
+        // the kernel stops at the first remote iovec it can't read, everything before it is complete
+        ssize_t transferred = process_vm_readv(pid, local.data(), count, remote.data(), count, 0);
+        size_t done = transferred > 0 ? static_cast<size_t>(transferred) : 0;
+
+        size_t i = next;
+        for (; i < next + count && done >= requests[i].size; i++) {
+            requests[i].success = true;
+            done -= requests[i].size;
+        }
+
+        // the request that stopped the transfer failed, retry everything after it in the next call
+        if (i < next + count) {
+            requests[i].success = read(requests[i].address, requests[i].dest, requests[i].size);
+            i++;
+        }
+
+        next = i;
+    }
+}
+
+inline bool linuxProcessSource::parseMaps(std::vector<mapping>& out) {
+    std::ifstream file("/proc/" + std::to_string(pid) + "/maps");
+    if (!file) {
+        return false;
+    }
+
+    out.clear();
+
+    std::string line;
+    while (std::getline(file, line)) {
+        // 7f0000000000-7f0000001000 r-xp 00000000 08:01 1234    /usr/lib/libc.so.6
+        std::istringstream stream(line);
+        std::string range, perms, offset, device, inode;
+        stream >> range >> perms >> offset >> device >> inode;
+
+        size_t dash = range.find('-');
+        if (dash == std::string::npos || perms.size() < 4) {
+            continue;
+        }
+
+        mapping entry;
+        uintptr_t start = std::stoull(range.substr(0, dash), nullptr, 16);
+        uintptr_t end = std::stoull(range.substr(dash + 1), nullptr, 16);
+        entry.region.base = start;
+        entry.region.size = end - start;
+        entry.region.committed = true;
+
+        if (perms[0] == 'r') entry.region.protect |= protect_read;
+        if (perms[1] == 'w') entry.region.protect |= protect_write;
+        if (perms[2] == 'x') entry.region.protect |= protect_execute;
+
+        std::getline(stream >> std::ws, entry.path);
+
+        if (!entry.path.empty() && entry.path[0] == '/') {
+            entry.region.type = (perms[3] == 's') ? region_mapped : region_image;
+        }
+        else {
+            entry.region.type = region_private;
+        }
+
+        out.push_back(std::move(entry));
+    }
+
+    return true;
+}
+
+// maps are re-parsed at most every MAPS_INTERVAL, queryRegion is called far too often to read the file each time
+inline std::shared_ptr<const std::vector<linuxProcessSource::mapping>> linuxProcessSource::currentMaps() {
+    std::lock_guard lock(mapsMutex);
+
+    auto now = std::chrono::steady_clock::now();
+    if (!maps || now - mapsTime > MAPS_INTERVAL) {
+        auto parsed = std::make_shared<std::vector<mapping>>();
+        parseMaps(*parsed);
+        maps = parsed;
+        mapsTime = now;
+    }
+
+    return maps;
+}
+
+inline bool linuxProcessSource::queryRegion(uintptr_t address, memoryRegion* region) {
+    auto current = currentMaps();
+    if (current->empty()) {
+        return false;
+    }
+
+    uintptr_t holeStart = 0;
+    for (auto& entry : *current) {
+        if (address < entry.region.base) {
+            region->base = holeStart;
+            region->size = entry.region.base - holeStart;
+            region->protect = protect_none;
+            region->type = region_free;
+            region->committed = false;
+            return true;
+        }
+
+        if (address < entry.region.base + entry.region.size) {
+            *region = entry.region;
+            return true;
+        }
+
+        holeStart = entry.region.base + entry.region.size;
+    }
+
+    region->base = holeStart;
+    region->size = UINTPTR_MAX - holeStart;
+    region->protect = protect_none;
+    region->type = region_free;
+    region->committed = false;
+    return true;
+}
+
+inline bool linuxProcessSource::getRegions(std::vector<memoryRegion>& regions) {
+    regions.clear();
+    for (auto& entry : *currentMaps()) {
+        regions.push_back(entry.region);
+    }
+
+    return !regions.empty();
+}
+
+inline bool linuxProcessSource::getModules(std::vector<sourceModule>& modules) {
+    modules.clear();
+
+    std::string lastPath;
+    for (auto& entry : *currentMaps()) {
+        if (entry.region.type != region_image) {
+            continue;
+        }
+
+        // a shared object is several consecutive mappings of the same file
+        if (!modules.empty() && entry.path == lastPath) {
+            auto& module = modules.back();
+            module.size = entry.region.base + entry.region.size - module.base;
+            continue;
+        }
+
+        lastPath = entry.path;
+        modules.push_back({ entry.path.substr(entry.path.find_last_of('/') + 1), entry.region.base, entry.region.size });
+    }
+
+    return !modules.empty();
+}
+
+inline bool linuxProcessSource::isAlive() {
+    return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+inline bool linuxProcessSource::is32Bit() {
+    std::ifstream file("/proc/" + std::to_string(pid) + "/exe", std::ios::binary);
+    char ident[5] = { 0 };
+    if (!file.read(ident, sizeof(ident))) {
+        return false;
+    }
+
+    // EI_CLASS, 1 = ELFCLASS32
+    return memcmp(ident, "\x7f" "ELF", 4) == 0 && ident[4] == 1;
+}
+
+#endif
@@ -0,0 +1,353 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "source.h"
+#include "matcher.h"
+
+// searches for text the way it sits in memory rather than as a byte pattern. the query is encoded once per
+// encoding asked for and each form is searched for on its own, a simd pass compares the first and last character
+// of it against every offset (both cases at once) and only the offsets that pass get a full compare. case folding
+// covers ascii and the latin-1 letters, whose two cases differ in a single bit in every encoding here
+
+enum stringEncoding : uint8_t {
+    encoding_ascii = 1,
+    encoding_utf8 = 2, // only searched for on its own when the query isn't plain ascii, else it's the same bytes
+    encoding_utf16 = 4, // little endian
+};
+
+constexpr const char* encodingName(stringEncoding encoding) {
+    switch (encoding) {
+    case encoding_ascii:
+        return "ASCII";
+    case encoding_utf8:
+        return "UTF-8";
+    case encoding_utf16:
+        return "UTF-16LE";
+    default:
+        return "?";
+    }
+}
+
+struct stringSearchOptions {
+    uint8_t encodings = encoding_ascii | encoding_utf16;
+    bool caseInsensitive = false;
+    bool wholeWord = false; // no letter, digit or _ right before or after the match
+};
+
+struct stringMatch {
+    uintptr_t address;
+    uint32_t length; // in bytes
+    stringEncoding encoding;
+};
+
+// letters whose other case is the same code point with 0x20 flipped, in utf-16 and in the last byte of utf-8
+constexpr bool isFoldableLetter(uint32_t codepoint) {
+    if ((codepoint | 0x20) >= 'a' && (codepoint | 0x20) <= 'z') {
+        return true;
+    }
+    return codepoint >= 0xC0 && codepoint <= 0xFE && codepoint != 0xD7 && codepoint != 0xDF && codepoint != 0xF7;
+}
+
+constexpr bool isWordUnit(uint32_t unit) {
+    if (unit >= 0x80) {
+        return true; // part of a letter in every encoding here, near enough
+    }
+    return ((unit | 0x20) >= 'a' && (unit | 0x20) <= 'z') || (unit >= '0' && unit <= '9') || unit == '_';
+}
+
+// utf-8 to code points, false on anything malformed
+inline bool decodeUtf8(std::string_view text, std::vector<uint32_t>& out) {
+    out.clear();
+    for (size_t i = 0; i < text.size();) {
+        uint8_t lead = static_cast<uint8_t>(text[i]);
+        size_t extra = lead < 0x80 ? 0 : (lead & 0xE0) == 0xC0 ? 1 : (lead & 0xF0) == 0xE0 ? 2 : (lead & 0xF8) == 0xF0 ? 3 : 4;
+        if (extra == 4 || i + extra >= text.size()) {
+            return false;
+        }
+
+        uint32_t codepoint = extra ? lead & (0x3F >> extra) : lead;
+        for (size_t k = 1; k <= extra; k++) {
+            uint8_t next = static_cast<uint8_t>(text[i + k]);
+            if ((next & 0xC0) != 0x80) {
+                return false;
+            }
+            codepoint = (codepoint << 6) | (next & 0x3F);
+        }
+        out.push_back(codepoint);
+        i += extra + 1;
+    }
+    return true;
+}
+
+// one encoded form of a query
+class stringMatcher {
+public:
+    // folds holds 0x20 where the byte's case doesn't matter
+    stringMatcher(std::vector<uint8_t> text, std::vector<uint8_t> folds, stringEncoding encoding, bool wholeWord);
+
+    size_t length() const { return bytes.size(); }
+    stringEncoding encoding() const { return kind; }
+
+    // appends every match in data in ascending order. the whole word check looks at the bytes around a match, at
+    // either end of data it takes the edge as a word border
+    void find(const uint8_t* data, size_t size, uintptr_t base, std::vector<stringMatch>& out, simdLevel level = bestSimdLevel()) const;
+
+private:
+    std::vector<uint8_t> bytes; // with the fold bits already set
+    std::vector<uint8_t> folds;
+    stringEncoding kind;
+    size_t unit; // 1 or 2
+    bool wholeWord;
+    size_t secondAnchor; // the last character, or the high byte of a lone utf-16 one
+
+    bool matchesAt(const uint8_t* data, size_t size, size_t offset) const;
+    bool isWordAt(const uint8_t* data, size_t size, size_t offset) const;
+    void findScalar(const uint8_t* data, size_t size, size_t begin, uintptr_t base, std::vector<stringMatch>& out) const;
+
+#ifdef IMCLASS_SSE2
+    size_t findSse2(const uint8_t* data, size_t size, uintptr_t base, std::vector<stringMatch>& out) const;
+    IMCLASS_TARGET_AVX2 size_t findAvx2(const uint8_t* data, size_t size, uintptr_t base, std::vector<stringMatch>& out) const;
+#endif
+};
+
+inline stringMatcher::stringMatcher(std::vector<uint8_t> text, std::vector<uint8_t> foldBits, stringEncoding encoding, bool word)
+    : bytes(std::move(text)), folds(std::move(foldBits)), kind(encoding), unit(encoding == encoding_utf16 ? 2 : 1), wholeWord(word) {
+    for (size_t i = 0; i < bytes.size(); i++) {
+        bytes[i] |= folds[i];
+    }
+    secondAnchor = bytes.size() > unit ? bytes.size() - unit : bytes.size() - 1;
+}
+
+inline bool stringMatcher::isWordAt(const uint8_t* data, size_t size, size_t offset) const {
+    if (offset + unit > size) {
+        return false;
+    }
+    return isWordUnit(unit == 2 ? data[offset] | (data[offset + 1] << 8) : data[offset]);
+}
+
+inline bool stringMatcher::matchesAt(const uint8_t* data, size_t size, size_t offset) const {
+    for (size_t i = 0; i < bytes.size(); i++) {
+        if ((data[offset + i] | folds[i]) != bytes[i]) {
+            return false;
+        }
+    }
+
+    if (wholeWord) {
+        if (offset >= unit && isWordAt(data, size, offset - unit)) {
+            return false;
+        }
+        if (isWordAt(data, size, offset + bytes.size())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline void stringMatcher::findScalar(const uint8_t* data, size_t size, size_t begin, uintptr_t base, std::vector<stringMatch>& out) const {
+    for (size_t i = begin; i + bytes.size() <= size; i++) {
+        if ((data[i] | folds[0]) == bytes[0] && matchesAt(data, size, i)) {
+            out.push_back({ base + i, static_cast<uint32_t>(bytes.size()), kind });
+        }
+    }
+}
+
+inline void stringMatcher::find(const uint8_t* data, size_t size, uintptr_t base, std::vector<stringMatch>& out, simdLevel level) const {
+    if (bytes.empty() || size < bytes.size()) {
+        return;
+    }
+
+    size_t begin = 0;
+
+#ifdef IMCLASS_SSE2
+    if (level >= simd_avx2) {
+        begin = findAvx2(data, size, base, out);
+    }
+    else if (level >= simd_sse2) {
+        begin = findSse2(data, size, base, out);
+    }
+#endif
+
+    findScalar(data, size, begin, base, out);
+}
+
+#ifdef IMCLASS_SSE2
+// same shape as patternMatcher's, with an or in front of each compare so one compare takes both cases
+inline size_t stringMatcher::findSse2(const uint8_t* data, size_t size, uintptr_t base, std::vector<stringMatch>& out) const {
+    const size_t last = size - bytes.size();
+    const __m128i first = _mm_set1_epi8(static_cast<char>(bytes[0]));
+    const __m128i firstFold = _mm_set1_epi8(static_cast<char>(folds[0]));
+    const __m128i second = _mm_set1_epi8(static_cast<char>(bytes[secondAnchor]));
+    const __m128i secondFold = _mm_set1_epi8(static_cast<char>(folds[secondAnchor]));
+
+    size_t i = 0;
+    for (; i <= last && i + secondAnchor + 16 <= size; i += 16) {
+        __m128i head = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)), firstFold);
+        __m128i tail = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + secondAnchor)), secondFold);
+        unsigned hits = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(head, first), _mm_cmpeq_epi8(tail, second)));
+
+        while (hits) {
+            size_t offset = i + std::countr_zero(hits);
+            hits &= hits - 1;
+            if (offset > last) {
+                break;
+            }
+            if (matchesAt(data, size, offset)) {
+                out.push_back({ base + offset, static_cast<uint32_t>(bytes.size()), kind });
+            }
+        }
+    }
+    return i;
+}
+
+IMCLASS_TARGET_AVX2 inline size_t stringMatcher::findAvx2(const uint8_t* data, size_t size, uintptr_t base, std::vector<stringMatch>& out) const {
+    const size_t last = size - bytes.size();
+    const __m256i first = _mm256_set1_epi8(static_cast<char>(bytes[0]));
+    const __m256i firstFold = _mm256_set1_epi8(static_cast<char>(folds[0]));
+    const __m256i second = _mm256_set1_epi8(static_cast<char>(bytes[secondAnchor]));
+    const __m256i secondFold = _mm256_set1_epi8(static_cast<char>(folds[secondAnchor]));
+
+    size_t i = 0;
+    for (; i <= last && i + secondAnchor + 32 <= size; i += 32) {
+        __m256i head = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)), firstFold);
+        __m256i tail = _mm256_or_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + secondAnchor)), secondFold);
+        uint32_t hits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(head, first), _mm256_cmpeq_epi8(tail, second))));
+
+        while (hits) {
+            size_t offset = i + std::countr_zero(hits);
+            hits &= hits - 1;
+            if (offset > last) {
+                break;
+            }
+            if (matchesAt(data, size, offset)) {
+                out.push_back({ base + offset, static_cast<uint32_t>(bytes.size()), kind });
+            }
+        }
+    }
+    return i;
+}
+#endif
+
+// one matcher per encoding the query can be written in, none if it's empty or not valid utf-8
+inline std::vector<stringMatcher> compileStringQuery(std::string_view query, const stringSearchOptions& options) {
+    std::vector<stringMatcher> result;
+
+    std::vector<uint32_t> codepoints;
+    if (query.empty() || !decodeUtf8(query, codepoints)) {
+        return result;
+    }
+
+    bool ascii = std::all_of(codepoints.begin(), codepoints.end(), [](uint32_t codepoint) { return codepoint < 0x80; });
+    auto fold = [&](uint32_t codepoint) -> uint8_t { return options.caseInsensitive && isFoldableLetter(codepoint) ? 0x20 : 0; };
+
+    // a plain ascii query is the same bytes in utf-8, it's searched for once and labelled ascii
+    bool singleByte = ascii && (options.encodings & encoding_ascii);
+    if (singleByte || (options.encodings & encoding_utf8)) {
+        std::vector<uint8_t> bytes, folds;
+        for (uint32_t codepoint : codepoints) {
+            uint8_t encoded[4];
+            size_t count = 0;
+            if (codepoint < 0x80) {
+                encoded[count++] = static_cast<uint8_t>(codepoint);
+            }
+            else if (codepoint < 0x800) {
+                encoded[count++] = static_cast<uint8_t>(0xC0 | (codepoint >> 6));
+                encoded[count++] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            }
+            else if (codepoint < 0x10000) {
+                encoded[count++] = static_cast<uint8_t>(0xE0 | (codepoint >> 12));
+                encoded[count++] = static_cast<uint8_t>(0x80 | ((codepoint >> 6) & 0x3F));
+                encoded[count++] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            }
+            else {
+                encoded[count++] = static_cast<uint8_t>(0xF0 | (codepoint >> 18));
+                encoded[count++] = static_cast<uint8_t>(0x80 | ((codepoint >> 12) & 0x3F));
+                encoded[count++] = static_cast<uint8_t>(0x80 | ((codepoint >> 6) & 0x3F));
+                encoded[count++] = static_cast<uint8_t>(0x80 | (codepoint & 0x3F));
+            }
+
+            for (size_t k = 0; k < count; k++) {
+                bytes.push_back(encoded[k]);
+                folds.push_back(k == count - 1 ? fold(codepoint) : 0);
+            }
+        }
+        result.emplace_back(std::move(bytes), std::move(folds), singleByte ? encoding_ascii : encoding_utf8, options.wholeWord);
+    }
+
+    if (options.encodings & encoding_utf16) {
+        std::vector<uint8_t> bytes, folds;
+        auto push = [&](uint32_t value, uint8_t foldBit) {
+            bytes.push_back(static_cast<uint8_t>(value));
+            bytes.push_back(static_cast<uint8_t>(value >> 8));
+            folds.push_back(foldBit);
+            folds.push_back(0);
+        };
+
+        for (uint32_t codepoint : codepoints) {
+            if (codepoint >= 0x10000) {
+                push(0xD800 | ((codepoint - 0x10000) >> 10), 0);
+                push(0xDC00 | ((codepoint - 0x10000) & 0x3FF), 0);
+            }
+            else {
+                push(codepoint, fold(codepoint));
+            }
+        }
+        result.emplace_back(std::move(bytes), std::move(folds), encoding_utf16, options.wholeWord);
+    }
+
+    return result;
+}
+
+// all matchers in one streamed pass, sorted by address. a chunk that follows another in the same range is read from
+// a character earlier and with one more after its overlap, so the whole word check sees past both of its ends
+inline std::vector<stringMatch> findStrings(memorySource& source, const std::vector<scanRange>& ranges, const std::vector<stringMatcher>& matchers,
+    const patternScanOptions& options = {}) {
+    std::vector<stringMatch> result;
+
+    size_t length = 0;
+    for (auto& matcher : matchers) {
+        length = (std::max)(length, matcher.length());
+    }
+    if (length == 0) {
+        return result;
+    }
+
+    constexpr uintptr_t context = 2; // the widest character
+    auto chunks = splitChunks(ranges, length - 1 + context, options);
+
+    // the chunk before is in the same range when it was read past its end, the last one of a range never is. a
+    // range that starts where the one before ended still starts at a border
+    std::vector<uintptr_t> owned(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++) {
+        owned[i] = chunks[i].start;
+        if (i > 0 && chunks[i - 1].end == chunks[i].start && chunks[i - 1].span > chunks[i - 1].end - chunks[i - 1].start) {
+            chunks[i].start -= context;
+            chunks[i].span += context;
+        }
+    }
+
+    std::vector<std::vector<stringMatch>> chunkMatches(chunks.size());
+
+    scanChunks(source, chunks, options, [&](size_t chunk, const uint8_t* data, uintptr_t runSize, uintptr_t address, uintptr_t end) {
+        auto& matches = chunkMatches[chunk];
+        size_t before = matches.size();
+
+        for (auto& matcher : matchers) {
+            matcher.find(data, runSize, address, matches);
+        }
+
+        matches.erase(std::remove_if(matches.begin() + before, matches.end(), [&](const stringMatch& match) {
+            return match.address < owned[chunk] || match.address >= end;
+        }), matches.end());
+        std::sort(matches.begin() + before, matches.end(), [](const stringMatch& a, const stringMatch& b) { return a.address < b.address; });
+    });
+
+    for (auto& matches : chunkMatches) {
+        result.insert(result.end(), matches.begin(), matches.end());
+    }
+    return result;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// every export of every module ends up in here, 100k+ entries on a typical target. names live back to back
+// in one arena, entries are a flat array sorted by address for reverse lookup and (module, name) pairs are
+// found through an open addressing table of entry indices
+
+struct symbolEntry {
+    uintptr_t address;
+    uint32_t nameOffset; // into the arena
+    uint16_t nameLength;
+    uint16_t module; // index into modules
+};
+
+class symbolTable {
+public:
+    void clear();
+    void reserve(size_t count, size_t nameBytes); // room for this many more
+
+    // a copy with only the entries keep(entry) returns true for, names repacked. it isn't finalized yet so the
+    // exports of modules loaded since can be added first
+    template <typename Fn>
+    symbolTable filtered(Fn&& keep) const;
+
+    uint16_t addModule(std::string_view name);
+    void add(uint16_t module, std::string_view name, uintptr_t address);
+    void finalize(); // sorts and builds the hash index, lookups are only valid after this
+
+    const symbolEntry* find(uintptr_t address) const;
+    std::optional<uintptr_t> lookup(std::string_view module, std::string_view name) const;
+
+    std::string_view nameOf(const symbolEntry& entry) const;
+    std::string_view moduleOf(const symbolEntry& entry) const;
+    std::string format(const symbolEntry& entry) const; // module!name
+
+    size_t size() const { return entries.size(); }
+
+private:
+    static constexpr uint32_t EMPTY_SLOT = UINT32_MAX;
+
+    std::vector<char> arena;
+    std::vector<symbolEntry> entries;
+    std::vector<std::pair<uint32_t, uint16_t>> modules; // arena offset and length of each module name
+    std::unordered_map<std::string, uint16_t> moduleIndex; // lowercase name, module names are case insensitive
+    std::vector<uint32_t> slots;
+
+    uint32_t intern(std::string_view str);
+    static std::string lower(std::string_view str);
+    static size_t hash(uint16_t module, std::string_view name);
+};
+
+inline void symbolTable::clear() {
+    arena.clear();
+    entries.clear();
+    modules.clear();
+    moduleIndex.clear();
+    slots.clear();
+}
+
+inline void symbolTable::reserve(size_t count, size_t nameBytes) {
+    entries.reserve(entries.size() + count);
+    arena.reserve(arena.size() + nameBytes);
+}
+
+template <typename Fn>
+inline symbolTable symbolTable::filtered(Fn&& keep) const {
+    symbolTable result;
+    std::vector<uint16_t> moduleMap(modules.size(), UINT16_MAX);
+
+    for (auto& entry : entries) {
+        if (!keep(entry)) {
+            continue;
+        }
+
+        auto& module = moduleMap[entry.module];
+        if (module == UINT16_MAX) {
+            module = result.addModule(moduleOf(entry));
+        }
+        result.add(module, nameOf(entry), entry.address);
+    }
+    return result;
+}
+
+inline std::string symbolTable::lower(std::string_view str) {
+    std::string result(str);
+    std::transform(result.begin(), result.end(), result.begin(), [](unsigned char c) { return static_cast<char>(tolower(c)); });
+    return result;
+}
+
+inline uint32_t symbolTable::intern(std::string_view str) {
+    uint32_t offset = static_cast<uint32_t>(arena.size());
+    arena.insert(arena.end(), str.begin(), str.end());
+    return offset;
+}
+
+inline uint16_t symbolTable::addModule(std::string_view name) {
+    auto key = lower(name);
+    auto it = moduleIndex.find(key);
+    if (it != moduleIndex.end()) {
+        return it->second;
+    }
+
+    uint16_t index = static_cast<uint16_t>(modules.size());
+    modules.push_back({ intern(name), static_cast<uint16_t>(name.size()) });
+    moduleIndex.emplace(std::move(key), index);
+    return index;
+}
+
+inline void symbolTable::add(uint16_t module, std::string_view name, uintptr_t address) {
+    name = name.substr(0, UINT16_MAX);
+    entries.push_back({ address, intern(name), static_cast<uint16_t>(name.size()), module });
+}
+
+// fnv-1a over the name, seeded with the module so the same export in two modules lands apart
+inline size_t symbolTable::hash(uint16_t module, std::string_view name) {
+    uint64_t result = 0xcbf29ce484222325ull ^ module;
+    for (char c : name) {
+        result ^= static_cast<uint8_t>(c);
+        result *= 0x100000001b3ull;
+    }
+    return static_cast<size_t>(result ^ (result >> 32));
+}
+
+inline void symbolTable::finalize() {
+    std::stable_sort(entries.begin(), entries.end(), [](const symbolEntry& a, const symbolEntry& b) { return a.address < b.address; });
+
+    size_t capacity = 16;
+    while (capacity < entries.size() * 2) {
+        capacity <<= 1;
+    }
+
+    slots.assign(capacity, EMPTY_SLOT);
+    for (uint32_t i = 0; i < entries.size(); i++) {
+        size_t slot = hash(entries[i].module, nameOf(entries[i])) & (capacity - 1);
+        while (slots[slot] != EMPTY_SLOT) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        slots[slot] = i;
+    }
+}
+
+inline const symbolEntry* symbolTable::find(uintptr_t address) const {
+    auto it = std::lower_bound(entries.begin(), entries.end(), address, [](const symbolEntry& entry, uintptr_t value) {
+        return entry.address < value;
+    });
+
+    if (it == entries.end() || it->address != address) {
+        return nullptr;
+    }
+
+    return &*it;
+}
+
+inline std::optional<uintptr_t> symbolTable::lookup(std::string_view module, std::string_view name) const {
+    auto it = moduleIndex.find(lower(module));
+    if (it == moduleIndex.end() || slots.empty()) {
+        return std::nullopt;
+    }
+
+    size_t mask = slots.size() - 1;
+    for (size_t slot = hash(it->second, name) & mask; slots[slot] != EMPTY_SLOT; slot = (slot + 1) & mask) {
+        auto& entry = entries[slots[slot]];
+        if (entry.module == it->second && nameOf(entry) == name) {
+            return entry.address;
+        }
+    }
+
+    return std::nullopt;
+}
+
+inline std::string_view symbolTable::nameOf(const symbolEntry& entry) const {
+    return std::string_view(arena.data() + entry.nameOffset, entry.nameLength);
+}
+
+inline std::string_view symbolTable::moduleOf(const symbolEntry& entry) const {
+    auto& module = modules[entry.module];
+    return std::string_view(arena.data() + module.first, module.second);
+}
+
+inline std::string symbolTable::format(const symbolEntry& entry) const {
+    std::string result;
+    result.reserve(modules[entry.module].second + 1 + entry.nameLength);
+    result.append(moduleOf(entry));
+    result += '!';
+    result.append(nameOf(entry));
+    return result;
+}
@@ -0,0 +1,170 @@
+#include <algorithm>
+#include <set>
+#include <tuple>
+
+#include "exports.h"
+#include "testimage.h"
+#include "testsource.h"
+
+// readModuleExports against the exports the synthetic images were built with, then attach-time export gathering
+// over 200 modules compared with the old reader (a read per table and one per name) at a fixed cost per read
+
+using exportKey = std::tuple<std::string, uintptr_t, uint32_t, std::string>;
+
+static std::vector<exportKey> expectedExports(const testImage& image, uintptr_t base) {
+    std::vector<exportKey> result;
+    for (auto& entry : image.exports) {
+        std::string name = entry.name.empty() ? std::string("#").append(std::to_string(entry.ordinal)) : entry.name;
+        result.push_back({ name, entry.forwarder.empty() ? base + entry.rva : 0, entry.ordinal, entry.forwarder });
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+static std::vector<exportKey> keysOf(const std::vector<funcExport>& exports) {
+    std::vector<exportKey> result;
+    for (auto& entry : exports) {
+        result.push_back({ entry.name, entry.address, entry.ordinal, entry.forwarder });
+    }
+    std::sort(result.begin(), result.end());
+    return result;
+}
+
+// what gatherRemoteExports did before: headers, directory and tables one read each, then a read per name
+static std::vector<std::pair<std::string, uintptr_t>> oldExports(memorySource& source, uintptr_t base) {
+    std::vector<std::pair<std::string, uintptr_t>> exports;
+
+    uint8_t dos[64];
+    uint8_t nt[264];
+    if (!source.read(base, dos, sizeof(dos)) || !source.read(base + *reinterpret_cast<int32_t*>(dos + 0x3C), nt, sizeof(nt))) {
+        return exports;
+    }
+
+    uint32_t directoryRva = *reinterpret_cast<uint32_t*>(nt + 24 + 112);
+    pe::exportDirectory directory;
+    if (!source.read(base + directoryRva, &directory, sizeof(directory))) {
+        return exports;
+    }
+
+    std::vector<uint32_t> functions(directory.numberOfFunctions), names(directory.numberOfNames);
+    std::vector<uint16_t> ordinals(directory.numberOfNames);
+    source.read(base + directory.addressOfFunctions, functions.data(), functions.size() * 4);
+    source.read(base + directory.addressOfNames, names.data(), names.size() * 4);
+    source.read(base + directory.addressOfNameOrdinals, ordinals.data(), ordinals.size() * 2);
+
+    for (uint32_t i = 0; i < directory.numberOfNames; i++) {
+        char name[256] = {};
+        uint32_t size = 255;
+        if (i + 1 < directory.numberOfNames && names[i + 1] - names[i] > 0 && names[i + 1] - names[i] < 255) {
+            size = names[i + 1] - names[i];
+        }
+        if (source.read(base + names[i], name, size) && name[0]) {
+            exports.push_back({ name, base + functions[ordinals[i]] });
+        }
+    }
+    return exports;
+}
+
+static void checkParsing() {
+    for (bool is64Bit : { true, false }) {
+        for (bool namesOutside : { false, true }) {
+            testImageOptions options;
+            options.is64Bit = is64Bit;
+            options.namesOutside = namesOutside;
+            options.seed = 3 + is64Bit * 2 + namesOutside;
+            auto image = buildTestImage(options);
+
+            bufferSource source;
+            const uintptr_t base = 0x180000000;
+            memcpy(source.map(base, image.bytes.size()), image.bytes.data(), image.bytes.size());
+
+            source.resetCounters();
+            auto exports = readModuleExports(source, base);
+            CHECK(keysOf(exports) == expectedExports(image, base));
+            CHECK(source.reads <= (namesOutside ? 3u : 2u)); // headers, directory, names outside of it
+        }
+    }
+
+    // garbage headers and directories come back empty instead of reading wild
+    auto image = buildTestImage({});
+    bufferSource source;
+    uint8_t* bytes = source.map(0x10000, image.bytes.size());
+    memcpy(bytes, image.bytes.data(), image.bytes.size());
+
+    bytes[0] = 'X';
+    CHECK(readModuleExports(source, 0x10000).empty());
+    bytes[0] = 'M';
+
+    uint32_t tooMany = EXPORT_MAX_ENTRIES + 1;
+    memcpy(bytes + image.sections[1].rva + 20, &tooMany, 4);
+    CHECK(readModuleExports(source, 0x10000).empty());
+
+    CHECK(readModuleExports(source, 0x50000000).empty());
+}
+
+int main() {
+    checkParsing();
+
+    // 200 modules of 1500 exports each, every read costs what a cross process read about does
+    bufferSource source;
+    source.readCost = std::chrono::microseconds(2);
+
+    std::vector<uintptr_t> bases;
+    std::vector<testImage> images;
+    for (uint32_t i = 0; i < 200; i++) {
+        testImageOptions options;
+        options.exportCount = 1500;
+        options.seed = 100 + i;
+        images.push_back(buildTestImage(options));
+
+        uintptr_t base = 0x7FF900000000 + uintptr_t(i) * 0x1000000;
+        memcpy(source.map(base, images.back().bytes.size()), images.back().bytes.data(), images.back().bytes.size());
+        bases.push_back(base);
+    }
+
+    source.resetCounters();
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<std::pair<std::string, uintptr_t>>> before;
+    for (uintptr_t base : bases) {
+        before.push_back(oldExports(source, base));
+    }
+    double beforeMs = msSince(start);
+    uint64_t beforeReads = source.reads;
+
+    source.resetCounters();
+    start = std::chrono::steady_clock::now();
+    std::vector<std::vector<funcExport>> after;
+    for (uintptr_t base : bases) {
+        after.push_back(readModuleExports(source, base));
+    }
+    double afterMs = msSince(start);
+    uint64_t afterReads = source.reads;
+
+    // the old reader knew nothing of forwarders or ordinal only exports, the named ones have to agree
+    for (size_t i = 0; i < bases.size(); i++) {
+        CHECK(keysOf(after[i]) == expectedExports(images[i], bases[i]));
+
+        std::vector<std::pair<std::string, uintptr_t>> named;
+        std::set<std::string> forwarded;
+        for (auto& entry : after[i]) {
+            if (!entry.forwarder.empty()) {
+                forwarded.insert(entry.name);
+            }
+            else if (entry.name[0] != '#') {
+                named.push_back({ entry.name, entry.address });
+            }
+        }
+        std::erase_if(before[i], [&](const auto& entry) { return forwarded.count(entry.first) != 0; });
+        std::sort(named.begin(), named.end());
+        std::sort(before[i].begin(), before[i].end());
+        CHECK(named == before[i]);
+    }
+
+    CHECK(afterReads * 10 <= beforeReads);
+    std::printf("%zu modules, ~%zu exports each, %lld us per read\n", bases.size(), images[0].exports.size(),
+        static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(source.readCost).count()));
+    std::printf("read per name  %8.1f ms %7llu reads\n", beforeMs, static_cast<unsigned long long>(beforeReads));
+    std::printf("bulk directory %8.1f ms %7llu reads (%.0fx)\n", afterMs, static_cast<unsigned long long>(afterReads), beforeMs / afterMs);
+
+    return testResult("exports_bench");
+}
@@ -0,0 +1,119 @@
+#include <random>
+
+#include "instances.h"
+#include "testsource.h"
+
+// findInstances against a plain slot by slot compare over the same heap, read like a process (page by page around
+// guard pages) and viewed like a dump, for 64 and 32 bit slots and vtable counts on both sides of the sse2 filter.
+// maxResults has to cut the scan short, not just the result
+
+static std::vector<uintptr_t> naiveInstances(bufferSource& source, const instanceScan& scan) {
+    const size_t slotSize = scan.is32Bit ? 4 : 8;
+    std::vector<uintptr_t> result;
+    for (auto& [base, entry] : source.blocks) {
+        if (entry.type != region_private || !(entry.protect & protect_read)) {
+            continue;
+        }
+        for (size_t offset = 0; offset + slotSize <= entry.data.size(); offset += slotSize) {
+            if (source.badPages.count((base + offset) & ~uintptr_t(0xFFF))) {
+                continue;
+            }
+            uintptr_t value = 0;
+            memcpy(&value, entry.data.data() + offset, slotSize);
+            if (std::find(scan.vtables.begin(), scan.vtables.end(), value) != scan.vtables.end()) {
+                result.push_back(base + offset);
+            }
+        }
+    }
+    return result;
+}
+
+int main() {
+    std::mt19937_64 rng(13);
+    bufferSource source;
+
+    // heaps of odd sizes, a module and a read only mapping that aren't searched, a few guard pages
+    std::vector<uint8_t*> heaps;
+    std::vector<size_t> sizes;
+    uintptr_t base = 0x20000000;
+    for (size_t i = 0; i < 12; i++) {
+        size_t size = (1 + rng() % 300) * 0x1000;
+        heaps.push_back(source.map(base, size));
+        sizes.push_back(size);
+        base += size + (i % 3 == 0 ? 0 : 0x10000); // some heaps touch
+    }
+    source.map(0x140000000, 0x10000, protect_read, region_image);
+    source.map(0x50000000, 0x10000, protect_read, region_mapped);
+    source.map(0x60000000, 0x10000, protect_none, region_private);
+    source.badPages.insert(0x20000000 + 0x3000);
+    source.badPages.insert(0x20000000 + sizes[0] + 0x1000);
+
+    const std::vector<uintptr_t> vtables64 = { 0x7FF612345670, 0x7FF612345A80, 0x7FF612346F10, 0x7FF61234C000, 0x7FF61234D008,
+        0x7FF6123512A0, 0x7FF612351D48, 0x7FF612360000, 0x7FF612371128, 0x7FF612380FF0 };
+    const std::vector<uintptr_t> vtables32 = { 0x00F45670, 0x00F45A80, 0x00F46F10, 0x00F4C000, 0x00F4D008, 0x00F512A0, 0x00F51D48,
+        0x00F60000, 0x00F71128, 0x00F80FF0 };
+
+    for (bool is32Bit : { false, true }) {
+        auto& vtables = is32Bit ? vtables32 : vtables64;
+        const size_t slotSize = is32Bit ? 4 : 8;
+
+        // random bytes, objects at aligned slots, near misses that only share the low dword, and the same
+        // values at unaligned offsets where they must not count
+        for (size_t i = 0; i < heaps.size(); i++) {
+            for (size_t j = 0; j < sizes[i]; j++) {
+                heaps[i][j] = static_cast<uint8_t>(rng());
+            }
+            for (size_t j = 0; j < sizes[i] / 256; j++) {
+                uintptr_t value = vtables[rng() % vtables.size()];
+                size_t offset = (rng() % (sizes[i] / slotSize)) * slotSize;
+                uint64_t kind = rng() % 4;
+                if (kind == 1 && !is32Bit) {
+                    value ^= uintptr_t(1) << 40;
+                }
+                if (kind == 2 && offset + 2 * slotSize <= sizes[i]) {
+                    offset += 1 + rng() % (slotSize - 1);
+                }
+                memcpy(heaps[i] + offset, &value, slotSize);
+            }
+        }
+        memcpy(source.at(0x140000000), vtables.data(), slotSize); // module memory isn't a heap
+
+        for (size_t count : { size_t(1), size_t(3), size_t(8), size_t(10) }) {
+            for (bool canView : { false, true }) {
+                source.canView = canView;
+
+                instanceScan scan;
+                scan.vtables.assign(vtables.begin(), vtables.begin() + count);
+                scan.is32Bit = is32Bit;
+                scan.chunkSize = 0x40000;
+                auto expected = naiveInstances(source, scan);
+
+                instanceScanStats stats;
+                auto found = findInstances(source, scan, &stats);
+                CHECK(found == expected);
+                CHECK(!stats.truncated);
+                CHECK(expected.size() > 100);
+
+                // the cut gives the first matches in address order, and most of the heap is never scanned
+                for (unsigned threads : { 1u, 4u }) {
+                    scan.maxResults = 100;
+                    scan.threads = threads;
+                    instanceScanStats cut;
+                    found = findInstances(source, scan, &cut);
+                    CHECK(cut.truncated);
+                    CHECK(found.size() == 100 && std::equal(found.begin(), found.end(), expected.begin()));
+                    // with more workers than cores how far the others run ahead of a descheduled one is up to the os
+                    CHECK(threads > 1 || cut.bytesScanned * 4 < stats.bytesScanned);
+                }
+            }
+        }
+    }
+
+    source.canView = false;
+    std::atomic<bool> cancel = true;
+    instanceScan scan;
+    scan.vtables = vtables64;
+    CHECK(findInstances(source, scan, nullptr, &cancel).empty());
+
+    return testResult("instances_test");
+}
@@ -0,0 +1,236 @@
+#include <random>
+
+#include "matcher.h"
+#include "testsource.h"
+
+// patternMatcher's scalar, sse2 and avx2 paths, multiMatcher and findPattern against a plain masked compare at
+// every offset, on random patterns over random buffers. every path has to return exactly the same offsets. then
+// the throughput of each path over 100 MB of code-like bytes
+
+struct testPattern {
+    std::vector<uint8_t> bytes;
+    std::vector<uint64_t> fixed;
+
+    size_t length() const { return bytes.size(); }
+    patternMatcher matcher() const { return patternMatcher(bytes.data(), fixed.data(), bytes.size()); }
+};
+
+static std::vector<uintptr_t> naiveFind(const testPattern& pattern, const uint8_t* data, size_t size, uintptr_t base) {
+    std::vector<uintptr_t> result;
+    for (size_t i = 0; pattern.length() && i + pattern.length() <= size; i++) {
+        bool match = true;
+        for (size_t j = 0; j < pattern.length() && match; j++) {
+            match = !isFixedByte(pattern.fixed.data(), j) || data[i + j] == pattern.bytes[j];
+        }
+        if (match) {
+            result.push_back(base + i);
+        }
+    }
+    return result;
+}
+
+// bytes the way code and data look: mostly the common ones, so anchors on them hit all the time
+static uint8_t codeByte(std::mt19937_64& rng) {
+    static const uint8_t common[] = { 0x00, 0xFF, 0x48, 0x8B, 0xCC, 0x89, 0x0F, 0x24, 0x4C, 0x83, 0x01, 0x8D, 0xE8, 0x44, 0x85, 0xC0 };
+    return rng() % 2 ? common[rng() % std::size(common)] : static_cast<uint8_t>(rng());
+}
+
+static testPattern randomPattern(std::mt19937_64& rng, const uint8_t* data, size_t size) {
+    testPattern pattern;
+    size_t length = 1 + rng() % (rng() % 4 == 0 ? 140 : 24);
+    pattern.bytes.resize(length);
+    pattern.fixed.assign((length + 63) / 64, 0);
+
+    // most are cut out of the buffer so they have matches, the rest are made up
+    bool copied = size >= length && rng() % 4 != 0;
+    size_t from = copied ? rng() % (size - length + 1) : 0;
+    int wildcards = static_cast<int>(rng() % 4); // none, few, half, nearly all
+    for (size_t i = 0; i < length; i++) {
+        pattern.bytes[i] = copied ? data[from + i] : codeByte(rng);
+        bool wildcard = wildcards == 1 ? rng() % 8 == 0 : wildcards == 2 ? rng() % 2 == 0 : wildcards == 3 ? rng() % 8 != 0 : false;
+        if (!wildcard) {
+            pattern.fixed[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    return pattern;
+}
+
+static void checkMatcher(std::mt19937_64& rng, const std::vector<simdLevel>& levels) {
+    std::vector<uint8_t> storage(8192 + 64);
+    for (size_t round = 0; round < 20000; round++) {
+        // odd sizes and alignments so the vector loops end anywhere and the scalar tail always has work
+        size_t size = rng() % (round % 10 == 0 ? 8192 : 300);
+        uint8_t* data = storage.data() + rng() % 64;
+        int fill = static_cast<int>(rng() % 3);
+        for (size_t i = 0; i < size; i++) {
+            data[i] = fill == 0 ? static_cast<uint8_t>(rng()) : fill == 1 ? codeByte(rng) : static_cast<uint8_t>(rng() % 2 ? 0xCC : 0x00);
+        }
+
+        auto pattern = randomPattern(rng, data, size);
+        auto matcher = pattern.matcher();
+        uintptr_t base = 0x140001000 + rng() % 0x1000;
+        auto expected = naiveFind(pattern, data, size, base);
+
+        for (simdLevel level : levels) {
+            std::vector<uintptr_t> found = { 1 }; // find appends
+            matcher.find(data, size, base, found, level);
+            found.erase(found.begin());
+            if (found != expected) {
+                std::printf("level %d, length %zu, size %zu: %zu matches instead of %zu\n", level, pattern.length(), size, found.size(), expected.size());
+            }
+            CHECK(found == expected);
+        }
+
+        for (size_t i = 0; i + pattern.length() <= size; i += 1 + rng() % 16) {
+            CHECK(matcher.matchesAt(data + i) == std::binary_search(expected.begin(), expected.end(), base + i));
+        }
+    }
+}
+
+static void checkMultiMatcher(std::mt19937_64& rng) {
+    std::vector<uint8_t> data(0x10000);
+    for (auto& value : data) {
+        value = codeByte(rng);
+    }
+
+    for (size_t round = 0; round < 50; round++) {
+        multiMatcher matcher;
+        std::vector<testPattern> patterns;
+        std::vector<size_t> ids;
+        for (size_t i = 0; i < 1 + rng() % 40; i++) {
+            auto pattern = randomPattern(rng, data.data(), data.size());
+            if (auto id = matcher.add(pattern.bytes.data(), pattern.fixed.data(), pattern.length())) {
+                ids.push_back(*id);
+                patterns.push_back(std::move(pattern));
+            }
+        }
+
+        std::vector<std::vector<uintptr_t>> found;
+        matcher.find(data.data(), data.size(), 0x1000, found);
+        for (size_t i = 0; i < patterns.size(); i++) {
+            CHECK(found[ids[i]] == naiveFind(patterns[i], data.data(), data.size(), 0x1000));
+        }
+    }
+}
+
+// chunked, threaded and read ahead scans over a source with holes and guard pages find what the naive compare
+// finds in the readable bytes of each range, matches across a chunk border included
+static void checkFindPattern(std::mt19937_64& rng) {
+    bufferSource source;
+    std::vector<scanRange> ranges;
+    uintptr_t base = 0x10000000;
+    for (size_t i = 0; i < 6; i++) {
+        size_t size = (2 + rng() % 40) * 0x1000 - (i == 5 ? 0x123 : 0);
+        uint8_t* bytes = source.map(base, size);
+        for (size_t j = 0; j < size; j++) {
+            bytes[j] = codeByte(rng);
+        }
+        ranges.push_back({ base, size });
+        base += ((size + 0xFFF) & ~size_t(0xFFF)) + 0x10000;
+    }
+    source.badPages.insert(ranges[1].base + 0x2000);
+    source.badPages.insert(ranges[3].base);
+
+    for (size_t round = 0; round < 60; round++) {
+        auto& range = ranges[rng() % ranges.size()];
+        auto pattern = randomPattern(rng, source.at(range.base), range.size);
+        if (rng() % 3 == 0) {
+            // right across a chunk border
+            size_t at = 0x1000 - rng() % (std::min)(pattern.length(), size_t(0x1000)) - 1;
+            memcpy(source.at(ranges[0].base) + at, pattern.bytes.data(), pattern.length());
+        }
+        auto matcher = pattern.matcher();
+
+        std::vector<uintptr_t> expected;
+        for (auto& part : ranges) {
+            // the bytes of a match all have to be readable
+            for (uintptr_t match : naiveFind(pattern, source.at(part.base), part.size, part.base)) {
+                bool readable = true;
+                for (uintptr_t page = match & ~uintptr_t(0xFFF); page < match + pattern.length() && readable; page += 0x1000) {
+                    readable = !source.badPages.count(page);
+                }
+                if (readable) {
+                    expected.push_back(match);
+                }
+            }
+        }
+
+        patternScanOptions options;
+        options.chunkSize = 0x1000 << (rng() % 4);
+        options.threads = 1 + static_cast<unsigned>(rng() % 4);
+        options.readAhead = static_cast<unsigned>(rng() % 3);
+        source.canView = rng() % 2;
+        CHECK(findPattern(source, ranges, matcher, options) == expected);
+    }
+    source.canView = false;
+}
+
+template <typename Fn>
+static double gigabytesPerSecond(size_t size, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return size / (msSince(start) * 1e6);
+}
+
+int main() {
+    std::mt19937_64 rng(16);
+
+    std::vector<simdLevel> levels = { simd_scalar };
+#ifdef IMCLASS_SSE2
+    levels.push_back(simd_sse2);
+    if (bestSimdLevel() >= simd_avx2) {
+        levels.push_back(simd_avx2);
+    }
+    else {
+        std::printf("no avx2 on this cpu, that path isn't covered\n");
+    }
+#endif
+
+    checkMatcher(rng, levels);
+    checkMultiMatcher(rng);
+    checkFindPattern(rng);
+
+    // 100 MB of code-like bytes and a signature of the usual shape, planted every few hundred KB
+    const size_t size = 100 * 1024 * 1024;
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t value = rng();
+        for (size_t j = 0; j < 8; j++) {
+            uint8_t byte = static_cast<uint8_t>(value >> (j * 8));
+            data[i + j] = byte < 0x80 ? byte : byte < 0xC0 ? 0x00 : byte < 0xD0 ? 0xCC : byte < 0xE0 ? 0x48 : 0x8B;
+        }
+    }
+
+    testPattern signature;
+    signature.bytes = { 0x48, 0x8B, 0x05, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85, 0xC0, 0x74, 0x00, 0xE8 };
+    signature.fixed = { 0b1'0111'1000'0111 };
+    for (size_t i = 0x1000; i + signature.length() < size; i += 0x40000 + rng() % 0x1000) {
+        memcpy(data.data() + i, signature.bytes.data(), signature.length());
+    }
+    auto matcher = signature.matcher();
+
+    std::vector<uintptr_t> expected;
+    double naive = gigabytesPerSecond(size, [&] { expected = naiveFind(signature, data.data(), size, 0); });
+    std::printf("%zu MB, %zu matches\n", size >> 20, expected.size());
+    std::printf("naive   %6.2f GB/s\n", naive);
+
+    const char* names[] = { "scalar", "sse2", "avx2" };
+    for (simdLevel level : levels) {
+        std::vector<uintptr_t> found;
+        double speed = gigabytesPerSecond(size, [&] { matcher.find(data.data(), size, 0, found, level); });
+        CHECK(found == expected);
+        std::printf("%-7s %6.2f GB/s (%.1fx)\n", names[level], speed, speed / naive);
+    }
+
+    bufferSource source;
+    memcpy(source.map(0x100000000, size), data.data(), size);
+    std::vector<uintptr_t> found;
+    double speed = gigabytesPerSecond(size, [&] { found = findPattern(source, 0x100000000, size, matcher); });
+    for (auto& address : found) {
+        address -= 0x100000000;
+    }
+    CHECK(found == expected);
+    std::printf("findPattern %6.2f GB/s, %u threads\n", speed, workerCount(size / PATTERN_CHUNK_SIZE));
+
+    return testResult("matcher_test");
+}
@@ -0,0 +1,331 @@
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+#include "minidump.h"
+#include "testsource.h"
+
+// dumpSource on a small dump written here: system info, a module list, a memory info list, a 32 bit memory list
+// and a memory64 list whose ranges sit back to back at the end of the file. reads and views have to hand out
+// the captured bytes (views straight out of the mapping), modules and regions have to come back as written,
+// and dumps with a broken header or stream directory must not open
+
+// captured ranges: the first two touch in the target, the third is on its own, the fourth comes from the
+// 32 bit memory list
+struct testRange {
+    uint64_t start;
+    uint64_t size;
+};
+
+static const testRange memory64[] = { { 0x10000, 0x2000 }, { 0x12000, 0x1000 }, { 0x20000, 0x3000 } };
+static const testRange memory32 = { 0x40000, 0x100 };
+
+static constexpr uint32_t DUMP_ARCH_AMD64 = 9;
+
+static uint8_t rangeByte(uint64_t address) {
+    return static_cast<uint8_t>(address * 7 + (address >> 8));
+}
+
+class dumpWriter {
+public:
+    std::vector<uint8_t> file;
+
+    template <typename T>
+    uint32_t append(const T& value) {
+        return append(&value, sizeof(value));
+    }
+
+    uint32_t append(const void* bytes, size_t size) {
+        auto rva = static_cast<uint32_t>(file.size());
+        file.insert(file.end(), static_cast<const uint8_t*>(bytes), static_cast<const uint8_t*>(bytes) + size);
+        return rva;
+    }
+
+    template <typename T>
+    T* at(uint32_t rva) {
+        return reinterpret_cast<T*>(file.data() + rva);
+    }
+
+    uint32_t appendName(std::string_view name) {
+        auto rva = append(static_cast<uint32_t>(name.size() * sizeof(char16_t)));
+        for (char c : name) {
+            append(static_cast<char16_t>(c));
+        }
+        append(char16_t(0));
+        return rva;
+    }
+};
+
+struct dumpOptions {
+    uint16_t architecture = DUMP_ARCH_AMD64;
+    bool memoryInfo = true;
+    bool memory64 = true;
+    bool memory32 = true;
+};
+
+struct builtDump {
+    std::vector<uint8_t> file;
+    uint32_t directoryRva = 0;
+    uint32_t streams = 0;
+    uint64_t memoryRva = 0; // where the memory64 ranges start
+};
+
+static builtDump buildDump(const dumpOptions& options) {
+    dumpWriter writer;
+    writer.append(dumpHeader{});
+
+    std::vector<dumpDirectory> directory;
+
+    dumpLocation system{ 56, 0 };
+    system.rva = writer.append(options.architecture);
+    writer.file.resize(system.rva + system.dataSize);
+    directory.push_back({ DUMP_SYSTEM_INFO_STREAM, system });
+
+    // two modules, written in reverse so the source has to sort them
+    uint32_t names[] = { writer.appendName("C:\\Windows\\System32\\kernel32.dll"), writer.appendName("C:\\game\\game.exe") };
+    dumpModule modules[2] = {};
+    modules[0].baseOfImage = 0x7FF810000000;
+    modules[0].sizeOfImage = 0xB0000;
+    modules[0].moduleNameRva = names[0];
+    modules[1].baseOfImage = 0x140000000;
+    modules[1].sizeOfImage = 0x2000000;
+    modules[1].moduleNameRva = names[1];
+    uint32_t moduleCount = 2;
+    dumpLocation moduleList{ sizeof(moduleCount) + sizeof(modules), writer.append(moduleCount) };
+    writer.append(modules);
+    directory.push_back({ DUMP_MODULE_LIST_STREAM, moduleList });
+
+    if (options.memoryInfo) {
+        dumpMemoryInfo infos[] = {
+            { 0x10000, 0x10000, 0x04, 0, 0x3000, WIN_MEM_COMMIT, 0x04, WIN_MEM_PRIVATE, 0 },
+            { 0x13000, 0, 0, 0, 0xD000, 0x10000, 0x01, 0, 0 }, // MEM_FREE
+            { 0x20000, 0x20000, 0x80, 0, 0x3000, WIN_MEM_COMMIT, 0x20, WIN_MEM_IMAGE, 0 },
+            { 0x30000, 0x30000, 0x04, 0, 0x8000, 0x2000, 0, WIN_MEM_MAPPED, 0 }, // reserved
+        };
+        dumpMemoryInfoHeader infoHeader{ sizeof(dumpMemoryInfoHeader), sizeof(dumpMemoryInfo), std::size(infos) };
+        dumpLocation infoList{ sizeof(infoHeader) + sizeof(infos), writer.append(infoHeader) };
+        writer.append(infos);
+        directory.push_back({ DUMP_MEMORY_INFO_LIST_STREAM, infoList });
+    }
+
+    if (options.memory32) {
+        std::vector<uint8_t> bytes(memory32.size);
+        for (uint64_t i = 0; i < memory32.size; i++) {
+            bytes[i] = rangeByte(memory32.start + i);
+        }
+        dumpMemoryDescriptor descriptor{ memory32.start, { static_cast<uint32_t>(memory32.size), writer.append(bytes.data(), bytes.size()) } };
+        uint32_t count = 1;
+        dumpLocation memoryList{ sizeof(count) + sizeof(descriptor), writer.append(count) };
+        writer.append(descriptor);
+        directory.push_back({ DUMP_MEMORY_LIST_STREAM, memoryList });
+    }
+
+    uint32_t memory64Rva = 0;
+    if (options.memory64) {
+        uint64_t count = std::size(memory64);
+        dumpLocation memoryList{ static_cast<uint32_t>(2 * sizeof(uint64_t) + count * sizeof(dumpMemoryDescriptor64)), writer.append(count) };
+        memory64Rva = writer.append(uint64_t(0)); // patched once the directory is placed
+        for (auto& range : memory64) {
+            writer.append(dumpMemoryDescriptor64{ range.start, range.size });
+        }
+        directory.push_back({ DUMP_MEMORY64_LIST_STREAM, memoryList });
+    }
+
+    builtDump result;
+    result.streams = static_cast<uint32_t>(directory.size());
+    result.directoryRva = writer.append(directory.data(), directory.size() * sizeof(dumpDirectory));
+
+    if (options.memory64) {
+        result.memoryRva = writer.file.size();
+        *writer.at<uint64_t>(memory64Rva) = result.memoryRva;
+        for (auto& range : memory64) {
+            for (uint64_t i = 0; i < range.size; i++) {
+                writer.append(rangeByte(range.start + i));
+            }
+        }
+    }
+
+    auto header = writer.at<dumpHeader>(0);
+    header->signature = DUMP_SIGNATURE;
+    header->version = 0xA793;
+    header->numberOfStreams = result.streams;
+    header->streamDirectoryRva = result.directoryRva;
+
+    result.file = std::move(writer.file);
+    return result;
+}
+
+// every dump gets its own file, rewriting one that is still mapped would pull it out from under the source
+static std::vector<std::string> g_Paths;
+
+static std::unique_ptr<dumpSource> openDump(const std::vector<uint8_t>& file) {
+    auto name = "imclass_minidump_test" + std::to_string(g_Paths.size()) + ".dmp";
+    g_Paths.push_back((std::filesystem::temp_directory_path() / name).string());
+    std::ofstream(g_Paths.back(), std::ios::binary | std::ios::trunc).write(reinterpret_cast<const char*>(file.data()), file.size());
+    return std::make_unique<dumpSource>(g_Paths.back());
+}
+
+static bool matchesTarget(const uint8_t* bytes, uint64_t address, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (bytes[i] != rangeByte(address + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void checkMemory() {
+    auto dump = openDump(buildDump({}).file);
+    CHECK(dump->valid() && dump->isSnapshot() && !dump->is32Bit());
+
+    // views point into the mapping: stable, contiguous within a range and never across one
+    auto view = dump->view(0x10010, 0x100);
+    CHECK(view && matchesTarget(view, 0x10010, 0x100));
+    CHECK(dump->view(0x10010, 0x100) == view);
+    CHECK(dump->view(0x10011, 1) == view + 1);
+    CHECK(dump->view(0x10000, 0x2000) == view - 0x10);
+    CHECK(!dump->view(0x11FF0, 0x20)); // straddles into the next range
+    CHECK(!dump->view(0x1FFF0, 0x10));
+    CHECK(!dump->view(0x22FF0, 0x20)); // past the end of the last one
+    CHECK(dump->view(0x40000, 0x100) && matchesTarget(dump->view(0x40000, 0x100), 0x40000, 0x100));
+
+    // the memory64 ranges sit back to back in the file, so even the view of the next range follows on
+    CHECK(dump->view(0x12000, 1) == view - 0x10 + 0x2000);
+
+    // reads go across ranges that touch in the target, not over holes
+    std::vector<uint8_t> bytes(0x3000);
+    CHECK(dump->read(0x10000, bytes.data(), 0x3000) && matchesTarget(bytes.data(), 0x10000, 0x3000));
+    CHECK(dump->read(0x11FF8, bytes.data(), 0x10) && matchesTarget(bytes.data(), 0x11FF8, 0x10));
+    CHECK(dump->read(0x20000, bytes.data(), 0x3000) && matchesTarget(bytes.data(), 0x20000, 0x3000));
+    CHECK(dump->read(0x400F8, bytes.data(), 8) && matchesTarget(bytes.data(), 0x400F8, 8));
+    CHECK(!dump->read(0x12FF8, bytes.data(), 0x10)); // runs off the end of the second range
+    CHECK(!dump->read(0x22FFF, bytes.data(), 2));
+    CHECK(!dump->read(0x30000, bytes.data(), 1)); // reserved, never captured
+    CHECK(!dump->read(0xFFFF, bytes.data(), 2));
+    CHECK(!dump->write(0x10000, bytes.data(), 1));
+
+    // every read agrees with the reference, wherever it starts and however long it is
+    std::mt19937_64 rng(4);
+    for (int i = 0; i < 20000; i++) {
+        uint64_t address = 0xF000 + rng() % 0x35000;
+        size_t size = 1 + rng() % (rng() % 4 == 0 ? 0x4000 : 64);
+
+        bool captured = true;
+        for (uint64_t position = address; position < address + size && captured;) {
+            auto range = std::find_if(std::begin(memory64), std::end(memory64), [&](const testRange& r) { return position - r.start < r.size; });
+            if (range != std::end(memory64)) {
+                position = range->start + range->size;
+            }
+            else if (position - memory32.start < memory32.size) {
+                position = memory32.start + memory32.size;
+            }
+            else {
+                captured = false;
+            }
+        }
+
+        bytes.assign(size, 0);
+        CHECK(dump->read(address, bytes.data(), size) == captured);
+        if (captured) {
+            CHECK(matchesTarget(bytes.data(), address, size));
+        }
+    }
+}
+
+static void checkListing() {
+    auto dump = openDump(buildDump({}).file);
+
+    std::vector<sourceModule> modules;
+    CHECK(dump->getModules(modules));
+    CHECK(modules.size() == 2);
+    if (modules.size() == 2) {
+        CHECK(modules[0].name == "game.exe" && modules[0].base == 0x140000000 && modules[0].size == 0x2000000);
+        CHECK(modules[1].name == "kernel32.dll" && modules[1].base == 0x7FF810000000 && modules[1].size == 0xB0000);
+    }
+
+    // the free region is left out of the list but still answers queries
+    std::vector<memoryRegion> regions;
+    CHECK(dump->getRegions(regions));
+    CHECK(regions.size() == 3);
+    if (regions.size() == 3) {
+        CHECK(regions[0].base == 0x10000 && regions[0].size == 0x3000 && regions[0].type == region_private);
+        CHECK(regions[0].committed && regions[0].protect == (protect_read | protect_write));
+        CHECK(regions[1].base == 0x20000 && regions[1].type == region_image && regions[1].protect == (protect_read | protect_execute));
+        CHECK(regions[2].base == 0x30000 && regions[2].type == region_mapped && !regions[2].committed && regions[2].protect == protect_none);
+    }
+
+    memoryRegion region;
+    CHECK(dump->queryRegion(0x14000, &region) && region.base == 0x13000 && region.type == region_free);
+    CHECK(dump->queryRegion(0x22FFF, &region) && region.base == 0x20000 && region.type == region_image);
+
+    // not in the memory info list: the captured range if there is one, a free page otherwise
+    CHECK(dump->queryRegion(0x40010, &region) && region.base == 0x40000 && region.size == 0x100 && region.committed);
+    CHECK(dump->queryRegion(0x50010, &region) && region.base == 0x50000 && region.type == region_free && !region.committed);
+
+    // without a memory info list the captured ranges are all there is
+    auto bare = openDump(buildDump({ .memoryInfo = false }).file);
+    CHECK(bare->getRegions(regions) && regions.size() == 4);
+    if (regions.size() == 4) {
+        CHECK(regions[0].base == 0x10000 && regions[0].size == 0x2000 && regions[3].base == 0x40000);
+        CHECK(std::all_of(regions.begin(), regions.end(), [](const memoryRegion& r) { return r.protect == protect_read && r.type == region_private; }));
+    }
+
+    auto x86 = openDump(buildDump({ .architecture = DUMP_ARCH_X86 }).file);
+    CHECK(x86->valid() && x86->is32Bit());
+}
+
+static void checkDamaged() {
+    auto built = buildDump({});
+
+    auto bad = built.file;
+    bad[0] ^= 1;
+    CHECK(!openDump(bad)->valid());
+
+    // the directory is past the end of the file, or claims more streams than fit
+    bad = built.file;
+    reinterpret_cast<dumpHeader*>(bad.data())->streamDirectoryRva = static_cast<uint32_t>(bad.size());
+    CHECK(!openDump(bad)->valid());
+
+    bad = built.file;
+    reinterpret_cast<dumpHeader*>(bad.data())->numberOfStreams = 0x10000000;
+    CHECK(!openDump(bad)->valid());
+
+    // cut off in the middle of the directory, or of the header
+    bad.assign(built.file.begin(), built.file.begin() + built.directoryRva + sizeof(dumpDirectory) + 4);
+    CHECK(!openDump(bad)->valid());
+
+    bad.assign(built.file.begin(), built.file.begin() + 16);
+    CHECK(!openDump(bad)->valid());
+
+    // a stream that points outside the file
+    for (uint32_t i = 0; i < built.streams; i++) {
+        bad = built.file;
+        auto entry = reinterpret_cast<dumpDirectory*>(bad.data() + built.directoryRva) + i;
+        entry->location.rva = static_cast<uint32_t>(bad.size()) - 4;
+        CHECK(!openDump(bad)->valid());
+    }
+
+    // no memory at all is nothing to look at
+    CHECK(!openDump(buildDump({ .memory64 = false, .memory32 = false }).file)->valid());
+
+    // a dump whose writer died keeps the ranges that made it into the file
+    bad.assign(built.file.begin(), built.file.begin() + built.memoryRva + 0x2000 + 0x800);
+    auto truncated = openDump(bad);
+    CHECK(truncated->valid());
+    std::vector<uint8_t> bytes(0x2000);
+    CHECK(truncated->read(0x10000, bytes.data(), 0x2000) && matchesTarget(bytes.data(), 0x10000, 0x2000));
+    CHECK(!truncated->read(0x12000, bytes.data(), 1));
+    CHECK(!truncated->read(0x20000, bytes.data(), 1));
+    CHECK(truncated->read(0x40000, bytes.data(), 0x100));
+}
+
+int main() {
+    checkMemory();
+    checkListing();
+    checkDamaged();
+
+    for (auto& path : g_Paths) {
+        std::filesystem::remove(path);
+    }
+    return testResult("minidump_test");
+}
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "exports.h"
+#include "modcache.h"
+#include "symbols.h"
+#include "testimage.h"
+#include "testsource.h"
+
+// the module cache over synthetic images: what a cold attach parses and stores has to come back from the file at
+// any other base exactly as readModuleExports sees it there, identities that differ in anything must miss, and
+// lookups keep working while another thread saves
+
+// what buildSymbols stores after a cold parse and turns back into exports on a warm one
+static std::vector<cachedExport> toCached(const std::vector<funcExport>& exports, uintptr_t base) {
+    std::vector<cachedExport> result;
+    for (auto& entry : exports) {
+        uint32_t rva = entry.forwarder.empty() ? static_cast<uint32_t>(entry.address - base) : 0;
+        result.push_back({ entry.name, rva, entry.ordinal, entry.forwarder });
+    }
+    return result;
+}
+
+// copies what visitExports hands out, the views don't outlive the call
+static bool loadExports(const moduleCache& cache, const moduleIdentity& identity, std::vector<cachedExport>& out) {
+    out.clear();
+    return cache.visitExports(identity, [&](const cachedExportView& entry) {
+        out.push_back({ std::string(entry.name), entry.rva, entry.ordinal, std::string(entry.forwarder) });
+    });
+}
+
+static std::vector<funcExport> fromCached(const std::vector<cachedExport>& cached, uintptr_t base) {
+    std::vector<funcExport> result;
+    for (auto& entry : cached) {
+        result.push_back({ entry.name, entry.forwarder.empty() ? base + entry.rva : 0, entry.ordinal, entry.forwarder });
+    }
+    return result;
+}
+
+static std::vector<cachedSection> sectionsOf(const testImage& image) {
+    std::vector<cachedSection> result;
+    for (auto& section : image.sections) {
+        cachedSection entry{ section.rva, section.size, {}, section.characteristics };
+        memcpy(entry.name, section.name, 8);
+        result.push_back(entry);
+    }
+    return result;
+}
+
+static bool sameExports(const std::vector<funcExport>& a, const std::vector<funcExport>& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const funcExport& x, const funcExport& y) {
+        return x.name == y.name && x.address == y.address && x.ordinal == y.ordinal && x.forwarder == y.forwarder;
+    });
+}
+
+static bool sameSections(const std::vector<cachedSection>& a, const std::vector<cachedSection>& b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](const cachedSection& x, const cachedSection& y) {
+        return x.rva == y.rva && x.size == y.size && !memcmp(x.name, y.name, 8) && x.characteristics == y.characteristics;
+    });
+}
+
+int main() {
+    auto path = (std::filesystem::temp_directory_path() / "imclass_modcache_test.bin").string();
+    std::filesystem::remove(path);
+
+    // cold attach: 50 modules parsed from one process and stored
+    const size_t count = 50;
+    std::vector<testImage> images;
+    std::vector<moduleIdentity> identities;
+    bufferSource cold, warm;
+    for (size_t i = 0; i < count; i++) {
+        testImageOptions options;
+        options.exportCount = 300 + i * 10;
+        options.is64Bit = i % 4 != 0;
+        options.namesOutside = i % 7 == 0;
+        options.seed = 1000 + static_cast<uint32_t>(i);
+        images.push_back(buildTestImage(options));
+        identities.push_back(testIdentity(images.back(), "module" + std::to_string(i) + ".dll"));
+
+        // aslr puts every image somewhere else the next time
+        auto& bytes = images.back().bytes;
+        memcpy(cold.map(0x7FF800000000 + i * 0x1000000, bytes.size()), bytes.data(), bytes.size());
+        memcpy(warm.map(0x7FFA00000000 + i * 0x2000000, bytes.size()), bytes.data(), bytes.size());
+    }
+
+    auto coldStart = std::chrono::steady_clock::now();
+    {
+        moduleCache cache;
+        CHECK(!cache.open(path)); // nothing there yet
+        for (size_t i = 0; i < count; i++) {
+            uintptr_t base = 0x7FF800000000 + i * 0x1000000;
+            cache.store(identities[i], sectionsOf(images[i]), toCached(readModuleExports(cold, base), base));
+        }
+        CHECK(cache.save());
+        CHECK(cache.isOpen());
+    }
+    double coldMs = msSince(coldStart);
+
+    // warm attach: every module comes from the file, rebased, and equals a fresh parse at the new base
+    moduleCache cache;
+    CHECK(cache.open(path));
+    warm.resetCounters();
+    auto warmStart = std::chrono::steady_clock::now();
+    std::vector<std::vector<funcExport>> loaded(count);
+    for (size_t i = 0; i < count; i++) {
+        std::vector<cachedSection> sections;
+        std::vector<cachedExport> exports;
+        CHECK(cache.loadSections(identities[i], sections) && sameSections(sections, sectionsOf(images[i])));
+        CHECK(loadExports(cache, identities[i], exports));
+        loaded[i] = fromCached(exports, 0x7FFA00000000 + i * 0x2000000);
+    }
+    double warmMs = msSince(warmStart);
+    uint64_t warmReads = warm.reads;
+    CHECK(warmReads == 0);
+
+    for (size_t i = 0; i < count; i++) {
+        CHECK(sameExports(loaded[i], readModuleExports(warm, 0x7FFA00000000 + i * 0x2000000)));
+    }
+
+    // what buildSymbols does with a warm module: names go from the mapping into the symbol arena, no copies
+    auto symbolStart = std::chrono::steady_clock::now();
+    symbolTable symbols;
+    for (size_t i = 0; i < count; i++) {
+        uint16_t module = symbols.addModule(identities[i].name);
+        CHECK(cache.visitExports(identities[i], [&](const cachedExportView& entry) {
+            if (entry.forwarder.empty()) {
+                symbols.add(module, entry.name, 0x7FFA00000000 + i * 0x2000000 + entry.rva);
+            }
+        }));
+    }
+    symbols.finalize();
+    double symbolMs = msSince(symbolStart);
+
+    for (size_t i = 0; i < count; i++) {
+        for (auto& entry : loaded[i]) {
+            if (entry.forwarder.empty()) {
+                CHECK(symbols.lookup(identities[i].name, entry.name) == entry.address);
+            }
+        }
+    }
+
+    // what a module poll does when the odd modules unload and one loads: the rest carry over without a parse
+    auto updated = symbols.filtered([&](const symbolEntry& entry) { return (entry.address - 0x7FFA00000000) / 0x2000000 % 2 == 0; });
+    uint16_t extraModule = updated.addModule("loaded.dll");
+    updated.add(extraModule, "Loaded", 0x7FFB00000000);
+    updated.finalize();
+    CHECK(updated.lookup("LOADED.DLL", "Loaded") == 0x7FFB00000000);
+    for (size_t i = 0; i < count; i++) {
+        for (auto& entry : loaded[i]) {
+            if (entry.forwarder.empty()) {
+                CHECK(updated.lookup(identities[i].name, entry.name) == (i % 2 == 0 ? std::optional(entry.address) : std::nullopt));
+                CHECK((updated.find(entry.address) != nullptr) == (i % 2 == 0));
+            }
+        }
+    }
+
+    // a rebuild or another module of the same name is never served from the cache
+    std::vector<cachedExport> unused;
+    for (auto change : { 0, 1, 2, 3 }) {
+        moduleIdentity other = identities[3];
+        other.name += change == 0 ? "x" : "";
+        other.timeDateStamp += change == 1;
+        other.sizeOfImage += change == 2 ? 0x1000 : 0;
+        other.headerHash ^= change == 3;
+        CHECK(!loadExports(cache, other, unused));
+    }
+    CHECK(!loadExports(cache, moduleIdentity(), unused));
+
+    // saving again keeps the old entries next to the new ones, a replaced entry takes the new contents
+    testImageOptions extraOptions;
+    extraOptions.seed = 77;
+    auto extra = buildTestImage(extraOptions);
+    auto extraIdentity = testIdentity(extra, "extra.dll");
+    cache.store(extraIdentity, sectionsOf(extra), {});
+    cache.store(identities[0], {}, { { "Replaced", 0x1234, 1, "" } });
+
+    // readers hammer the cache from other threads while it saves and remaps
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> lookups = 0, misses = 0;
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < 4; t++) {
+        readers.emplace_back([&, t] {
+            std::vector<cachedExport> exports;
+            for (size_t i = t; !stop; i = (i + 1) % count) {
+                if (i == 0) {
+                    continue;
+                }
+                if (!loadExports(cache, identities[i], exports) || exports.size() != loaded[i].size()) {
+                    misses++;
+                }
+                lookups++;
+                std::this_thread::yield(); // glibc's shared_mutex prefers readers, four of them back to back starve save()
+            }
+        });
+    }
+    while (lookups < 1000) {
+        std::this_thread::yield();
+    }
+    CHECK(cache.save());
+    for (size_t round = 0; round < 20; round++) {
+        cache.store(extraIdentity, sectionsOf(extra), { { "Round" + std::to_string(round), 0x10, 1, "" } });
+        CHECK(cache.save());
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    CHECK(misses == 0);
+
+    moduleCache reopened;
+    CHECK(reopened.open(path));
+    std::vector<cachedExport> exports;
+    std::vector<cachedSection> sections;
+    CHECK(loadExports(reopened, identities[0], exports) && exports.size() == 1 && exports[0].name == "Replaced" && exports[0].rva == 0x1234);
+    CHECK(loadExports(reopened, extraIdentity, exports) && exports.size() == 1 && exports[0].name == "Round19");
+    CHECK(reopened.loadSections(extraIdentity, sections) && sameSections(sections, sectionsOf(extra)));
+    CHECK(loadExports(reopened, identities[count - 1], exports) && sameExports(fromCached(exports, 0x7FFA00000000 + (count - 1) * 0x2000000), loaded[count - 1]));
+
+    // a truncated or foreign file is rejected as a whole
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    moduleCache truncated;
+    CHECK(!truncated.open(path) && !loadExports(truncated, identities[1], exports));
+    std::filesystem::remove(path);
+
+    std::printf("%zu modules, %llu lookups during %d saves\n", count, static_cast<unsigned long long>(lookups.load()), 21);
+    std::printf("cold parse and save %8.2f ms\n", coldMs);
+    std::printf("warm load           %8.2f ms, %llu reads\n", warmMs, static_cast<unsigned long long>(warmReads));
+    std::printf("warm symbol table   %8.2f ms, %zu symbols\n", symbolMs, symbols.size());
+
+    return testResult("modcache_test");
+}
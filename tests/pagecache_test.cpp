@@ -0,0 +1,287 @@
+#include <random>
+
+#include "cache.h"
+#include "testsource.h"
+
+// pageCache in front of a bufferSource: what is served from a page and what goes to the reader within a frame and
+// across frames, unreadable pages, writes, eviction, the bypass size, and that batch and single reads hand out
+// the same bytes as the target for random requests
+
+static bufferSource g_Target;
+static uint64_t g_BatchCalls = 0;
+
+template <typename T>
+static T targetValue(uintptr_t address) {
+    T value;
+    memcpy(&value, g_Target.at(address), sizeof(value));
+    return value;
+}
+
+template <typename T>
+static void setTargetValue(uintptr_t address, T value) {
+    memcpy(g_Target.at(address), &value, sizeof(value));
+}
+
+static bool targetRead(uintptr_t address, void* buf, uintptr_t size) {
+    return g_Target.read(address, buf, size);
+}
+
+static void targetBatch(std::vector<readRequest>& requests) {
+    g_BatchCalls++;
+    g_Target.readBatch(requests);
+}
+
+static constexpr uintptr_t base = 0x10000000;
+static constexpr uintptr_t mapped = 64 * CACHE_PAGE_SIZE;
+static constexpr uintptr_t badPage = base + 40 * CACHE_PAGE_SIZE;
+
+static void checkFrame() {
+    pageCache cache(targetRead, targetBatch);
+    g_Target.resetCounters();
+
+    uint64_t value = 0;
+    CHECK(cache.read(base + 0x10, &value, sizeof(value)));
+    CHECK(value == targetValue<uint64_t>(base + 0x10));
+    CHECK(g_Target.reads == 1 && g_Target.bytesRead == CACHE_PAGE_SIZE); // the whole page is fetched
+
+    // the rest of the page is served without the target
+    uint8_t bytes[64];
+    CHECK(cache.read(base + 0x800, bytes, sizeof(bytes)));
+    CHECK(memcmp(bytes, g_Target.at(base + 0x800), sizeof(bytes)) == 0);
+    CHECK(g_Target.reads == 1);
+    CHECK(cache.stats.hits == 1 && cache.stats.misses == 1);
+
+    // straddling into the next page only fetches that one
+    CHECK(cache.read(base + CACHE_PAGE_SIZE - 4, &value, sizeof(value)));
+    CHECK(value == targetValue<uint64_t>(base + CACHE_PAGE_SIZE - 4));
+    CHECK(g_Target.reads == 2);
+    CHECK(cache.stats.hits == 2 && cache.stats.misses == 2);
+
+    // the next frame reads again with staleFrames 0
+    cache.nextFrame();
+    CHECK(cache.lastFrame.hits == 2 && cache.lastFrame.misses == 2 && cache.lastFrame.bypassed == 0);
+    CHECK(cache.read(base + 0x10, &value, sizeof(value)));
+    CHECK(g_Target.reads == 3);
+}
+
+static void checkNegative() {
+    pageCache cache(targetRead, targetBatch);
+    g_Target.resetCounters();
+
+    // an unreadable page fails every read of it but only asks the target once per frame
+    uint64_t value = 0;
+    CHECK(!cache.read(badPage + 0x100, &value, sizeof(value)));
+    CHECK(!cache.read(badPage + 0x200, &value, sizeof(value)));
+    CHECK(!cache.read(base + mapped + 0x10, &value, sizeof(value))); // past the mapping
+    CHECK(!cache.read(base + mapped + 0x20, &value, sizeof(value)));
+    CHECK(g_Target.reads == 2);
+
+    // a read that straddles a good and a bad page fails as a whole
+    CHECK(!cache.read(badPage - 4, &value, sizeof(value)));
+    CHECK(g_Target.reads == 3);
+
+    uint64_t other = 0;
+    std::vector<readRequest> requests(2);
+    requests[0] = { badPage + 0x300, sizeof(value), &value };
+    requests[1] = { badPage - 0x10, sizeof(other), &other };
+    cache.readBatch(requests);
+    CHECK(!requests[0].success && requests[1].success);
+    CHECK(g_Target.reads == 3);
+}
+
+static void checkStaleFrames() {
+    pageCache cache(targetRead, targetBatch);
+    cache.staleFrames = 2;
+    g_Target.resetCounters();
+
+    uint32_t value = 0;
+    uint32_t original = targetValue<uint32_t>(base);
+    CHECK(cache.read(base, &value, sizeof(value)));
+
+    // a change made behind the cache shows up only once the page is older than staleFrames
+    setTargetValue<uint32_t>(base, original + 1);
+    for (int frame = 0; frame < 2; frame++) {
+        cache.nextFrame();
+        CHECK(cache.read(base, &value, sizeof(value)));
+        CHECK(value == original);
+    }
+    CHECK(g_Target.reads == 1);
+
+    cache.nextFrame();
+    CHECK(cache.read(base, &value, sizeof(value)));
+    CHECK(value == original + 1);
+    CHECK(g_Target.reads == 2);
+    setTargetValue<uint32_t>(base, original);
+}
+
+static void checkInvalidate() {
+    pageCache cache(targetRead, targetBatch);
+    cache.staleFrames = 100;
+
+    uint8_t before[32], after[32];
+    CHECK(cache.read(base + 0x2FF0, before, sizeof(before))); // two pages
+
+    // the write path invalidates what it wrote, the next read sees it within the same frame
+    uint32_t written = 0xDEADBEEF;
+    CHECK(g_Target.write(base + 0x3004, &written, sizeof(written)));
+    cache.invalidate(base + 0x3004, sizeof(written));
+
+    g_Target.resetCounters();
+    CHECK(cache.read(base + 0x2FF0, after, sizeof(after)));
+    CHECK(memcmp(after, g_Target.at(base + 0x2FF0), sizeof(after)) == 0);
+    CHECK(memcmp(after, before, 16) == 0 && memcmp(after + 20, &written, sizeof(written)) == 0);
+    CHECK(g_Target.reads == 1); // only the written page went back to the target
+
+    cache.invalidate(base, 0); // empty range is a no op
+    cache.clear();
+    CHECK(cache.read(base + 0x2FF0, after, sizeof(after)));
+    CHECK(g_Target.reads == 3);
+}
+
+static void checkEviction() {
+    pageCache cache(targetRead, targetBatch);
+    cache.maxPages = 8;
+    cache.staleFrames = 1;
+    g_Target.resetCounters();
+
+    uint8_t byte;
+    for (uintptr_t i = 0; i < 6; i++) {
+        cache.read(base + i * CACHE_PAGE_SIZE, &byte, 1);
+    }
+    cache.nextFrame(); // under budget, nothing dropped
+    for (uintptr_t i = 6; i < 12; i++) {
+        cache.read(base + i * CACHE_PAGE_SIZE, &byte, 1);
+    }
+    CHECK(g_Target.reads == 12);
+
+    // over budget: pages that are no longer fresh are dropped, the last frame's pages stay
+    cache.nextFrame();
+    cache.nextFrame();
+    g_Target.resetCounters();
+    for (uintptr_t i = 6; i < 12; i++) {
+        cache.read(base + i * CACHE_PAGE_SIZE, &byte, 1);
+    }
+    CHECK(g_Target.reads == 6); // stale after two frames, reread
+
+    cache.staleFrames = 10;
+    g_Target.resetCounters();
+    for (uintptr_t i = 0; i < 6; i++) {
+        cache.read(base + i * CACHE_PAGE_SIZE, &byte, 1);
+    }
+    CHECK(g_Target.reads == 6); // dropped by the eviction, not just stale
+
+    // everything fresh and still over budget starts over
+    for (uintptr_t i = 12; i < 20; i++) {
+        cache.read(base + i * CACHE_PAGE_SIZE, &byte, 1);
+    }
+    cache.nextFrame();
+    g_Target.resetCounters();
+    cache.read(base + 12 * CACHE_PAGE_SIZE, &byte, 1);
+    CHECK(g_Target.reads == 1);
+}
+
+static void checkBypass() {
+    pageCache cache(targetRead, targetBatch);
+    g_Target.resetCounters();
+
+    // reads above bypassSize go straight through without touching the pages
+    std::vector<uint8_t> large(cache.bypassSize + 1);
+    CHECK(cache.read(base, large.data(), large.size()));
+    CHECK(memcmp(large.data(), g_Target.at(base), large.size()) == 0);
+    CHECK(g_Target.reads == 1 && g_Target.bytesRead == large.size());
+    CHECK(cache.stats.bypassed == 1 && cache.stats.misses == 0);
+
+    uint8_t byte;
+    CHECK(cache.read(base, &byte, 1));
+    CHECK(g_Target.reads == 2); // nothing was cached by it
+
+    // exactly bypassSize is still cached
+    std::vector<uint8_t> limit(cache.bypassSize);
+    CHECK(cache.read(base, limit.data(), limit.size()));
+    CHECK(cache.stats.bypassed == 1);
+
+    // a disabled cache bypasses everything
+    cache.enabled = false;
+    g_Target.resetCounters();
+    CHECK(cache.read(base, &byte, 1));
+    CHECK(cache.read(base, &byte, 1));
+    CHECK(g_Target.reads == 2 && cache.stats.bypassed == 3);
+
+    // in a batch the large request rides along with the page fetches in the one call
+    cache.enabled = true;
+    cache.clear();
+    g_BatchCalls = 0;
+    std::vector<readRequest> requests(2);
+    uint64_t value = 0;
+    requests[0] = { base + 0x5000, sizeof(value), &value };
+    requests[1] = { base, large.size(), large.data() };
+    cache.readBatch(requests);
+    CHECK(g_BatchCalls == 1);
+    CHECK(requests[0].success && requests[1].success);
+    CHECK(value == targetValue<uint64_t>(base + 0x5000));
+}
+
+// random reads of all sizes through read() and readBatch() on fresh caches and on warm ones, including bad pages,
+// the end of the mapping and reads over the bypass size. both have to agree with the target and each other
+static void checkRandom() {
+    std::mt19937_64 rng(17);
+
+    for (int round = 0; round < 200; round++) {
+        pageCache single(targetRead, targetBatch);
+        pageCache batched(targetRead, targetBatch);
+        single.staleFrames = batched.staleFrames = rng() % 3;
+
+        for (int frame = 0; frame < 4; frame++) {
+            std::vector<readRequest> requests(1 + rng() % 40);
+            std::vector<std::vector<uint8_t>> singleBytes(requests.size()), batchBytes(requests.size());
+            std::vector<bool> singleResults(requests.size());
+
+            for (size_t i = 0; i < requests.size(); i++) {
+                uintptr_t size = rng() % 8 == 0 ? 1 + rng() % (20 * CACHE_PAGE_SIZE) : 1 + rng() % 64;
+                uintptr_t address = base - 0x100 + rng() % (mapped + 0x200);
+                singleBytes[i].assign(size, 0xAA);
+                batchBytes[i].assign(size, 0xAA);
+                requests[i] = { address, size, batchBytes[i].data() };
+
+                singleResults[i] = single.read(address, singleBytes[i].data(), size);
+
+                std::vector<uint8_t> expected(size);
+                bool readable = g_Target.read(address, expected.data(), size);
+                CHECK(singleResults[i] == readable);
+                if (readable) {
+                    CHECK(singleBytes[i] == expected);
+                }
+            }
+
+            batched.readBatch(requests);
+            for (size_t i = 0; i < requests.size(); i++) {
+                CHECK(requests[i].success == singleResults[i]);
+                if (singleResults[i]) {
+                    CHECK(batchBytes[i] == singleBytes[i]);
+                }
+            }
+
+            single.nextFrame();
+            batched.nextFrame();
+        }
+    }
+}
+
+int main() {
+    std::mt19937_64 rng(3);
+    uint8_t* data = g_Target.map(base, mapped);
+    for (uintptr_t i = 0; i < mapped; i++) {
+        data[i] = static_cast<uint8_t>(rng());
+    }
+    g_Target.badPages.insert(badPage);
+
+    checkFrame();
+    checkNegative();
+    checkStaleFrames();
+    checkInvalidate();
+    checkEviction();
+    checkBypass();
+    checkRandom();
+
+    return testResult("pagecache_test");
+}
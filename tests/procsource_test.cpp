@@ -0,0 +1,183 @@
+#include <random>
+#include <thread>
+
+#include <sys/mman.h>
+
+#include "testsource.h"
+
+// linuxProcessSource pointed at this process: pages mapped here with a PROT_NONE hole in the middle are read
+// back through process_vm_readv, single and batched (where the kernel stops at the first bad iovec), and found
+// again in the regions and modules parsed from /proc/self/maps
+
+static const uintptr_t pageSize = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+
+// a function of this executable, its address has to land in the module named after it
+static int localFunction(int value) {
+    return value * 3 + 1;
+}
+
+static void checkRead(linuxProcessSource& source, uint8_t* pages) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(pages);
+
+    std::vector<uint8_t> bytes(pageSize);
+    CHECK(source.read(base, bytes.data(), pageSize));
+    CHECK(memcmp(bytes.data(), pages, pageSize) == 0);
+
+    uint64_t value = 0;
+    CHECK(source.read(base + pageSize + 3, &value, sizeof(value)));
+    CHECK(memcmp(&value, pages + pageSize + 3, sizeof(value)) == 0);
+
+    CHECK(!source.read(base + 2 * pageSize, &value, sizeof(value))); // the hole
+    CHECK(!source.read(base + 2 * pageSize - 4, &value, sizeof(value))); // into it
+    CHECK(!source.read(base + 4 * pageSize, &value, sizeof(value))); // unmapped again
+
+    // reads that span neighbouring pages of the same protection are fine
+    std::vector<uint8_t> span(2 * pageSize);
+    CHECK(source.read(base, span.data(), span.size()));
+    CHECK(memcmp(span.data(), pages, span.size()) == 0);
+
+    uint32_t written = 0x12345678;
+    CHECK(source.write(base + 3 * pageSize + 8, &written, sizeof(written)));
+    CHECK(memcmp(pages + 3 * pageSize + 8, &written, sizeof(written)) == 0);
+    CHECK(!source.write(base + 2 * pageSize, &written, sizeof(written)));
+}
+
+// random batches over the four pages (good, good, hole, good) and past them, far more requests than IOV_MAX so
+// the batch is split into several calls, each one stopping at its first bad request and going on after it
+static void checkBatch(linuxProcessSource& source, uint8_t* pages) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(pages);
+    std::mt19937_64 rng(9);
+
+    for (int round = 0; round < 50; round++) {
+        size_t count = 1 + rng() % (round % 5 == 0 ? 3000 : 64);
+        std::vector<readRequest> requests(count);
+        std::vector<std::vector<uint8_t>> buffers(count);
+
+        for (size_t i = 0; i < count; i++) {
+            uintptr_t size = 1 + rng() % (rng() % 8 == 0 ? 2 * pageSize : 64);
+            uintptr_t address = base + rng() % (5 * pageSize);
+            buffers[i].assign(size, 0xAA);
+            requests[i] = { address, size, buffers[i].data() };
+            requests[i].success = rng() % 2; // stale results from a previous use must not leak through
+        }
+
+        source.readBatch(requests);
+
+        for (size_t i = 0; i < count; i++) {
+            std::vector<uint8_t> expected(requests[i].size);
+            bool readable = source.read(requests[i].address, expected.data(), expected.size());
+            CHECK(requests[i].success == readable);
+            if (readable) {
+                CHECK(buffers[i] == expected);
+            }
+        }
+    }
+
+    // a bad request at the very start and the very end of a batch
+    uint64_t first = 0, middle = 0, last = 0;
+    std::vector<readRequest> requests = {
+        { base + 2 * pageSize, sizeof(first), &first },
+        { base + 8, sizeof(middle), &middle },
+        { base + 2 * pageSize + 8, sizeof(last), &last },
+    };
+    source.readBatch(requests);
+    CHECK(!requests[0].success && requests[1].success && !requests[2].success);
+    CHECK(memcmp(&middle, pages + 8, sizeof(middle)) == 0);
+}
+
+static void checkRegions(linuxProcessSource& source, uint8_t* pages) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(pages);
+
+    std::vector<memoryRegion> regions;
+    CHECK(source.getRegions(regions));
+    CHECK(std::is_sorted(regions.begin(), regions.end(), [](const memoryRegion& a, const memoryRegion& b) { return a.base < b.base; }));
+
+    // the hole is its own mapping between the two writable ones
+    auto hole = std::find_if(regions.begin(), regions.end(), [&](const memoryRegion& region) { return region.base == base + 2 * pageSize; });
+    CHECK(hole != regions.end());
+    if (hole != regions.end()) {
+        CHECK(hole->size == pageSize && hole->protect == protect_none && hole->type == region_private);
+        CHECK(hole != regions.begin() && (hole - 1)->base + (hole - 1)->size == hole->base);
+        CHECK((hole - 1)->protect == (protect_read | protect_write) && (hole - 1)->type == region_private && (hole - 1)->committed);
+        CHECK(hole + 1 != regions.end() && (hole + 1)->base == base + 3 * pageSize && (hole + 1)->protect == (protect_read | protect_write));
+    }
+
+    memoryRegion region;
+    CHECK(source.queryRegion(base + pageSize + 5, &region));
+    CHECK(region.base <= base && region.base + region.size == base + 2 * pageSize && region.type == region_private);
+
+    CHECK(source.queryRegion(base + 2 * pageSize + 5, &region));
+    CHECK(region.base == base + 2 * pageSize && region.size == pageSize && region.protect == protect_none);
+
+    // the page unmapped after the mapping is a free hole up to whatever comes next
+    CHECK(source.queryRegion(base + 4 * pageSize, &region));
+    CHECK(region.type == region_free && !region.committed && region.base == base + 4 * pageSize && region.size >= pageSize);
+
+    // the executable's own code is an image mapping
+    CHECK(source.queryRegion(reinterpret_cast<uintptr_t>(&localFunction), &region));
+    CHECK(region.type == region_image && (region.protect & protect_execute));
+
+    // maps are kept for a moment, then parsed again
+    mprotect(pages + 2 * pageSize, pageSize, PROT_READ);
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    CHECK(source.queryRegion(base + 2 * pageSize + 5, &region));
+    CHECK(region.protect == protect_read);
+
+    uint64_t value = 0;
+    CHECK(source.read(base + 2 * pageSize, &value, sizeof(value)));
+    mprotect(pages + 2 * pageSize, pageSize, PROT_NONE);
+}
+
+static void checkModules(linuxProcessSource& source) {
+    std::vector<sourceModule> modules;
+    CHECK(source.getModules(modules));
+
+    char path[4096] = {};
+    CHECK(readlink("/proc/self/exe", path, sizeof(path) - 1) > 0);
+    std::string name = path;
+    name = name.substr(name.find_last_of('/') + 1);
+
+    // the consecutive mappings of the executable come back as one module holding its code
+    uintptr_t code = reinterpret_cast<uintptr_t>(&localFunction);
+    auto self = std::find_if(modules.begin(), modules.end(), [&](const sourceModule& module) { return module.name == name; });
+    CHECK(self != modules.end());
+    if (self != modules.end()) {
+        CHECK(self->base <= code && code < self->base + self->size);
+        CHECK(std::count_if(modules.begin(), modules.end(), [&](const sourceModule& module) { return module.name == name; }) == 1);
+
+        uint32_t magic = 0;
+        CHECK(source.read(self->base, &magic, sizeof(magic)));
+        CHECK(memcmp(&magic, "\x7f" "ELF", 4) == 0);
+    }
+
+    CHECK(std::any_of(modules.begin(), modules.end(), [](const sourceModule& module) { return module.name.starts_with("libc"); }));
+    CHECK(localFunction(1) == 4);
+}
+
+int main() {
+    // five pages: rw, rw, none, rw and one that is unmapped again so there is a hole behind them
+    auto pages = static_cast<uint8_t*>(mmap(nullptr, 5 * pageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    CHECK(pages != MAP_FAILED);
+    if (pages == MAP_FAILED) {
+        return testResult("procsource_test");
+    }
+
+    std::mt19937_64 rng(1);
+    for (uintptr_t i = 0; i < 5 * pageSize; i++) {
+        pages[i] = static_cast<uint8_t>(rng());
+    }
+    mprotect(pages + 2 * pageSize, pageSize, PROT_NONE);
+    munmap(pages + 4 * pageSize, pageSize);
+
+    linuxProcessSource source(getpid());
+    CHECK(source.valid());
+    CHECK(!source.is32Bit());
+
+    checkRead(source, pages);
+    checkRegions(source, pages);
+    checkBatch(source, pages);
+    checkModules(source);
+
+    munmap(pages, 4 * pageSize);
+    return testResult("procsource_test");
+}
@@ -0,0 +1,106 @@
+#include <random>
+
+#include "testsource.h"
+
+// underlying reads of the request patterns mem::readBatch was written for, one read per request (as before) against
+// readMerged. every merged result is compared with a plain read of the same request
+
+struct batchCase {
+    const char* name;
+    std::vector<std::pair<uintptr_t, uintptr_t>> requests; // address, size
+    uint64_t fixedReads = 0; // reads the walk does outside of the batches either way
+};
+
+static void runCase(bufferSource& source, const batchCase& test) {
+    std::vector<std::vector<uint8_t>> merged(test.requests.size()), single(test.requests.size());
+    std::vector<readRequest> requests;
+    for (size_t i = 0; i < test.requests.size(); i++) {
+        merged[i].assign(test.requests[i].second, 0xCC);
+        single[i].assign(test.requests[i].second, 0);
+        requests.push_back({ test.requests[i].first, test.requests[i].second, merged[i].data() });
+    }
+
+    source.resetCounters();
+    std::vector<bool> expected;
+    for (size_t i = 0; i < test.requests.size(); i++) {
+        expected.push_back(source.read(test.requests[i].first, single[i].data(), single[i].size()));
+    }
+    uint64_t before = source.reads + test.fixedReads;
+
+    source.resetCounters();
+    readMerged(requests, [&](std::vector<readRequest>& spans) { source.readBatch(spans); },
+        [&](uintptr_t address, void* buf, uintptr_t size) { return source.read(address, buf, size); });
+    uint64_t after = source.reads + test.fixedReads;
+
+    for (size_t i = 0; i < requests.size(); i++) {
+        CHECK(requests[i].success == expected[i]);
+        if (expected[i]) {
+            CHECK(merged[i] == single[i]);
+        }
+        else {
+            CHECK(std::all_of(merged[i].begin(), merged[i].end(), [](uint8_t value) { return value == 0; }));
+        }
+    }
+
+    std::printf("%-28s %6zu requests %6llu reads before %6llu after (%.1fx)\n", test.name, test.requests.size(),
+        static_cast<unsigned long long>(before), static_cast<unsigned long long>(after), double(before) / double(after));
+    CHECK(after < before);
+}
+
+int main() {
+    std::mt19937_64 rng(2);
+    bufferSource source;
+
+    const uintptr_t rdata = 0x140100000, data = 0x140200000, heap = 0x2000000;
+    for (auto [base, size] : { std::pair{ rdata, 0x40000 }, std::pair{ data, 0x20000 }, std::pair{ heap, 0x100000 } }) {
+        uint8_t* bytes = source.map(base, size);
+        for (size_t i = 0; i < size_t(size); i++) {
+            bytes[i] = static_cast<uint8_t>(rng());
+        }
+    }
+    source.badPages.insert(heap + 0x30000); // one of the previewed objects sits next to a guard page
+
+    // rtti of a class with 12 bases: the old walk read the locator, the hierarchy and then three hops per base,
+    // the new one reads the base class array in one go and each further hop as one batch
+    const size_t bases = 12;
+    batchCase rttiDescriptors{ "rtti base class descriptors", {} };
+    batchCase rttiTypes{ "rtti type descriptors", {} };
+    for (size_t i = 0; i < bases; i++) {
+        rttiDescriptors.requests.push_back({ rdata + 0x8000 + i * 0x24, 4 });
+        rttiTypes.requests.push_back({ data + 0x1000 + (rng() % 0x800) * 8, 76 });
+    }
+    rttiDescriptors.fixedReads = 2 + bases; // locator, hierarchy, array entries one at a time before
+    rttiTypes.fixedReads = 0;
+
+    // export names outside of the export directory, up to 255 bytes each out of one packed string table
+    batchCase exportNames{ "export names", {} };
+    uintptr_t name = rdata + 0x10000;
+    for (size_t i = 0; i < 3000; i++) {
+        exportNames.requests.push_back({ name, 255 });
+        name += 8 + rng() % 40;
+    }
+
+    // string previews of 300 visible hex nodes: nulls are skipped, the rest mostly point into a few objects, some
+    // are garbage that doesn't point anywhere
+    batchCase previews{ "hex node string previews", {} };
+    std::vector<uintptr_t> objects;
+    for (size_t i = 0; i < 20; i++) {
+        objects.push_back(heap + (rng() % 0x100) * 0x1000 - (i == 0 ? 0 : 0x20));
+    }
+    objects[0] = heap + 0x30000 - 0x20; // straddles the guard page
+    for (size_t i = 0; i < 300; i++) {
+        uint64_t kind = rng() % 10;
+        if (kind < 3) {
+            continue;
+        }
+        uintptr_t pointer = kind < 9 ? objects[rng() % objects.size()] + (rng() % 8) * 8 : rng() & 0x7FFFFFFFFFF8;
+        previews.requests.push_back({ pointer, 64 });
+    }
+
+    runCase(source, rttiDescriptors);
+    runCase(source, rttiTypes);
+    runCase(source, exportNames);
+    runCase(source, previews);
+
+    return testResult("readbatch_bench");
+}
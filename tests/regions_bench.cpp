@@ -0,0 +1,231 @@
+#include <random>
+#include <thread>
+
+#include "regions.h"
+#include "testsource.h"
+
+// the linear isPointer the region index replaced (every module and section, then a VirtualQueryEx) against
+// regionIndex, on 300 modules and 10k regions. both have to give the same answer for every address
+
+struct linearModule {
+    std::string name;
+    uintptr_t base;
+    uintptr_t size;
+    std::vector<indexedSection> sections;
+};
+
+// regions only, a read costs nothing here but every query is spun like a syscall
+class regionSource : public memorySource {
+public:
+    std::vector<memoryRegion> regions; // sorted
+    std::chrono::nanoseconds queryCost{ 500 };
+    std::chrono::milliseconds listCost{ 0 }; // a full walk of a big process takes a while
+    uint64_t queries = 0;
+
+    bool read(uintptr_t, void*, uintptr_t) override { return false; }
+    bool write(uintptr_t, const void*, uintptr_t) override { return false; }
+    bool getRegions(std::vector<memoryRegion>& out) override {
+        std::this_thread::sleep_for(listCost);
+        out = regions;
+        return true;
+    }
+    bool getModules(std::vector<sourceModule>&) override { return false; }
+    bool isAlive() override { return true; }
+    bool is32Bit() override { return false; }
+
+    bool queryRegion(uintptr_t address, memoryRegion* region) override {
+        queries++;
+        auto until = std::chrono::steady_clock::now() + queryCost;
+        while (std::chrono::steady_clock::now() < until) {
+        }
+
+        auto it = std::upper_bound(regions.begin(), regions.end(), address, [](uintptr_t value, const memoryRegion& entry) { return value < entry.base; });
+        if (it != regions.begin() && address - (it - 1)->base < (it - 1)->size) {
+            *region = *(it - 1);
+            return true;
+        }
+        uintptr_t start = it == regions.begin() ? 0 : (it - 1)->base + (it - 1)->size;
+        uintptr_t end = it == regions.end() ? ~uintptr_t(0) : it->base;
+        *region = { start, end - start, protect_none, region_free, false };
+        return true;
+    }
+};
+
+struct answer {
+    bool pointer;
+    std::string module;
+    std::string section;
+
+    bool operator==(const answer&) const = default;
+};
+
+static answer linearIsPointer(const std::vector<linearModule>& modules, memorySource& source, uintptr_t address) {
+    for (auto& module : modules) {
+        if (module.base <= address && address < module.base + module.size) {
+            answer result{ true, module.name, "UNK" };
+            for (auto& section : module.sections) {
+                if (section.base <= address && address < section.end) {
+                    result.section.assign(section.name, strnlen(section.name, 8));
+                    break;
+                }
+            }
+            return result;
+        }
+    }
+
+    memoryRegion region;
+    if (source.queryRegion(address, &region)) {
+        return { region.type == region_private && region.committed, "", "" };
+    }
+    return { false, "", "" };
+}
+
+static answer indexedIsPointer(regionIndex& index, uintptr_t address) {
+    auto regions = index.current();
+    if (auto module = regions->findModule(address)) {
+        answer result{ true, module->name, "UNK" };
+        if (auto section = regionSnapshot::findSection(*module, address)) {
+            result.section.assign(section->name, strnlen(section->name, 8));
+        }
+        return result;
+    }
+    return { index.isPrivate(*regions, address), "", "" };
+}
+
+int main() {
+    std::mt19937_64 rng(5);
+    auto source = std::make_shared<regionSource>();
+
+    std::vector<linearModule> modules;
+    std::vector<indexedModule> indexed;
+    const char* sectionNames[] = { ".text", ".rdata", ".data", ".pdata", ".rsrc", ".reloc" };
+
+    uintptr_t imageBase = 0x7FF800000000;
+    for (size_t i = 0; i < 300; i++) {
+        linearModule module{ "module" + std::to_string(i) + ".dll", imageBase, 0, {} };
+        uintptr_t position = imageBase + 0x1000;
+        for (auto sectionName : sectionNames) {
+            uintptr_t size = (1 + rng() % 64) * 0x1000;
+            indexedSection section{ position, position + size, {} };
+            memcpy(section.name, sectionName, strnlen(sectionName, sizeof(section.name)));
+            module.sections.push_back(section);
+            position += size;
+        }
+        module.size = position - imageBase;
+        source->regions.push_back({ imageBase, module.size, protect_read, region_image, true });
+
+        indexed.push_back({ module.base, module.base + module.size, module.name, module.sections });
+        modules.push_back(std::move(module));
+        imageBase = (position + 0x10000 + 0xFFFF) & ~uintptr_t(0xFFFF);
+    }
+
+    // 10k heap, stack and mapped regions with holes between some of them, below the images
+    uintptr_t position = 0x10000000;
+    std::vector<memoryRegion> low;
+    while (low.size() < 10000) {
+        uintptr_t size = (1 + rng() % 32) * 0x1000;
+        regionType type = rng() % 5 == 0 ? region_mapped : region_private;
+        low.push_back({ position, size, protect_read | protect_write, type, rng() % 10 != 0 });
+        position += size + (rng() % 4 == 0 ? (1 + rng() % 16) * 0x10000 : 0);
+    }
+    source->regions.insert(source->regions.begin(), low.begin(), low.end());
+
+    regionIndex index;
+    index.refreshInterval = std::chrono::hours(1);
+    index.learnedLifetime = std::chrono::hours(1);
+    index.build(source, indexed);
+
+    // what hex nodes hold: pointers into modules and heaps, and a lot of values that aren't pointers at all
+    std::vector<uintptr_t> values;
+    for (size_t i = 0; i < 200000; i++) {
+        uint64_t kind = rng() % 10;
+        if (kind < 3) {
+            auto& module = modules[rng() % modules.size()];
+            values.push_back(module.base + rng() % module.size);
+        }
+        else if (kind < 6) {
+            auto& region = low[rng() % low.size()];
+            values.push_back(region.base + rng() % region.size);
+        }
+        else if (kind < 8) {
+            values.push_back(rng() % 0x10000); // counters, flags, small ints
+        }
+        else if (kind < 9) {
+            values.push_back(rng()); // floats and hashes read as integers
+        }
+        else {
+            values.push_back(0x10000000 + rng() % (position - 0x10000000)); // anywhere around the heaps, holes included
+        }
+    }
+
+    std::vector<answer> linear, fast;
+    linear.reserve(values.size());
+    fast.reserve(values.size());
+
+    source->queries = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uintptr_t value : values) {
+        linear.push_back(linearIsPointer(modules, *source, value));
+    }
+    double linearMs = msSince(start);
+    uint64_t linearQueries = source->queries;
+
+    source->queries = 0;
+    start = std::chrono::steady_clock::now();
+    for (uintptr_t value : values) {
+        fast.push_back(indexedIsPointer(index, value));
+    }
+    double indexMs = msSince(start);
+    uint64_t indexQueries = source->queries;
+
+    CHECK(linear == fast);
+    CHECK(indexQueries * 20 < linearQueries); // only the holes are ever asked about, once each
+
+    std::printf("%zu lookups, %zu modules, %zu regions, %lld ns per queryRegion\n", values.size(), modules.size(), source->regions.size(),
+        static_cast<long long>(source->queryCost.count()));
+    std::printf("linear  %8.1f ms %8.1f ns/lookup %7llu queries\n", linearMs, linearMs * 1e6 / values.size(), static_cast<unsigned long long>(linearQueries));
+    std::printf("indexed %8.1f ms %8.1f ns/lookup %7llu queries (%.0fx)\n", indexMs, indexMs * 1e6 / values.size(), static_cast<unsigned long long>(indexQueries), linearMs / indexMs);
+
+    // a stale snapshot is refreshed behind the lookups: the lookup that notices doesn't wait for the region walk,
+    // answers stay those of the old snapshot until the new one lands, then follow the target
+    auto changed = std::find_if(source->regions.begin(), source->regions.end(), [](const memoryRegion& region) {
+        return region.type == region_private && region.committed;
+    });
+    uintptr_t changedAddress = changed->base;
+    CHECK(indexedIsPointer(index, changedAddress).pointer);
+    changed->type = region_mapped;
+
+    source->listCost = std::chrono::milliseconds(200);
+    index.refreshInterval = std::chrono::milliseconds(0);
+    auto before = index.current();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    double slowestMs = 0;
+    bool staleServed = true;
+    size_t mismatches = 0;
+    for (size_t i = 0; i < 20000; i++) {
+        auto lookupStart = std::chrono::steady_clock::now();
+        answer result = indexedIsPointer(index, values[i]);
+        slowestMs = (std::max)(slowestMs, msSince(lookupStart));
+        mismatches += values[i] != changedAddress && result != linear[i];
+        if (auto regions = index.current(); regions == before) {
+            staleServed = staleServed && index.isPrivate(*regions, changedAddress);
+        }
+    }
+    CHECK(mismatches == 0);
+    CHECK(staleServed);
+    CHECK(slowestMs < 100); // far below the 200 ms walk
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (index.current() == before && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    index.refreshInterval = std::chrono::hours(1);
+    CHECK(index.current() != before);
+    CHECK(!indexedIsPointer(index, changedAddress).pointer);
+
+    std::printf("refresh behind lookups: slowest lookup %.2f ms during a %lld ms region walk\n", slowestMs,
+        static_cast<long long>(source->listCost.count()));
+
+    return testResult("regions_bench");
+}
@@ -0,0 +1,335 @@
+#include <thread>
+
+#include "rttiindex.h"
+#include "testimage.h"
+#include "testsource.h"
+
+// rttiIndex on test images with msvc rtti planted in them: locators, hierarchies and vtables in .rdata, type
+// descriptors in .data. x64 images use image relative offsets and a self offset, x86 ones absolute pointers.
+// every planted class has to come back with its hierarchy and vtables, from copied sections and from sections
+// the source hands out in place, and locators that are almost right must not turn into types
+
+struct plantedClass {
+    std::string name;
+    std::vector<std::string> bases; // in hierarchy order, not including the class itself
+    std::vector<uint32_t> offsets; // one vtable per subobject offset, the first is 0
+    bool referenced = true; // a vtable points at its locators
+};
+
+struct plantedType {
+    std::string name;
+    std::string hierarchy;
+    std::vector<uintptr_t> vtables;
+    uintptr_t primaryVtable = 0;
+};
+
+class rttiPlanter {
+public:
+    rttiPlanter(testImage& image, uintptr_t base, bool is32Bit)
+        : image(image), base(base), is32Bit(is32Bit), rdata(image.rdataSpare), data(image.dataSpare) {}
+
+    // a type descriptor per name, shared by every class that has it as a base
+    uint32_t typeDescriptor(const std::string& name) {
+        auto it = descriptors.find(name);
+        if (it != descriptors.end()) {
+            return it->second;
+        }
+
+        std::string mangled = ".?AV" + name + "@@";
+        uint32_t rva = allocate(data, 2 * pointerSize() + static_cast<uint32_t>(mangled.size()) + 1);
+        putPointer(rva, base + 0x1000); // type_info's vtable, never looked at
+        memcpy(image.bytes.data() + rva + 2 * pointerSize(), mangled.c_str(), mangled.size() + 1);
+        descriptors[name] = rva;
+        return rva;
+    }
+
+    uint32_t hierarchy(const plantedClass& planted, uint32_t numBaseClasses) {
+        std::vector<std::string> names = { planted.name };
+        names.insert(names.end(), planted.bases.begin(), planted.bases.end());
+
+        // base class descriptors, then the array of them, then the hierarchy itself
+        std::vector<uint32_t> classDescriptors;
+        for (auto& name : names) {
+            uint32_t descriptor = allocate(rdata, 28);
+            putReference(descriptor, typeDescriptor(name));
+            classDescriptors.push_back(descriptor);
+        }
+
+        uint32_t array = allocate(rdata, static_cast<uint32_t>(4 * names.size()));
+        for (size_t i = 0; i < names.size(); i++) {
+            putReference(array + static_cast<uint32_t>(4 * i), classDescriptors[i]);
+        }
+
+        uint32_t rva = allocate(rdata, 16);
+        put32(rva + 8, numBaseClasses ? numBaseClasses : static_cast<uint32_t>(names.size()));
+        putReference(rva + 12, array);
+        return rva;
+    }
+
+    uint32_t locator(uint32_t offset, uint32_t typeDescriptorRva, uint32_t hierarchyRva) {
+        uint32_t rva = allocate(rdata, is32Bit ? 20 : 24);
+        put32(rva, is32Bit ? 0 : 1);
+        put32(rva + 4, offset);
+        putReference(rva + 12, typeDescriptorRva);
+        putReference(rva + 16, hierarchyRva);
+        if (!is32Bit) {
+            put32(rva + 20, rva);
+        }
+        return rva;
+    }
+
+    // the locator pointer, then a few function pointers into .text
+    uintptr_t vtable(uint32_t locatorRva) {
+        uint32_t rva = allocate(rdata, 4 * pointerSize());
+        putPointer(rva, base + locatorRva);
+        for (uint32_t i = 1; i < 4; i++) {
+            putPointer(rva + i * pointerSize(), base + 0x1000 + 0x40 * i);
+        }
+        return base + rva + pointerSize();
+    }
+
+    plantedType plant(const plantedClass& planted) {
+        plantedType result{ planted.name, " : " + planted.name, {}, 0 };
+        for (auto& name : planted.bases) {
+            result.hierarchy += " : " + name;
+        }
+
+        uint32_t hierarchyRva = hierarchy(planted, 0);
+        for (uint32_t offset : planted.offsets) {
+            uint32_t locatorRva = locator(offset, typeDescriptor(planted.name), hierarchyRva);
+            if (!planted.referenced) {
+                continue;
+            }
+            uintptr_t address = vtable(locatorRva);
+            result.vtables.push_back(address);
+            if (offset == 0) {
+                result.primaryVtable = address;
+            }
+        }
+        std::sort(result.vtables.begin(), result.vtables.end());
+        return result;
+    }
+
+    uint32_t pointerSize() const { return is32Bit ? 4 : 8; }
+
+    uint32_t allocate(uint32_t& next, uint32_t size) {
+        uint32_t rva = next;
+        next += (size + 7) & ~7u;
+        return rva;
+    }
+
+    void put32(uint32_t rva, uint32_t value) {
+        memcpy(image.bytes.data() + rva, &value, 4);
+    }
+
+    void putPointer(uint32_t rva, uintptr_t value) {
+        memcpy(image.bytes.data() + rva, &value, pointerSize());
+    }
+
+    // image relative on x64, absolute on x86
+    void putReference(uint32_t rva, uint32_t target) {
+        put32(rva, is32Bit ? static_cast<uint32_t>(base + target) : target);
+    }
+
+    testImage& image;
+    uintptr_t base;
+    bool is32Bit;
+    uint32_t rdata;
+    uint32_t data;
+    std::unordered_map<std::string, uint32_t> descriptors;
+};
+
+struct plantedModule {
+    testImage image;
+    uintptr_t base;
+    bool is32Bit;
+    std::vector<plantedType> types; // sorted by name
+    std::vector<uintptr_t> bogusVtables; // behind locators that must not be accepted
+};
+
+static plantedModule buildModule(uintptr_t base, bool is32Bit, uint32_t seed) {
+    testImageOptions options;
+    options.exportCount = 50;
+    options.is64Bit = !is32Bit;
+    options.seed = seed;
+    options.spareSize = 0x8000;
+
+    plantedModule module{ buildTestImage(options), base, is32Bit, {}, {} };
+    rttiPlanter planter(module.image, base, is32Bit);
+
+    // single, chained and multiple inheritance, the last has a second vtable for its second base
+    const plantedClass classes[] = {
+        { "Entity", {}, { 0 } },
+        { "Player", { "Entity" }, { 0 } },
+        { "LocalPlayer", { "Player", "Entity" }, { 0 } },
+        { "IDrawable", {}, { 0 } },
+        { "Widget", { "Entity", "IDrawable" }, { 0, 16 } },
+        { "Orphan", {}, { 0 }, false }, // a locator no vtable points at
+    };
+    for (auto& planted : classes) {
+        auto type = planter.plant(planted);
+        if (!type.vtables.empty()) {
+            module.types.push_back(std::move(type));
+        }
+    }
+    std::sort(module.types.begin(), module.types.end(), [](const plantedType& a, const plantedType& b) { return a.name < b.name; });
+
+    // near misses, each one behind a vtable pointer that looks just like a real one
+    uint32_t goodDescriptor = planter.typeDescriptor("Entity");
+    uint32_t goodHierarchy = planter.hierarchy(classes[0], 0);
+    auto bogus = [&](uint32_t locatorRva) { module.bogusVtables.push_back(planter.vtable(locatorRva)); };
+
+    uint32_t wrongSignature = planter.locator(0, goodDescriptor, goodHierarchy);
+    planter.put32(wrongSignature, is32Bit ? 1 : 0);
+    bogus(wrongSignature);
+
+    uint32_t outsideDescriptor = planter.locator(0, goodDescriptor, goodHierarchy);
+    planter.put32(outsideDescriptor + 12, is32Bit ? 0x1000 : static_cast<uint32_t>(module.image.bytes.size() + 0x100));
+    bogus(outsideDescriptor);
+
+    uint32_t outsideHierarchy = planter.locator(0, goodDescriptor, goodHierarchy);
+    planter.put32(outsideHierarchy + 16, is32Bit ? static_cast<uint32_t>(base + module.image.bytes.size()) : 0xFFFFFF00);
+    bogus(outsideHierarchy);
+
+    // a descriptor whose name isn't a mangled class name
+    uint32_t unnamed = planter.allocate(planter.data, 32);
+    memcpy(module.image.bytes.data() + unnamed + 2 * planter.pointerSize(), "Entity", 7);
+    bogus(planter.locator(0, unnamed, goodHierarchy));
+
+    // too many base classes to be real
+    bogus(planter.locator(0, planter.typeDescriptor("Huge"), planter.hierarchy({ "Huge", {}, { 0 } }, rttiIndex::MAX_BASE_CLASSES + 1)));
+
+    if (!is32Bit) {
+        uint32_t wrongSelf = planter.locator(0, goodDescriptor, goodHierarchy);
+        planter.put32(wrongSelf + 20, wrongSelf + 4);
+        bogus(wrongSelf);
+    }
+
+    return module;
+}
+
+static rttiScanModule scanModuleOf(const plantedModule& module, const std::string& name) {
+    rttiScanModule scan{ name, module.base, module.image.bytes.size(), {} };
+    for (auto& section : module.image.sections) {
+        std::string_view sectionName(section.name, strnlen(section.name, sizeof(section.name)));
+        if (sectionName == ".rdata" || sectionName == ".data") {
+            scan.sections.push_back({ module.base + section.rva, section.size, sectionName == ".rdata" });
+        }
+    }
+    return scan;
+}
+
+static void checkTypes(const plantedModule& module, const rttiModuleTypes* types) {
+    CHECK(types != nullptr);
+    if (!types) {
+        return;
+    }
+
+    CHECK(types->types.size() == module.types.size());
+    for (size_t i = 0; i < module.types.size() && i < types->types.size(); i++) {
+        auto& expected = module.types[i];
+        auto& found = types->types[i];
+        CHECK(found.name == expected.name);
+        CHECK(found.hierarchy == expected.hierarchy);
+        CHECK(found.vtables == expected.vtables);
+        CHECK(found.primaryVtable == expected.primaryVtable);
+
+        for (uintptr_t vtable : expected.vtables) {
+            auto it = types->vtables.find(vtable);
+            CHECK(it != types->vtables.end() && types->types[it->second].name == expected.name);
+        }
+    }
+
+    for (uintptr_t vtable : module.bogusVtables) {
+        CHECK(!types->vtables.count(vtable));
+    }
+}
+
+static void checkModule(bool is32Bit) {
+    uintptr_t base = is32Bit ? 0x10000000 : 0x7FF700000000;
+    auto module = buildModule(base, is32Bit, is32Bit ? 3 : 2);
+    CHECK(module.types.size() == 5 && module.bogusVtables.size() == (is32Bit ? 5u : 6u));
+
+    bufferSource source;
+    source.x86 = is32Bit;
+    memcpy(source.map(base, module.image.bytes.size(), protect_read, region_image), module.image.bytes.data(), module.image.bytes.size());
+
+    std::atomic<bool> cancel = false;
+    auto scan = scanModuleOf(module, "game.exe");
+
+    // copied a chunk at a time
+    auto copied = rttiIndex::scanModule(source, is32Bit, scan, cancel);
+    checkTypes(module, copied.get());
+    CHECK(source.reads == 2); // .rdata and .data, one chunk each
+
+    // used in place, nothing is read
+    source.canView = true;
+    source.resetCounters();
+    auto viewed = rttiIndex::scanModule(source, is32Bit, scan, cancel);
+    checkTypes(module, viewed.get());
+    CHECK(source.reads == 0);
+    source.canView = false;
+
+    // an unreadable page in the spare room sends its chunk back to page reads, the types are all still found
+    source.badPages.insert((base + module.image.rdataSpare + 0x7000) & ~uintptr_t(0xFFF));
+    source.resetCounters();
+    auto guarded = rttiIndex::scanModule(source, is32Bit, scan, cancel);
+    checkTypes(module, guarded.get());
+    CHECK(source.reads > 3);
+    source.badPages.clear();
+
+    cancel = true;
+    CHECK(rttiIndex::scanModule(source, is32Bit, scan, cancel) == nullptr);
+}
+
+// the background index: modules are indexed once, kept while loaded where they were and dropped once gone
+static void checkIndex() {
+    auto first = buildModule(0x7FF700000000, false, 4);
+    auto second = buildModule(0x7FF800000000, false, 5);
+
+    auto source = std::make_shared<bufferSource>();
+    for (auto module : { &first, &second }) {
+        memcpy(source->map(module->base, module->image.bytes.size(), protect_read, region_image), module->image.bytes.data(), module->image.bytes.size());
+    }
+
+    auto wait = [](rttiIndex& index) {
+        for (int i = 0; i < 1000 && index.busy(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    };
+
+    rttiIndex index;
+    index.start(source, false, { scanModuleOf(first, "first.dll"), scanModuleOf(second, "second.dll") });
+    wait(index);
+    auto snapshot = index.current();
+    CHECK(index.modulesDone == 2 && snapshot->modules.size() == 2 && snapshot->typeCount() == 10);
+
+    auto type = snapshot->findVtable(first.types[0].primaryVtable);
+    CHECK(type && type->name == first.types[0].name);
+    CHECK(!snapshot->findVtable(second.bogusVtables[0]));
+    CHECK(snapshot->findClass("Widget").size() == 2);
+    CHECK(snapshot->findClass("Huge").empty());
+
+    // the same modules again are not read at all, a module that's gone is dropped
+    source->resetCounters();
+    index.start(source, false, { scanModuleOf(first, "first.dll"), scanModuleOf(second, "second.dll") });
+    wait(index);
+    CHECK(source->reads == 0 && index.current()->modules == snapshot->modules);
+
+    index.start(source, false, { scanModuleOf(second, "second.dll") });
+    wait(index);
+    CHECK(source->reads == 0);
+    CHECK(index.current()->modules.size() == 1 && index.current()->modules[0] == snapshot->modules[1]);
+    CHECK(!index.current()->findVtable(first.types[0].primaryVtable));
+
+    index.clear();
+    CHECK(index.current()->modules.empty());
+}
+
+int main() {
+    checkModule(false);
+    checkModule(true);
+    checkIndex();
+
+    return testResult("rttiindex_test");
+}
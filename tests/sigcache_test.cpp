@@ -0,0 +1,157 @@
+#include <atomic>
+#include <filesystem>
+#include <thread>
+
+#include "sigcache.h"
+#include "testimage.h"
+#include "testsource.h"
+
+// the signature cache the way scanPattern uses it: a verified hit or a scan that's stored for next time. a cold
+// scan, a warm one with the module loaded somewhere else, then the same build with a patched page the code hash
+// doesn't sample. every result has to equal a findPattern that knows nothing of the cache
+
+struct cachedScan {
+    std::vector<uintptr_t> matches;
+    bool hit = false;
+};
+
+static cachedScan scanModule(signatureCache& cache, memorySource& source, const signatureKey& key, uintptr_t base, const testImage& image,
+    const patternMatcher& matcher) {
+    cachedScan result;
+    if ((result.hit = loadVerifiedMatches(cache, source, key, base, matcher, result.matches))) {
+        return result;
+    }
+
+    result.matches = findPattern(source, base, image.bytes.size(), matcher);
+    storeModuleMatches(cache, key, base, image.bytes.size(), result.matches);
+    cache.save();
+    return result;
+}
+
+int main() {
+    auto path = (std::filesystem::temp_directory_path() / "imclass_sigcache_test.bin").string();
+    std::filesystem::remove(path);
+
+    testImageOptions options;
+    options.seed = 23;
+    auto image = buildTestImage(options);
+    const uint32_t textRva = image.sections[0].rva;
+
+    // "48 8B 05 ? ? ? ? 48 85 C0 74 ? E8" planted a few times around the middle of .text
+    const uint8_t bytes[] = { 0x48, 0x8B, 0x05, 0x00, 0x00, 0x00, 0x00, 0x48, 0x85, 0xC0, 0x74, 0x00, 0xE8 };
+    const uint64_t fixed = 0b1'0111'1000'0111;
+    const uint32_t planted[] = { textRva + 0x8010, textRva + 0x9A31, textRva + 0xC7F2, textRva + 0xC800 };
+    for (uint32_t rva : planted) {
+        memcpy(image.bytes.data() + rva, bytes, sizeof(bytes));
+        image.bytes[rva + 3] = static_cast<uint8_t>(rva);
+    }
+    patternMatcher matcher(bytes, &fixed, sizeof(bytes));
+
+    // the code hash is a sample, here of the first page of .text only, patches further in slip past it
+    signatureKey key;
+    key.module = testIdentity(image, "game.exe");
+    key.codeHash = fnv1a(image.bytes.data() + textRva, 0x1000);
+    key.patternHash = fnv1a(bytes, sizeof(bytes), fnv1a(&fixed, sizeof(fixed)));
+
+    auto load = [&](bufferSource& source, uintptr_t base) {
+        memcpy(source.map(base, image.bytes.size(), protect_read, region_image), image.bytes.data(), image.bytes.size());
+    };
+
+    // cold: nothing cached, a full scan
+    bufferSource first;
+    const uintptr_t firstBase = 0x7FF700000000;
+    load(first, firstBase);
+    {
+        signatureCache cache;
+        CHECK(!cache.open(path));
+        auto cold = scanModule(cache, first, key, firstBase, image, matcher);
+        CHECK(!cold.hit);
+        CHECK(cold.matches == findPattern(first, firstBase, image.bytes.size(), matcher));
+        CHECK(cold.matches.size() == std::size(planted));
+    }
+
+    // warm: the next session has the module somewhere else, only the cached matches are read back
+    bufferSource second;
+    const uintptr_t secondBase = 0x7FF612340000;
+    load(second, secondBase);
+    signatureCache cache;
+    CHECK(cache.open(path));
+    second.resetCounters();
+    auto warm = scanModule(cache, second, key, secondBase, image, matcher);
+    CHECK(warm.hit);
+    CHECK(second.bytesRead == std::size(planted) * sizeof(bytes));
+    CHECK(warm.matches == findPattern(second, secondBase, image.bytes.size(), matcher));
+
+    // a wildcard byte changing is still a match
+    second.at(secondBase + planted[0])[4] ^= 0xFF;
+    CHECK(scanModule(cache, second, key, secondBase, image, matcher).hit);
+
+    // patched: same identity and code hash, one match gone. that's a miss and a rescan, which is what gets stored
+    second.at(secondBase + planted[2])[8] = 0x90;
+    auto patched = scanModule(cache, second, key, secondBase, image, matcher);
+    CHECK(!patched.hit);
+    CHECK(patched.matches == findPattern(second, secondBase, image.bytes.size(), matcher));
+    CHECK(patched.matches.size() == std::size(planted) - 1);
+
+    auto again = scanModule(cache, second, key, secondBase, image, matcher);
+    CHECK(again.hit && again.matches == patched.matches);
+
+    // a match that can't be read back isn't trusted either
+    second.badPages.insert((secondBase + planted[1]) & ~uintptr_t(0xFFF));
+    std::vector<uintptr_t> unreadable;
+    CHECK(!loadVerifiedMatches(cache, second, key, secondBase, matcher, unreadable));
+    second.badPages.clear();
+
+    // a signature that didn't match has nothing to verify and is scanned for every time
+    const uint8_t missing[] = { 0xDE, 0xAD, 0xBE, 0xEF, 0x13, 0x37 };
+    const uint64_t allFixed = 0x3F;
+    patternMatcher missingMatcher(missing, &allFixed, sizeof(missing));
+    signatureKey missingKey = key;
+    missingKey.patternHash = fnv1a(missing, sizeof(missing));
+    CHECK(scanModule(cache, second, missingKey, secondBase, image, missingMatcher).matches.empty());
+    CHECK(!scanModule(cache, second, missingKey, secondBase, image, missingMatcher).hit);
+
+    // another build of the module never sees these entries
+    signatureKey rebuilt = key;
+    rebuilt.module.timeDateStamp++;
+    std::vector<uint32_t> rvas;
+    CHECK(!cache.load(rebuilt, rvas));
+
+    // lookups from other threads while the file is saved and remapped
+    std::atomic<bool> stop = false;
+    std::atomic<uint64_t> lookups = 0, misses = 0;
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < 4; t++) {
+        readers.emplace_back([&] {
+            std::vector<uint32_t> found;
+            while (!stop) {
+                if (!cache.load(key, found) || found.size() != patched.matches.size()) {
+                    misses++;
+                }
+                lookups++;
+                std::this_thread::yield(); // glibc's shared_mutex prefers readers, see modcache_test
+            }
+        });
+    }
+    while (lookups < 1000) {
+        std::this_thread::yield();
+    }
+    for (uint32_t round = 0; round < 20; round++) {
+        signatureKey other = key;
+        other.patternHash = round;
+        cache.store(other, { round });
+        CHECK(cache.save());
+    }
+    stop = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    CHECK(misses == 0);
+
+    std::filesystem::remove(path);
+    std::printf("%zu cached matches verified with %llu bytes read instead of a %zu byte scan, %llu lookups during 20 saves\n",
+        std::size(planted), static_cast<unsigned long long>(std::size(planted) * sizeof(bytes)), image.bytes.size(),
+        static_cast<unsigned long long>(lookups.load()));
+
+    return testResult("sigcache_test");
+}
@@ -0,0 +1,273 @@
+#include <random>
+
+#include "siggen.h"
+#include "testsource.h"
+
+// the instruction decoder on known encodings (rex, vex, evex, the 0f 38 and 0f 3a maps, operand and address size
+// prefixes, modrm with sib and displacements, rip relative, moffs, enter and group3), then generatePattern over
+// random code with copied runs and guard pages, where every pattern it calls unique has to be found exactly once
+// by findPattern and one fixed byte less has to match more than once, and a timing over 50 MB
+
+struct knownEncoding {
+    const char* name;
+    std::vector<uint8_t> code;
+    bool is64Bit;
+    size_t length;
+    size_t dispOffset, dispSize;
+    bool ripRelative;
+    size_t immOffset, immSize;
+    bool relative, address;
+};
+
+static void checkDecode() {
+    const knownEncoding encodings[] = {
+        // rex and operand size
+        { "mov rax, imm64", { 0x48, 0xB8, 1, 2, 3, 4, 5, 6, 7, 8 }, true, 10, 0, 0, false, 2, 8, false, false },
+        { "mov eax, imm32", { 0xB8, 1, 2, 3, 4 }, true, 5, 0, 0, false, 1, 4, false, false },
+        { "mov ax, imm16", { 0x66, 0xB8, 1, 2 }, true, 4, 0, 0, false, 2, 2, false, false },
+        { "add rsp, imm8", { 0x48, 0x83, 0xC4, 0x28 }, true, 4, 0, 0, false, 3, 1, false, false },
+        { "inc eax in x86", { 0x40 }, false, 1, 0, 0, false, 1, 0, false, false },
+
+        // vex and evex
+        { "vzeroupper", { 0xC5, 0xF8, 0x77 }, true, 3, 0, 0, false, 3, 0, false, false },
+        { "vmovdqa ymm0, [rip]", { 0xC5, 0xFD, 0x6F, 0x05, 1, 2, 3, 4 }, true, 8, 4, 4, true, 8, 0, false, false },
+        { "vpbroadcastd ymm0, xmm0", { 0xC4, 0xE2, 0x7D, 0x58, 0xC0 }, true, 5, 0, 0, false, 5, 0, false, false },
+        { "vinsertf128 ymm0, ymm0, xmm1, 1", { 0xC4, 0xE3, 0x7D, 0x18, 0xC1, 0x01 }, true, 6, 0, 0, false, 5, 1, false, false },
+        { "vmovups zmm0, [rsp+0x40]", { 0x62, 0xF1, 0x7C, 0x48, 0x10, 0x44, 0x24, 0x01 }, true, 8, 7, 1, false, 8, 0, false, false },
+        { "les eax, [disp32] in x86", { 0xC4, 0x05, 1, 2, 3, 4 }, false, 6, 2, 4, false, 6, 0, false, false },
+        { "vpxor in x86", { 0xC5, 0xF1, 0xEF, 0xC0 }, false, 4, 0, 0, false, 4, 0, false, false },
+
+        // 0f, 0f 38 and 0f 3a
+        { "pshufb xmm0, xmm1", { 0x66, 0x0F, 0x38, 0x00, 0xC1 }, true, 5, 0, 0, false, 5, 0, false, false },
+        { "palignr xmm0, xmm1, 8", { 0x66, 0x0F, 0x3A, 0x0F, 0xC1, 0x08 }, true, 6, 0, 0, false, 5, 1, false, false },
+        { "je rel32", { 0x0F, 0x84, 1, 2, 3, 4 }, true, 6, 0, 0, false, 2, 4, true, false },
+        { "movzx eax, byte [rcx+8]", { 0x0F, 0xB6, 0x41, 0x08 }, true, 4, 3, 1, false, 4, 0, false, false },
+
+        // modrm, sib and displacements
+        { "mov eax, [rsp]", { 0x8B, 0x04, 0x24 }, true, 3, 3, 0, false, 3, 0, false, false },
+        { "mov eax, [esp] with 67", { 0x67, 0x8B, 0x04, 0x24 }, true, 4, 4, 0, false, 4, 0, false, false },
+        { "mov eax, [rsp+disp32]", { 0x8B, 0x84, 0x24, 1, 2, 3, 4 }, true, 7, 3, 4, false, 7, 0, false, false },
+        { "mov eax, [disp32] through sib", { 0x8B, 0x04, 0x25, 1, 2, 3, 4 }, true, 7, 3, 4, false, 7, 0, false, false },
+        { "mov rax, [rip]", { 0x48, 0x8B, 0x05, 1, 2, 3, 4 }, true, 7, 3, 4, true, 7, 0, false, false },
+        { "mov eax, [disp32] in x86", { 0x8B, 0x05, 1, 2, 3, 4 }, false, 6, 2, 4, false, 6, 0, false, false },
+        { "mov ax, [bp+2] in x86", { 0x67, 0x8B, 0x46, 0x02 }, false, 4, 3, 1, false, 4, 0, false, false },
+        { "mov ax, [disp16] in x86", { 0x67, 0x8B, 0x06, 1, 2 }, false, 5, 3, 2, false, 5, 0, false, false },
+        { "mov dword [rbp-8], imm32", { 0xC7, 0x45, 0xF8, 1, 2, 3, 4 }, true, 7, 2, 1, false, 3, 4, false, false },
+
+        // moffs by address size
+        { "mov eax, moffs64", { 0xA1, 1, 2, 3, 4, 5, 6, 7, 8 }, true, 9, 0, 0, false, 1, 8, false, true },
+        { "mov eax, moffs32 with 67", { 0x67, 0xA1, 1, 2, 3, 4 }, true, 6, 0, 0, false, 2, 4, false, true },
+        { "mov eax, moffs32 in x86", { 0xA1, 1, 2, 3, 4 }, false, 5, 0, 0, false, 1, 4, false, true },
+        { "mov eax, moffs16 in x86", { 0x67, 0xA1, 1, 2 }, false, 4, 0, 0, false, 2, 2, false, true },
+
+        // enter and group3, where only test takes an immediate
+        { "enter 16, 0", { 0xC8, 0x10, 0x00, 0x00 }, true, 4, 0, 0, false, 1, 3, false, false },
+        { "test cl, 1", { 0xF6, 0xC1, 0x01 }, true, 3, 0, 0, false, 2, 1, false, false },
+        { "test ecx, imm32", { 0xF7, 0xC1, 1, 2, 3, 4 }, true, 6, 0, 0, false, 2, 4, false, false },
+        { "test cx, imm16", { 0x66, 0xF7, 0xC1, 1, 2 }, true, 5, 0, 0, false, 3, 2, false, false },
+        { "test rcx, imm32", { 0x48, 0xF7, 0xC1, 1, 2, 3, 4 }, true, 7, 0, 0, false, 3, 4, false, false },
+        { "test byte [rax+1], imm8", { 0xF6, 0x40, 0x01, 0x02 }, true, 4, 2, 1, false, 3, 1, false, false },
+        { "not al", { 0xF6, 0xD0 }, true, 2, 0, 0, false, 2, 0, false, false },
+        { "neg eax", { 0xF7, 0xD8 }, true, 2, 0, 0, false, 2, 0, false, false },
+        { "div dword [rcx]", { 0xF7, 0x31 }, true, 2, 2, 0, false, 2, 0, false, false },
+
+        // branches
+        { "call rel32", { 0xE8, 1, 2, 3, 4 }, true, 5, 0, 0, false, 1, 4, true, false },
+        { "jmp rel8", { 0xEB, 0x10 }, true, 2, 0, 0, false, 1, 1, true, false },
+        { "call far in x86", { 0x9A, 1, 2, 3, 4, 5, 6 }, false, 7, 0, 0, false, 1, 6, false, true },
+    };
+
+    for (auto& known : encodings) {
+        instructionLayout layout;
+        bool decoded = decodeInstruction(known.code.data(), known.code.size(), known.is64Bit, &layout);
+        bool same = decoded && layout.length == known.length && layout.dispOffset == known.dispOffset &&
+            layout.dispSize == known.dispSize && layout.ripRelative == known.ripRelative &&
+            layout.immOffset == known.immOffset && layout.immSize == known.immSize &&
+            layout.relative == known.relative && layout.address == known.address;
+        if (!same) {
+            std::printf("%s: length %zu, disp %zu+%zu, imm %zu+%zu\n", known.name, layout.length, layout.dispOffset,
+                layout.dispSize, layout.immOffset, layout.immSize);
+        }
+        CHECK(same);
+
+        // cut short anywhere, it no longer decodes
+        for (size_t size = 0; size < known.length; size++) {
+            CHECK(!decodeInstruction(known.code.data(), size, known.is64Bit, &layout));
+        }
+    }
+
+    // opcodes x64 dropped, and more than 15 bytes of prefixes
+    instructionLayout layout;
+    const uint8_t push = 0x06, pusha = 0x60;
+    CHECK(!decodeInstruction(&push, 1, true, &layout) && decodeInstruction(&push, 1, false, &layout));
+    CHECK(!decodeInstruction(&pusha, 1, true, &layout));
+    std::vector<uint8_t> prefixed(15, 0x66);
+    prefixed.push_back(0x90);
+    CHECK(!decodeInstruction(prefixed.data(), prefixed.size(), true, &layout));
+
+    // the layout wildcards displacements of 32 bits, branch targets, addresses and wide immediates
+    const uint8_t code[] = {
+        0x48, 0x8B, 0x05, 1, 2, 3, 4, // mov rax, [rip]
+        0x83, 0xF8, 0x05, // cmp eax, 5
+        0xE8, 1, 2, 3, 4, // call
+        0x8B, 0x41, 0x08, // mov eax, [rcx+8]
+    };
+    std::vector<uint8_t> bytes, masks;
+    CHECK(layoutPattern(code, sizeof(code), true, {}, bytes, masks) == sizeof(code));
+    const uint8_t expected[] = { 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1 };
+    for (size_t i = 0; i < sizeof(code) && i < masks.size(); i++) {
+        CHECK((masks[i] != 0) == (expected[i] != 0));
+        CHECK(bytes[i] == (expected[i] ? code[i] : 0));
+    }
+}
+
+// instructions of the usual shapes, the x bytes are filled with random values
+static const std::vector<std::vector<int>> shapes = {
+    { 0x48, 0x8B, 0x05, -1, -1, -1, -1 }, // mov rax, [rip]
+    { 0x48, 0x89, 0x5C, 0x24, -1 }, // mov [rsp+x], rbx
+    { 0x48, 0x83, 0xEC, -1 }, // sub rsp, x
+    { 0x48, 0x85, 0xC0 }, // test rax, rax
+    { 0x74, -1 }, // je
+    { 0x0F, 0x84, -1, -1, -1, -1 }, // je rel32
+    { 0xE8, -1, -1, -1, -1 }, // call
+    { 0x8B, 0x41, -1 }, // mov eax, [rcx+x]
+    { 0x48, 0x8B, 0x8C, 0x24, -1, -1, 0, 0 }, // mov rcx, [rsp+x]
+    { 0xB9, -1, -1, 0, 0 }, // mov ecx, x
+    { 0xC5, 0xF8, 0x10, 0x44, 0x24, -1 }, // vmovups xmm0, [rsp+x]
+    { 0x66, 0x0F, 0x3A, 0x0F, 0xC1, -1 }, // palignr
+    { 0xF6, 0xC1, -1 }, // test cl, x
+    { 0x33, 0xC0 }, // xor eax, eax
+    { 0x90 },
+    { 0xC3 },
+    { 0xCC },
+};
+
+static void emitCode(std::mt19937_64& rng, uint8_t* out, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        auto& shape = shapes[rng() % shapes.size()];
+        for (size_t j = 0; j < shape.size() && i < size; j++, i++) {
+            out[i] = shape[j] < 0 ? static_cast<uint8_t>(rng() % (rng() % 4 ? 16 : 256)) : static_cast<uint8_t>(shape[j]);
+        }
+    }
+}
+
+// addresses of instruction starts aren't tracked, a pattern from the middle of one just decodes differently
+static std::vector<uintptr_t> findGenerated(bufferSource& source, const std::vector<scanRange>& ranges, const generatedPattern& generated, size_t length) {
+    std::vector<uint64_t> fixed((length + 63) / 64);
+    for (size_t i = 0; i < length; i++) {
+        if (generated.masks[i]) {
+            fixed[i / 64] |= uint64_t(1) << (i % 64);
+        }
+    }
+    patternMatcher matcher(generated.bytes.data(), fixed.data(), length);
+    return findPattern(source, ranges, matcher, {});
+}
+
+// a few ranges of generated code, with runs of it copied into other places (some right at a range end) so the
+// patterns have to grow past them, and guard pages
+static void checkDifferential(std::mt19937_64& rng) {
+    for (size_t round = 0; round < 30; round++) {
+        bufferSource source;
+        std::vector<scanRange> ranges;
+        uintptr_t base = 0x140001000;
+        for (size_t i = 0; i < 1 + rng() % 4; i++) {
+            size_t size = (1 + rng() % 24) * 0x1000 - (rng() % 2 ? rng() % 0x100 : 0);
+            emitCode(rng, source.map(base, size), size);
+            ranges.push_back({ base, size });
+            base += ((size + 0xFFF) & ~size_t(0xFFF)) + 0x1000 * (rng() % 3);
+        }
+        if (rng() % 2) {
+            auto& range = ranges[rng() % ranges.size()];
+            source.badPages.insert(range.base + (rng() % ((range.size + 0xFFF) / 0x1000)) * 0x1000);
+        }
+
+        for (size_t copy = 0; copy < 20; copy++) {
+            auto& from = ranges[rng() % ranges.size()];
+            auto& to = ranges[rng() % ranges.size()];
+            size_t length = (std::min)({ size_t(8 + rng() % 200), from.size, to.size });
+            uintptr_t copyFrom = from.base + rng() % (from.size - length + 1);
+            uintptr_t copyTo = rng() % 4 ? to.base + rng() % (to.size - length + 1) : to.base + to.size - length;
+            memmove(source.at(copyTo), source.at(copyFrom), length);
+        }
+
+        signatureOptions options;
+        options.maxLength = 32 + rng() % 96;
+        options.seedBytes = 1 + rng() % 6;
+        options.windowBatch = 1 + rng() % 64;
+        options.wildcardImmediates = rng() % 2;
+        options.scan.chunkSize = 0x1000 << (rng() % 3);
+        options.scan.threads = 1 + static_cast<unsigned>(rng() % 3);
+        source.canView = rng() % 2;
+
+        for (size_t pick = 0; pick < 40; pick++) {
+            auto& range = ranges[rng() % ranges.size()];
+            uintptr_t address = range.base + rng() % range.size;
+
+            generatedPattern generated;
+            bool unique = generatePattern(source, ranges, address, true, generated, options);
+            CHECK(unique == generated.unique);
+            if (generated.bytes.empty()) {
+                continue; // nothing decodes there, or it can't be read
+            }
+            CHECK(generated.bytes.size() <= options.maxLength);
+            if (!unique) {
+                continue;
+            }
+
+            auto found = findGenerated(source, ranges, generated, generated.bytes.size());
+            CHECK(found.size() == 1 && found[0] == address);
+            CHECK(generated.candidates == 1);
+            CHECK(generated.masks.back() != 0); // never ends in a wildcard
+
+            // shortest: without its last fixed byte the pattern matches somewhere else too, unless the seed alone was
+            // already unique. an unreadable window reads as zeros and can keep a candidate longer, so only without
+            // guard pages
+            size_t fixed = std::count_if(generated.masks.begin(), generated.masks.end(), [](uint8_t mask) { return mask != 0; });
+            if (fixed > options.seedBytes && source.badPages.empty()) {
+                size_t shorter = generated.bytes.size() - 1;
+                while (!generated.masks[shorter - 1]) {
+                    shorter--;
+                }
+                CHECK(findGenerated(source, ranges, generated, shorter).size() > 1);
+            }
+        }
+    }
+}
+
+// 50 MB of generated code, signatures for a few addresses across it
+static void benchLargeRange(std::mt19937_64& rng) {
+    const size_t size = 50 * 1024 * 1024;
+    bufferSource source;
+    uintptr_t base = 0x140001000;
+    emitCode(rng, source.map(base, size), size);
+    std::vector<scanRange> ranges = { { base, size } };
+
+    double total = 0;
+    size_t unique = 0, bytes = 0;
+    const size_t count = 8;
+    for (size_t i = 0; i < count; i++) {
+        uintptr_t address = base + rng() % size;
+        generatedPattern generated;
+        source.resetCounters();
+
+        auto start = std::chrono::steady_clock::now();
+        unique += generatePattern(source, ranges, address, true, generated);
+        total += msSince(start);
+        bytes += generated.bytes.size();
+        CHECK(generated.bytes.empty() || generated.bytesScanned == size);
+    }
+
+    std::printf("%zu MB, %zu signatures: %.1f ms each, %.2f GB/s, %zu unique, %.1f bytes long on average\n", size >> 20,
+        count, total / count, count * size / (total * 1e6), unique, double(bytes) / count);
+}
+
+int main() {
+    std::mt19937_64 rng(24);
+
+    checkDecode();
+    checkDifferential(rng);
+    benchLargeRange(rng);
+
+    return testResult("siggen_test");
+}
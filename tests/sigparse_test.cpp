@@ -0,0 +1,150 @@
+#include <random>
+
+#include "sigparse.h"
+#include "testsource.h"
+
+// the signature parser: literals checked while this file compiles, then the two text formats with wildcards,
+// backslash runs, odd digit counts, the length limit and type detection, and random patterns written out in
+// both formats that have to compile to the same bytes and mask
+
+using namespace pattern::literals;
+
+constexpr auto ida = "48 8B 05 ? ? ?? ?? 48 85 c0"_sig;
+static_assert(ida.type == PatternType::IDA_SIGNATURE && ida.length == 10);
+static_assert(ida.bytes[0] == 0x48 && ida.bytes[2] == 0x05 && ida.bytes[9] == 0xC0);
+static_assert(ida.isFixed(2) && !ida.isFixed(3) && !ida.isFixed(6) && ida.isFixed(7));
+static_assert(ida.bytes[3] == 0); // wildcards are zero
+
+constexpr auto bytePattern = "\\x48\\x8B\\x?\\x??\\x05"_sig;
+static_assert(bytePattern.type == PatternType::BYTE_PATTERN && bytePattern.length == 5);
+static_assert(bytePattern.isFixed(1) && !bytePattern.isFixed(2) && !bytePattern.isFixed(3) && bytePattern.bytes[4] == 0x05);
+
+static_assert(pattern::compilePattern("\\\\x48\\\\\\x8B")->length == 2); // escaped and double escaped
+static_assert(pattern::compilePattern("  48\t8B\n")->length == 2);
+
+static_assert(!pattern::compilePattern(""));
+static_assert(!pattern::compilePattern(" \t "));
+static_assert(!pattern::compilePattern("48 8")); // odd digit count
+static_assert(!pattern::compilePattern("488B")); // ida tokens have to be separated
+static_assert(!pattern::compilePattern("48 ??? 8B"));
+static_assert(!pattern::compilePattern("48 ?8B"));
+static_assert(!pattern::compilePattern("48 GG"));
+static_assert(!pattern::compilePattern("\\x48\\x8"));
+static_assert(!pattern::compilePattern("\\x4\\x8B"));
+static_assert(!pattern::compilePattern("\\x48\\y8B"));
+static_assert(!pattern::compilePattern("\\x48\\"));
+static_assert(!pattern::compilePattern("\\x48x"));
+
+static std::string repeat(std::string_view token, size_t count) {
+    std::string text;
+    for (size_t i = 0; i < count; i++) {
+        text += token;
+    }
+    return text;
+}
+
+static void checkParse() {
+    using pattern::compilePattern;
+
+    // a wildcard is one or two question marks in ida format and any run of them after \x
+    CHECK(compilePattern("? ?? 48")->length == 3);
+    CHECK(compilePattern("\\x???\\x48")->length == 2);
+    CHECK(!compilePattern("48 ? ??? 48"));
+
+    // a byte pattern is picked by its \x, so one that doesn't start with it still parses as one
+    auto mixed = compilePattern("48 \\x8B");
+    CHECK(mixed && mixed->type == PatternType::BYTE_PATTERN && mixed->length == 2);
+
+    // the type can be forced, ida text parses as a byte pattern but not the other way round
+    auto forced = compilePattern("48 8B", PatternType::BYTE_PATTERN);
+    CHECK(forced && forced->type == PatternType::BYTE_PATTERN && forced->length == 2 && forced->bytes[1] == 0x8B);
+    CHECK(!compilePattern("\\x48\\x8B", PatternType::IDA_SIGNATURE));
+    CHECK(!compilePattern("48 8B", PatternType::UNKNOWN));
+
+    // up to MAX_PATTERN_LENGTH bytes in either format, wildcards count
+    CHECK(compilePattern(repeat("48 ", MAX_PATTERN_LENGTH))->length == MAX_PATTERN_LENGTH);
+    CHECK(compilePattern(repeat("\\x48", MAX_PATTERN_LENGTH - 1) + "\\x?")->length == MAX_PATTERN_LENGTH);
+    CHECK(!compilePattern(repeat("48 ", MAX_PATTERN_LENGTH + 1)));
+    CHECK(!compilePattern(repeat("? ", MAX_PATTERN_LENGTH + 1)));
+    CHECK(!compilePattern(repeat("\\x48", MAX_PATTERN_LENGTH + 1)));
+
+    // odd digit counts anywhere in the text
+    for (auto text : { "4", "48 8B 0", "4 8B", "\\x4", "\\x48\\x8B\\x0", "\\x48\\x8B\\x" }) {
+        CHECK(!compilePattern(text));
+    }
+}
+
+static void checkDetect() {
+    auto info = pattern::detectPatternType("  48 8B ?? 05 \r\n");
+    CHECK(info && info->type == PatternType::IDA_SIGNATURE && info->pattern == "48 8B ?? 05");
+    CHECK(info && info->toString() == "IDA Signature");
+
+    info = pattern::detectPatternType("\t\\x48\\x8B\\x?");
+    CHECK(info && info->type == PatternType::BYTE_PATTERN && info->pattern == "\\x48\\x8B\\x?");
+    CHECK(info && info->toString() == "Byte Pattern");
+
+    CHECK(!pattern::detectPatternType(""));
+    CHECK(!pattern::detectPatternType("   "));
+    CHECK(!pattern::detectPatternType("48 8B 0"));
+    CHECK(!pattern::detectPatternType("hello"));
+}
+
+// the same random pattern written in both formats, with random case, spacing and backslash runs, has to compile
+// to the same bytes and mask as the pattern itself
+static void checkRandom() {
+    std::mt19937_64 rng(7);
+    const char* digits[] = { "0123456789ABCDEF", "0123456789abcdef" };
+    const char* spaces[] = { " ", "  ", "\t", " \n " };
+
+    for (int round = 0; round < 20000; round++) {
+        size_t length = 1 + rng() % (rng() % 8 == 0 ? MAX_PATTERN_LENGTH : 32);
+        std::vector<int> values(length);
+        for (auto& value : values) {
+            value = rng() % 4 == 0 ? -1 : static_cast<int>(rng() % 256);
+        }
+
+        std::string idaText, byteText;
+        for (size_t i = 0; i < length; i++) {
+            const char* hex = digits[rng() % 2];
+            idaText += i ? spaces[rng() % std::size(spaces)] : "";
+            if (values[i] < 0) {
+                idaText += rng() % 2 ? "?" : "??";
+                byteText += std::string(1 + rng() % 3, '\\') + "x" + std::string(1 + rng() % 2, '?');
+            }
+            else {
+                std::string byte = { hex[values[i] >> 4], hex[values[i] & 15] };
+                idaText += byte;
+                byteText += std::string(1 + rng() % 3, '\\') + "x" + byte;
+            }
+        }
+
+        auto fromIda = pattern::compilePattern(idaText);
+        auto fromBytes = pattern::compilePattern(byteText);
+        CHECK(fromIda && fromIda->type == PatternType::IDA_SIGNATURE);
+        CHECK(fromBytes && fromBytes->type == PatternType::BYTE_PATTERN);
+        if (!fromIda || !fromBytes) {
+            continue;
+        }
+
+        bool same = fromIda->length == length && fromBytes->length == length && fromIda->fixed == fromBytes->fixed && fromIda->bytes == fromBytes->bytes;
+        for (size_t i = 0; i < length && same; i++) {
+            same = fromIda->isFixed(i) == (values[i] >= 0) && fromIda->bytes[i] == (values[i] < 0 ? 0 : values[i]);
+        }
+        CHECK(same);
+
+        // cut anywhere inside a byte, the text no longer parses
+        size_t cut = idaText.find_last_not_of(" \t\n?");
+        if (cut != std::string::npos && values[length - 1] >= 0) {
+            CHECK(!pattern::compilePattern(std::string_view(idaText).substr(0, cut)));
+            CHECK(!pattern::compilePattern(std::string_view(byteText).substr(0, byteText.size() - 1)));
+        }
+    }
+}
+
+int main() {
+    checkParse();
+    checkDetect();
+    checkRandom();
+
+    return testResult("sigparse_test");
+}
@@ -0,0 +1,409 @@
+#include <random>
+
+#include "strscan.h"
+#include "testsource.h"
+
+// stringMatcher's scalar, sse2 and avx2 paths and findStrings against a naive search that compares one character
+// at a time, with the other case of a letter spelled out rather than folded in. random queries over ascii, latin-1,
+// utf-16 and characters outside the bmp, random buffers full of near misses, whole word checks right at chunk
+// borders and guard pages. then utf-8 decoding and the throughput of each path over 100 MB
+
+static const uint32_t alphabet[] = { 'a', 'b', 'z', 'A', 'Z', '1', '_', ' ', '.', 0xE9, 0xC9, 0xDF, 0xD7, 0xFF, 0x20AC, 0x1D11E };
+
+static std::string encodeUtf8(const std::vector<uint32_t>& codepoints) {
+    std::string text;
+    for (uint32_t c : codepoints) {
+        if (c < 0x80) {
+            text += static_cast<char>(c);
+        }
+        else if (c < 0x800) {
+            text += { static_cast<char>(0xC0 | (c >> 6)), static_cast<char>(0x80 | (c & 0x3F)) };
+        }
+        else if (c < 0x10000) {
+            text += { static_cast<char>(0xE0 | (c >> 12)), static_cast<char>(0x80 | ((c >> 6) & 0x3F)), static_cast<char>(0x80 | (c & 0x3F)) };
+        }
+        else {
+            text += { static_cast<char>(0xF0 | (c >> 18)), static_cast<char>(0x80 | ((c >> 12) & 0x3F)),
+                static_cast<char>(0x80 | ((c >> 6) & 0x3F)), static_cast<char>(0x80 | (c & 0x3F)) };
+        }
+    }
+    return text;
+}
+
+static std::vector<uint8_t> encodeUtf16(const std::vector<uint32_t>& codepoints) {
+    std::vector<uint8_t> bytes;
+    auto push = [&](uint32_t value) {
+        bytes.push_back(static_cast<uint8_t>(value));
+        bytes.push_back(static_cast<uint8_t>(value >> 8));
+    };
+    for (uint32_t c : codepoints) {
+        if (c >= 0x10000) {
+            push(0xD800 | ((c - 0x10000) >> 10));
+            push(0xDC00 | ((c - 0x10000) & 0x3FF));
+        }
+        else {
+            push(c);
+        }
+    }
+    return bytes;
+}
+
+static std::vector<uint8_t> encode(const std::vector<uint32_t>& codepoints, stringEncoding encoding) {
+    if (encoding == encoding_utf16) {
+        return encodeUtf16(codepoints);
+    }
+    std::string text = encodeUtf8(codepoints);
+    return std::vector<uint8_t>(text.begin(), text.end());
+}
+
+// the other case, for the letters that have one in latin-1
+static uint32_t otherCase(uint32_t c) {
+    if ((c >= 'A' && c <= 'Z') || (c >= 0xC0 && c <= 0xDE && c != 0xD7)) {
+        return c + 0x20;
+    }
+    if ((c >= 'a' && c <= 'z') || (c >= 0xE0 && c <= 0xFE && c != 0xF7)) {
+        return c - 0x20;
+    }
+    return c;
+}
+
+static bool isWordCharacter(uint32_t unit) {
+    return unit >= 0x80 || (unit >= 'a' && unit <= 'z') || (unit >= 'A' && unit <= 'Z') || (unit >= '0' && unit <= '9') || unit == '_';
+}
+
+// a character at a time, each one as itself or as its other case. the edges of data are word borders
+static std::vector<stringMatch> naiveFind(const std::vector<uint32_t>& query, const stringSearchOptions& options, stringEncoding encoding,
+    const uint8_t* data, size_t size, uintptr_t base) {
+    std::vector<std::vector<std::vector<uint8_t>>> characters;
+    size_t length = 0;
+    for (uint32_t c : query) {
+        std::vector<std::vector<uint8_t>> forms = { encode({ c }, encoding) };
+        if (options.caseInsensitive && otherCase(c) != c) {
+            forms.push_back(encode({ otherCase(c) }, encoding));
+        }
+        length += forms[0].size();
+        characters.push_back(std::move(forms));
+    }
+
+    const size_t unit = encoding == encoding_utf16 ? 2 : 1;
+    auto wordAt = [&](size_t offset) {
+        return unit == 2 ? isWordCharacter(data[offset] | (data[offset + 1] << 8)) : isWordCharacter(data[offset]);
+    };
+
+    std::vector<stringMatch> result;
+    for (size_t i = 0; i + length <= size; i++) {
+        size_t position = i;
+        bool match = true;
+        for (auto& forms : characters) {
+            match = std::any_of(forms.begin(), forms.end(), [&](const std::vector<uint8_t>& form) { return memcmp(data + position, form.data(), form.size()) == 0; });
+            if (!match) {
+                break;
+            }
+            position += forms[0].size();
+        }
+
+        if (match && options.wholeWord) {
+            match = !(i >= unit && wordAt(i - unit)) && !(i + length + unit <= size && wordAt(i + length));
+        }
+        if (match) {
+            result.push_back({ base + i, static_cast<uint32_t>(length), encoding });
+        }
+    }
+    return result;
+}
+
+// the forms a query is searched in: ascii only for ascii queries, utf-8 for the rest, utf-16 for all of them
+static std::vector<stringMatch> naiveFindAll(const std::vector<uint32_t>& query, const stringSearchOptions& options, const uint8_t* data,
+    size_t size, uintptr_t base) {
+    bool ascii = std::all_of(query.begin(), query.end(), [](uint32_t c) { return c < 0x80; });
+
+    std::vector<stringMatch> result;
+    auto add = [&](stringEncoding encoding) {
+        auto found = naiveFind(query, options, encoding, data, size, base);
+        result.insert(result.end(), found.begin(), found.end());
+    };
+    if (ascii && (options.encodings & encoding_ascii)) {
+        add(encoding_ascii);
+    }
+    else if (options.encodings & encoding_utf8) {
+        add(encoding_utf8);
+    }
+    if (options.encodings & encoding_utf16) {
+        add(encoding_utf16);
+    }
+    return result;
+}
+
+static void sortMatches(std::vector<stringMatch>& matches) {
+    std::sort(matches.begin(), matches.end(), [](const stringMatch& a, const stringMatch& b) {
+        return a.address != b.address ? a.address < b.address : a.encoding < b.encoding;
+    });
+}
+
+static bool sameMatches(std::vector<stringMatch> a, std::vector<stringMatch> b) {
+    sortMatches(a);
+    sortMatches(b);
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](const stringMatch& x, const stringMatch& y) {
+        return x.address == y.address && x.length == y.length && x.encoding == y.encoding;
+    });
+}
+
+static std::vector<uint32_t> randomQuery(std::mt19937_64& rng) {
+    std::vector<uint32_t> query(1 + rng() % (rng() % 4 == 0 ? 40 : 6));
+    bool ascii = rng() % 2;
+    for (auto& c : query) {
+        c = alphabet[rng() % (ascii ? 9 : std::size(alphabet))];
+    }
+    return query;
+}
+
+static stringSearchOptions randomOptions(std::mt19937_64& rng) {
+    stringSearchOptions options;
+    options.encodings = static_cast<uint8_t>(1 + rng() % 7);
+    options.caseInsensitive = rng() % 2;
+    options.wholeWord = rng() % 2;
+    return options;
+}
+
+// text the query could be in: pieces of it in random case and encoding, between word characters, spaces, zeros
+// and random bytes, so anchors hit all the time and most full compares fail late
+static void fillText(std::mt19937_64& rng, const std::vector<uint32_t>& query, uint8_t* data, size_t size) {
+    size_t i = 0;
+    while (i < size) {
+        std::vector<uint8_t> piece;
+        switch (rng() % 6) {
+        case 0: case 1: {
+            std::vector<uint32_t> part(query.begin() + (rng() % 4 == 0 ? rng() % query.size() : 0), query.end());
+            if (rng() % 4 == 0) {
+                part.resize(1 + rng() % part.size());
+            }
+            for (auto& c : part) {
+                c = rng() % 2 ? otherCase(c) : c;
+            }
+            piece = encode(part, rng() % 2 ? encoding_utf16 : encoding_utf8);
+            break;
+        }
+        case 2:
+            piece = encode({ alphabet[rng() % std::size(alphabet)] }, rng() % 2 ? encoding_utf16 : encoding_utf8);
+            break;
+        case 3:
+            piece.assign(1 + rng() % 3, rng() % 2 ? 0 : ' ');
+            break;
+        default:
+            piece.push_back(static_cast<uint8_t>(rng() % 2 ? 'a' + rng() % 26 : rng()));
+            break;
+        }
+
+        for (size_t k = 0; k < piece.size() && i < size; k++) {
+            data[i++] = piece[k];
+        }
+    }
+}
+
+static void checkMatcher(std::mt19937_64& rng, const std::vector<simdLevel>& levels) {
+    std::vector<uint8_t> storage(4096 + 64);
+    for (size_t round = 0; round < 20000; round++) {
+        auto query = randomQuery(rng);
+        auto options = randomOptions(rng);
+        auto matchers = compileStringQuery(encodeUtf8(query), options);
+
+        // odd sizes and alignments so the vector loops end anywhere and the scalar tail always has work
+        size_t size = rng() % (round % 10 == 0 ? 4096 : 300);
+        uint8_t* data = storage.data() + rng() % 64;
+        fillText(rng, query, data, size);
+
+        uintptr_t base = 0x10000 + rng() % 0x1000;
+        auto expected = naiveFindAll(query, options, data, size, base);
+
+        for (simdLevel level : levels) {
+            std::vector<stringMatch> found;
+            for (auto& matcher : matchers) {
+                matcher.find(data, size, base, found, level);
+            }
+            if (!sameMatches(found, expected)) {
+                std::printf("level %d, %zu characters, size %zu: %zu matches instead of %zu\n", level, query.size(), size, found.size(), expected.size());
+            }
+            CHECK(sameMatches(found, expected));
+        }
+    }
+}
+
+// findStrings over ranges with guard pages, chunked down to a page and threaded. a match is whatever the naive
+// search finds in each readable stretch of a range, a chunk border is no border for the whole word check but a
+// range end or an unreadable page is
+static void checkFindStrings(std::mt19937_64& rng) {
+    for (size_t round = 0; round < 200; round++) {
+        auto query = randomQuery(rng);
+        auto options = randomOptions(rng);
+        auto matchers = compileStringQuery(encodeUtf8(query), options);
+
+        bufferSource source;
+        std::vector<scanRange> ranges;
+        uintptr_t base = 0x10000000;
+        for (size_t i = 0; i < 1 + rng() % 4; i++) {
+            size_t size = (1 + rng() % 12) * 0x1000 - (rng() % 2 ? rng() % 0x100 : 0);
+            fillText(rng, query, source.map(base, size), size);
+            ranges.push_back({ base, size });
+            base += ((size + 0xFFF) & ~size_t(0xFFF)) + 0x1000 * (rng() % 2);
+        }
+        for (size_t i = 0; i < rng() % 3; i++) {
+            auto& range = ranges[rng() % ranges.size()];
+            source.badPages.insert(range.base + (rng() % ((range.size + 0xFFF) / 0x1000)) * 0x1000);
+        }
+
+        // the query right across a chunk border, and a word character right on either side of one
+        auto encoded = encode(query, rng() % 2 ? encoding_utf16 : encoding_utf8);
+        for (auto& range : ranges) {
+            for (uintptr_t border = 0x1000; border + encoded.size() + 2 < range.size; border += 0x1000) {
+                uint8_t* at = source.at(range.base + border);
+                switch (rng() % 4) {
+                case 0:
+                    memcpy(at - 1 - rng() % (std::min)(encoded.size(), size_t(0x800)), encoded.data(), encoded.size());
+                    break;
+                case 1:
+                    memcpy(at, encoded.data(), encoded.size());
+                    at[-1] = rng() % 2 ? 'x' : ' ';
+                    at[-2] = rng() % 2 ? 0 : 'x';
+                    break;
+                case 2:
+                    if (encoded.size() + 2 < border) {
+                        memcpy(at - encoded.size(), encoded.data(), encoded.size());
+                        at[0] = rng() % 2 ? 'x' : ' ';
+                        at[1] = rng() % 2 ? 0 : 'x';
+                    }
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+
+        std::vector<stringMatch> expected;
+        for (auto& range : ranges) {
+            uintptr_t start = range.base;
+            while (start < range.base + range.size) {
+                uintptr_t end = start;
+                while (end < range.base + range.size && !source.badPages.count(end & ~uintptr_t(0xFFF))) {
+                    end = (std::min)((end & ~uintptr_t(0xFFF)) + 0x1000, range.base + range.size);
+                }
+                auto found = naiveFindAll(query, options, source.at(start), end - start, start);
+                expected.insert(expected.end(), found.begin(), found.end());
+                start = (end & ~uintptr_t(0xFFF)) + 0x1000; // past the unreadable page
+            }
+        }
+
+        patternScanOptions scan;
+        scan.chunkSize = 0x1000 << (rng() % 3);
+        scan.threads = 1 + static_cast<unsigned>(rng() % 4);
+        scan.readAhead = static_cast<unsigned>(rng() % 3);
+        source.canView = rng() % 2;
+
+        auto found = findStrings(source, ranges, matchers, scan);
+        CHECK(std::is_sorted(found.begin(), found.end(), [](const stringMatch& a, const stringMatch& b) { return a.address < b.address; }));
+        if (!sameMatches(found, expected)) {
+            std::printf("round %zu, %zu characters: %zu matches instead of %zu\n", round, query.size(), found.size(), expected.size());
+        }
+        CHECK(sameMatches(found, expected));
+    }
+}
+
+static void checkDecode() {
+    std::vector<uint32_t> codepoints;
+    CHECK(decodeUtf8("", codepoints) && codepoints.empty());
+    CHECK(decodeUtf8("a\xC3\xA9\xE2\x82\xAC\xF0\x9D\x84\x9E", codepoints));
+    CHECK((codepoints == std::vector<uint32_t>{ 'a', 0xE9, 0x20AC, 0x1D11E }));
+
+    // stray continuation bytes, leads cut short at the end or followed by something else, and five byte leads
+    for (std::string_view text : { "\x80", "a\xBF", "\xC3", "a\xC3", "\xE2\x82", "\xF0\x9D\x84", "\xC3\x28", "\xE2\x28\xA1",
+        "\xE2\x82\x28", "\xF0\x9D\x28\x9E", "\xF8\x88\x80\x80\x80", "\xFF", "\xC3\xA9\xC3" }) {
+        CHECK(!decodeUtf8(text, codepoints));
+        CHECK(compileStringQuery(text, {}).empty());
+    }
+    CHECK(compileStringQuery("", {}).empty());
+
+    // an ascii query is one ascii form, the utf-8 one would be the same bytes
+    stringSearchOptions options;
+    options.encodings = encoding_ascii | encoding_utf8 | encoding_utf16;
+    auto matchers = compileStringQuery("abc", options);
+    CHECK(matchers.size() == 2 && matchers[0].encoding() == encoding_ascii && matchers[1].encoding() == encoding_utf16);
+    matchers = compileStringQuery("\xC3\xA9t\xC3\xA9", options);
+    CHECK(matchers.size() == 2 && matchers[0].encoding() == encoding_utf8 && matchers[0].length() == 5 && matchers[1].length() == 6);
+    options.encodings = encoding_ascii;
+    CHECK(compileStringQuery("\xC3\xA9t\xC3\xA9", options).empty());
+}
+
+template <typename Fn>
+static double gigabytesPerSecond(size_t size, Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return size / (msSince(start) * 1e6);
+}
+
+int main() {
+    std::mt19937_64 rng(25);
+
+    std::vector<simdLevel> levels = { simd_scalar };
+#ifdef IMCLASS_SSE2
+    levels.push_back(simd_sse2);
+    if (bestSimdLevel() >= simd_avx2) {
+        levels.push_back(simd_avx2);
+    }
+    else {
+        std::printf("no avx2 on this cpu, that path isn't covered\n");
+    }
+#endif
+
+    checkDecode();
+    checkMatcher(rng, levels);
+    checkFindStrings(rng);
+
+    // 100 MB of text and code-like bytes with the query planted every few hundred KB, case insensitive in ascii
+    // and utf-16 the way the strings window searches by default
+    const size_t size = 100 * 1024 * 1024;
+    std::vector<uint32_t> query = { 'G', 'e', 't', 'P', 'r', 'o', 'c', 'A', 'd', 'd', 'r', 'e', 's', 's' };
+    std::vector<uint8_t> data(size);
+    for (size_t i = 0; i < size; i += 8) {
+        uint64_t value = rng();
+        for (size_t j = 0; j < 8; j++) {
+            uint8_t byte = static_cast<uint8_t>(value >> (j * 8));
+            data[i + j] = byte < 0x60 ? 'a' + byte % 26 : byte < 0x80 ? 0x00 : byte < 0x90 ? 'e' : byte < 0xA0 ? 's' : byte;
+        }
+    }
+    auto ascii = encode(query, encoding_ascii), wide = encode(query, encoding_utf16);
+    for (size_t i = 0x1000; i + wide.size() < size; i += 0x40000 + rng() % 0x40000) {
+        auto& planted = rng() % 2 ? ascii : wide;
+        memcpy(data.data() + i, planted.data(), planted.size());
+    }
+
+    stringSearchOptions options;
+    options.caseInsensitive = true;
+    auto matchers = compileStringQuery(encodeUtf8(query), options);
+    std::vector<stringMatch> expected;
+    double naive = gigabytesPerSecond(size, [&] { expected = naiveFindAll(query, options, data.data(), size, 0); });
+
+    std::printf("%zu MB, %zu matches\n", size >> 20, expected.size());
+    std::printf("naive   %6.2f GB/s\n", naive);
+    const char* names[] = { "scalar", "sse2", "avx2" };
+    for (simdLevel level : levels) {
+        std::vector<stringMatch> found;
+        double speed = gigabytesPerSecond(size, [&] {
+            for (auto& matcher : matchers) {
+                matcher.find(data.data(), size, 0, found, level);
+            }
+        });
+        CHECK(sameMatches(found, expected));
+        std::printf("%-7s %6.2f GB/s (%.1fx)\n", names[level], speed, speed / naive);
+    }
+
+    bufferSource source;
+    memcpy(source.map(0x100000000, size), data.data(), size);
+    std::vector<stringMatch> found;
+    double speed = gigabytesPerSecond(size, [&] { found = findStrings(source, { { 0x100000000, size } }, matchers); });
+    for (auto& match : expected) {
+        match.address += 0x100000000;
+    }
+    CHECK(sameMatches(found, expected));
+    std::printf("findStrings %6.2f GB/s, %u threads\n", speed, workerCount(size / PATTERN_CHUNK_SIZE));
+
+    return testResult("strscan_test");
+}
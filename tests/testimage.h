@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "modcache.h"
+
+// synthetic pe images for the export and module cache tests: headers, a few sections and an export directory
+// with named, ordinal only and forwarded exports, laid out the way link.exe does it
+
+struct testExport {
+    std::string name; // empty for ordinal only
+    uint32_t ordinal;
+    uint32_t rva; // 0 for forwarders
+    std::string forwarder;
+};
+
+struct testSection {
+    char name[8];
+    uint32_t rva;
+    uint32_t size;
+    uint32_t characteristics;
+};
+
+struct testImage {
+    std::vector<uint8_t> bytes;
+    std::vector<testExport> exports;
+    std::vector<testSection> sections;
+    uint32_t timeDateStamp;
+    uint32_t rdataSpare; // rva of the zeroed room asked for with spareSize, in .rdata and .data
+    uint32_t dataSpare;
+};
+
+struct testImageOptions {
+    size_t exportCount = 1000;
+    bool is64Bit = true;
+    bool namesOutside = false; // names in .data instead of the export directory, like some packers leave them
+    uint32_t seed = 1;
+    uint32_t spareSize = 0; // zeroed room left at the end of .rdata and .data for tests that plant their own structures
+};
+
+inline testImage buildTestImage(const testImageOptions& options) {
+    std::mt19937 rng(options.seed);
+    testImage image;
+    image.timeDateStamp = 0x60000000 + options.seed;
+
+    const uint32_t textRva = 0x1000, textSize = 0x20000;
+    const uint32_t rdataRva = textRva + textSize;
+
+    // every index gets an export, bar a few unused ordinals
+    const uint32_t ordinalBase = 1 + rng() % 4;
+    std::vector<uint32_t> functionRvas(options.exportCount);
+    for (size_t i = 0; i < options.exportCount; i++) {
+        uint32_t kind = rng() % 20;
+        testExport entry{ "", ordinalBase + static_cast<uint32_t>(i), 0, "" };
+        if (kind == 0) {
+            continue; // unused
+        }
+        if (kind < 3) {
+            entry.forwarder = rng() % 2 ? "OTHER.Target" + std::to_string(i) : "OTHER.#" + std::to_string(rng() % 100);
+        }
+        else {
+            entry.rva = textRva + (rng() % (textSize / 16)) * 16;
+        }
+        if (kind != 3) {
+            entry.name = "Export_" + std::to_string(i) + std::string(rng() % 24, 'x');
+        }
+        image.exports.push_back(entry);
+    }
+
+    // directory, tables, then strings
+    size_t named = 0;
+    for (auto& entry : image.exports) {
+        named += !entry.name.empty();
+    }
+    const uint32_t functionsRva = rdataRva + 40;
+    const uint32_t namesRva = functionsRva + static_cast<uint32_t>(options.exportCount) * 4;
+    const uint32_t ordinalsRva = namesRva + static_cast<uint32_t>(named) * 4;
+    uint32_t stringsRva = ordinalsRva + static_cast<uint32_t>(named) * 2;
+
+    std::vector<uint8_t> strings;
+    auto addString = [&](uint32_t base, const std::string& text) {
+        uint32_t rva = base + static_cast<uint32_t>(strings.size());
+        strings.insert(strings.end(), text.begin(), text.end());
+        strings.push_back(0);
+        return rva;
+    };
+
+    std::vector<uint8_t> outsideStrings;
+    uint32_t moduleNameRva = addString(stringsRva, "test.dll");
+
+    for (auto& entry : image.exports) {
+        if (!entry.forwarder.empty()) {
+            functionRvas[entry.ordinal - ordinalBase] = addString(stringsRva, entry.forwarder);
+        }
+        else {
+            functionRvas[entry.ordinal - ordinalBase] = entry.rva;
+        }
+    }
+
+    // names go in last so the outside case can move just them
+    std::vector<uint32_t> nameRvas;
+    std::vector<uint16_t> nameOrdinals;
+    const uint32_t directorySize = stringsRva + static_cast<uint32_t>(strings.size()) - rdataRva;
+    uint32_t dataRva = (rdataRva + directorySize + options.spareSize + 0x10000 + 0xFFF) & ~0xFFFu;
+    for (auto& entry : image.exports) {
+        if (entry.name.empty()) {
+            continue;
+        }
+        if (options.namesOutside) {
+            nameRvas.push_back(dataRva + static_cast<uint32_t>(outsideStrings.size()));
+            outsideStrings.insert(outsideStrings.end(), entry.name.begin(), entry.name.end());
+            outsideStrings.push_back(0);
+        }
+        else {
+            nameRvas.push_back(addString(stringsRva, entry.name));
+        }
+        nameOrdinals.push_back(static_cast<uint16_t>(entry.ordinal - ordinalBase));
+    }
+
+    const uint32_t exportSize = stringsRva + static_cast<uint32_t>(strings.size()) - rdataRva;
+    image.rdataSpare = rdataRva + ((exportSize + 15) & ~15u);
+    const uint32_t rdataSize = (image.rdataSpare - rdataRva + options.spareSize + 0xFFF) & ~0xFFFu;
+    if (!options.namesOutside) {
+        dataRva = rdataRva + rdataSize;
+    }
+    image.dataSpare = dataRva + ((static_cast<uint32_t>(outsideStrings.size()) + 15) & ~15u);
+    const uint32_t dataSize = (image.dataSpare - dataRva + options.spareSize + 0x1000 + 0xFFF) & ~0xFFFu;
+    const uint32_t imageSize = dataRva + dataSize;
+
+    image.bytes.assign(imageSize, 0);
+    auto put = [&](uint32_t offset, const void* data, size_t size) { memcpy(image.bytes.data() + offset, data, size); };
+    auto put16 = [&](uint32_t offset, uint16_t value) { put(offset, &value, 2); };
+    auto put32 = [&](uint32_t offset, uint32_t value) { put(offset, &value, 4); };
+
+    // code that's just something other than zeros
+    for (uint32_t i = textRva; i < textRva + textSize; i++) {
+        image.bytes[i] = static_cast<uint8_t>(rng());
+    }
+
+    image.sections = {
+        { ".text", textRva, textSize, 0x60000020 },
+        { ".rdata", rdataRva, rdataSize, 0x40000040 },
+        { ".data", dataRva, dataSize, 0xC0000040 },
+    };
+
+    const uint32_t lfanew = 0x80;
+    const uint32_t optional = lfanew + 24;
+    const uint16_t optionalSize = options.is64Bit ? 240 : 224;
+    put16(0, 0x5A4D);
+    put32(0x3C, lfanew);
+    put32(lfanew, 0x00004550);
+    put16(lfanew + 4, options.is64Bit ? 0x8664 : 0x14C);
+    put16(lfanew + 6, static_cast<uint16_t>(image.sections.size()));
+    put32(lfanew + 8, image.timeDateStamp);
+    put16(lfanew + 20, optionalSize);
+    put16(optional, options.is64Bit ? 0x20B : 0x10B);
+    put32(optional + 56, imageSize);
+    put32(optional + (options.is64Bit ? 112 : 96), rdataRva);
+    put32(optional + (options.is64Bit ? 116 : 100), exportSize);
+
+    uint32_t sectionTable = optional + optionalSize;
+    for (auto& section : image.sections) {
+        put(sectionTable, section.name, 8);
+        put32(sectionTable + 8, section.size);
+        put32(sectionTable + 12, section.rva);
+        put32(sectionTable + 16, section.size);
+        put32(sectionTable + 20, section.rva);
+        put32(sectionTable + 36, section.characteristics);
+        sectionTable += 40;
+    }
+
+    put32(rdataRva + 12, moduleNameRva);
+    put32(rdataRva + 16, ordinalBase);
+    put32(rdataRva + 20, static_cast<uint32_t>(options.exportCount));
+    put32(rdataRva + 24, static_cast<uint32_t>(nameRvas.size()));
+    put32(rdataRva + 28, functionsRva);
+    put32(rdataRva + 32, namesRva);
+    put32(rdataRva + 36, ordinalsRva);
+    put(functionsRva, functionRvas.data(), functionRvas.size() * 4);
+    put(namesRva, nameRvas.data(), nameRvas.size() * 4);
+    put(ordinalsRva, nameOrdinals.data(), nameOrdinals.size() * 2);
+    put(stringsRva, strings.data(), strings.size());
+    put(dataRva, outsideStrings.data(), outsideStrings.size());
+
+    return image;
+}
+
+// what mem::getModuleIdentity reads out of the headers of a loaded image
+inline moduleIdentity testIdentity(const testImage& image, const std::string& name) {
+    moduleIdentity identity;
+    identity.name = name;
+    identity.timeDateStamp = image.timeDateStamp;
+    memcpy(&identity.sizeOfImage, image.bytes.data() + 0x80 + 24 + 56, 4); // e_lfanew, file header, SizeOfImage
+    identity.headerHash = fnv1a(image.sections.data(), image.sections.size() * sizeof(testSection));
+    return identity;
+}
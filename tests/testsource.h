@@ -0,0 +1,193 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "source.h"
+
+// shared by the tests and benchmarks. bufferSource is a target made of local buffers that counts every call the
+// engines make into it, with unreadable pages and a per read cost to stand in for a remote process
+
+inline int g_Failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition); \
+            g_Failures++; \
+        } \
+    } while (0)
+
+inline int testResult(const char* name) {
+    if (g_Failures) {
+        std::printf("%s: %d checks failed\n", name, g_Failures);
+        return 1;
+    }
+    std::printf("%s: all checks passed\n", name);
+    return 0;
+}
+
+inline double msSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+class bufferSource : public memorySource {
+public:
+    struct block {
+        std::vector<uint8_t> data;
+        uint32_t protect;
+        regionType type;
+    };
+
+    std::map<uintptr_t, block> blocks; // by base, never overlapping
+    std::set<uintptr_t> badPages; // reads touching these fail, like a guard page
+    std::vector<sourceModule> modules;
+    bool canView = false; // hand out pointers like a dump does
+    bool x86 = false;
+    std::chrono::nanoseconds readCost{ 0 }; // spun on every read and batch entry
+
+    std::atomic<uint64_t> reads = 0;
+    std::atomic<uint64_t> bytesRead = 0;
+    std::atomic<uint64_t> queries = 0;
+
+    uint8_t* map(uintptr_t base, size_t size, uint32_t protect = protect_read | protect_write, regionType type = region_private) {
+        auto& entry = blocks[base];
+        entry.data.assign(size, 0);
+        entry.protect = protect;
+        entry.type = type;
+        return entry.data.data();
+    }
+
+    uint8_t* at(uintptr_t address) {
+        auto it = find(address);
+        return it == blocks.end() ? nullptr : it->second.data.data() + (address - it->first);
+    }
+
+    void resetCounters() {
+        reads = 0;
+        bytesRead = 0;
+        queries = 0;
+    }
+
+    bool read(uintptr_t address, void* buf, uintptr_t size) override {
+        reads++;
+        bytesRead += size;
+        spin();
+        return copy(address, static_cast<uint8_t*>(buf), size);
+    }
+
+    bool write(uintptr_t address, const void* buf, uintptr_t size) override {
+        if (!readable(address, size)) {
+            return false;
+        }
+        memcpy(at(address), buf, size);
+        return true;
+    }
+
+    bool queryRegion(uintptr_t address, memoryRegion* region) override {
+        queries++;
+        spin();
+
+        auto next = blocks.upper_bound(address);
+        if (next != blocks.begin()) {
+            auto it = std::prev(next);
+            if (address - it->first < it->second.data.size()) {
+                *region = { it->first, it->second.data.size(), it->second.protect, it->second.type, true };
+                return true;
+            }
+        }
+
+        uintptr_t start = next == blocks.begin() ? 0 : std::prev(next)->first + std::prev(next)->second.data.size();
+        uintptr_t end = next == blocks.end() ? ~uintptr_t(0) : next->first;
+        *region = { start, end - start, protect_none, region_free, false };
+        return true;
+    }
+
+    bool getRegions(std::vector<memoryRegion>& out) override {
+        out.clear();
+        for (auto& [base, entry] : blocks) {
+            out.push_back({ base, entry.data.size(), entry.protect, entry.type, true });
+        }
+        return true;
+    }
+
+    bool getModules(std::vector<sourceModule>& out) override {
+        out = modules;
+        return true;
+    }
+
+    bool isAlive() override { return true; }
+    bool is32Bit() override { return x86; }
+
+    const uint8_t* view(uintptr_t address, uintptr_t size) override {
+        if (!canView || !readable(address, size)) {
+            return nullptr;
+        }
+        auto it = find(address);
+        return address - it->first + size <= it->second.data.size() ? at(address) : nullptr;
+    }
+
+    bool isSnapshot() override { return canView; }
+
+private:
+    std::map<uintptr_t, block>::iterator find(uintptr_t address) {
+        auto it = blocks.upper_bound(address);
+        if (it == blocks.begin()) {
+            return blocks.end();
+        }
+        --it;
+        return address - it->first < it->second.data.size() ? it : blocks.end();
+    }
+
+    bool readable(uintptr_t address, uintptr_t size) {
+        if (size == 0 || address + size < address) {
+            return size == 0;
+        }
+        auto bad = badPages.lower_bound(address & ~uintptr_t(0xFFF));
+        if (bad != badPages.end() && *bad < address + size) {
+            return false;
+        }
+
+        // touching blocks read as one, like neighbouring regions of a process
+        for (uintptr_t position = address; position < address + size;) {
+            auto it = find(position);
+            if (it == blocks.end() || !(it->second.protect & protect_read)) {
+                return false;
+            }
+            position = it->first + it->second.data.size();
+        }
+        return true;
+    }
+
+    bool copy(uintptr_t address, uint8_t* out, uintptr_t size) {
+        if (!readable(address, size)) {
+            return false;
+        }
+        while (size) {
+            auto it = find(address);
+            uintptr_t count = (std::min)(size, it->first + it->second.data.size() - address);
+            memcpy(out, it->second.data.data() + (address - it->first), count);
+            address += count;
+            out += count;
+            size -= count;
+        }
+        return true;
+    }
+
+    void spin() const {
+        if (readCost.count() == 0) {
+            return;
+        }
+        auto until = std::chrono::steady_clock::now() + readCost;
+        while (std::chrono::steady_clock::now() < until) {
+        }
+    }
+};
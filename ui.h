@@ -13,16 +13,30 @@
 namespace ui {
     bool open = true;
     bool processWindow = false;
+    bool dumpWindow = false;
     bool signaturesWindow = false;
     bool stringSearchWindow = false;
     bool sigScanWindow = false;
     bool exportWindow = false;
+    bool rttiWindow = false;
+    bool signatureSetWindow = false;
     std::string exportedClass;
     inline std::optional<PatternScanResult> patternResults;
+    inline GeneratedSignature generatedSignature;
     char addressInput[256] = "0";
 	char module[512] = { 0 };
 	char signature[512] = { 0 };
     char searchString[512] = { 0 };
+    int scanScope = 0; // ScanScope
+    int signatureSections = static_cast<int>(SectionFilter::CODE);
+    int stringSections = static_cast<int>(SectionFilter::DATA);
+    int stringEncodings = encoding_ascii | encoding_utf16;
+    bool stringCaseInsensitive = false;
+    bool stringWholeWord = false;
+    char rangeStart[32] = { 0 };
+    char rangeEnd[32] = { 0 };
+    bool scanExecutable = false;
+    bool scanWritable = false;
 
     ImVec2 mainPos;
     ImVec2 signaturePos = {0, 0};
@@ -30,8 +44,12 @@ namespace ui {
 
     void init(HWND hwnd);
 	void renderProcessWindow();
+    void renderDumpWindow();
 	void renderMain();
     void renderExportWindow();
+    void renderRttiWindow();
+    void renderInstancesWindow();
+    void renderSignatureSetWindow();
 	void render();
     bool searchMatches(std::string str, std::string term);
     uintptr_t toAddress(std::string address);
@@ -40,6 +58,8 @@ namespace ui {
     void updateAddress(uintptr_t newAddress, uintptr_t* dest = 0);
     void renderSignatureResults();
     void renderSignatureScan();
+    void renderScanScope(int* sections);
+    ScanTarget scanTarget(int sections);
 	void renderStringScan();
     void updateAddressBox(char* dest, char* src);
     void cleanDeadProcess();
@@ -68,6 +88,40 @@ void ui::cleanDeadProcess()
 }
 
 
+// shared by the signature and string scanners, each keeps its own section filter
+inline void ui::renderScanScope(int* sections)
+{
+	ImGui::Combo("Scope", &scanScope, "Module\0All modules\0Private memory\0Range\0");
+
+	if (scanScope == static_cast<int>(ScanScope::MODULE) || scanScope == static_cast<int>(ScanScope::ALL_MODULES)) {
+		ImGui::Combo("Sections", sections, "Any\0Code\0Data\0");
+	}
+
+	if (scanScope == static_cast<int>(ScanScope::MODULE)) {
+		ImGui::InputText("Module", module, sizeof(module));
+	}
+	else if (scanScope == static_cast<int>(ScanScope::RANGE)) {
+		ImGui::InputText("Start", rangeStart, sizeof(rangeStart));
+		ImGui::InputText("End", rangeEnd, sizeof(rangeEnd));
+	}
+
+	ImGui::Checkbox("Executable", &scanExecutable);
+	ImGui::SameLine();
+	ImGui::Checkbox("Writable", &scanWritable);
+}
+
+inline ScanTarget ui::scanTarget(int sections)
+{
+	ScanTarget target;
+	target.scope = static_cast<ScanScope>(scanScope);
+	target.sections = static_cast<SectionFilter>(sections);
+	target.module = module;
+	target.start = rangeStart[0] ? toAddress(rangeStart) : 0;
+	target.end = rangeEnd[0] ? toAddress(rangeEnd) : 0;
+	target.protect = protect_read | (scanExecutable ? protect_execute : 0) | (scanWritable ? protect_write : 0);
+	return target;
+}
+
 inline void ui::renderSignatureScan()
 {
 	static bool oSigScanWindow = false;
@@ -78,7 +132,7 @@ inline void ui::renderSignatureScan()
 
 	const float entryHeight = ImGui::GetTextLineHeightWithSpacing();
 
-	constexpr int numElements = 3;
+	constexpr int numElements = 8;
 	const float contentHeight = (entryHeight * numElements) + padding;
 	const float windowHeight = min(headerHeight + contentHeight + footerHeight, 300.0f);
     static bool hasSetPos = false;
@@ -99,12 +153,19 @@ inline void ui::renderSignatureScan()
 	oSigScanWindow = sigScanWindow;
 
 	ImGui::Begin("Signature Scanner", &sigScanWindow);
-	ImGui::InputText("Module", module, sizeof(module));
+	renderScanScope(&signatureSections);
 	ImGui::InputText("Signature", signature, sizeof(signature));
+	int scanThreads = static_cast<int>(pattern::g_ScanOptions.threads);
+	if (ImGui::InputInt("Threads", &scanThreads)) {
+		pattern::g_ScanOptions.threads = static_cast<unsigned>((std::max)(scanThreads, 0));
+	}
+	if (ImGui::IsItemHovered()) {
+		ImGui::SetTooltip("0 uses every core");
+	}
 	if (ImGui::Button("Scan")) {
 		PatternInfo pattern;
 		pattern.pattern = signature;
-		patternResults = pattern::scanPattern(pattern, module);
+		patternResults = pattern::scanPattern(pattern, scanTarget(signatureSections));
 		if (patternResults != std::nullopt && !patternResults.value().matches.empty()) {
 			signaturesWindow = true;
 		};
@@ -130,9 +191,9 @@ inline void ui::renderStringScan()
 
     const float entryHeight = ImGui::GetTextLineHeightWithSpacing();
 
-    constexpr int numElements = 3;
+    constexpr int numElements = 9;
     const float contentHeight = (entryHeight * numElements) + padding;
-    const float windowHeight = min(headerHeight + contentHeight + footerHeight, 300.0f);
+    const float windowHeight = min(headerHeight + contentHeight + footerHeight, 340.0f);
     static bool hasSetPos = false;
 
     if (stringSearchWindow != oStringSearchWindow) {
@@ -151,14 +212,23 @@ inline void ui::renderStringScan()
     oStringSearchWindow = stringSearchWindow;
 
     ImGui::Begin("String Scanner", &stringSearchWindow);
-    ImGui::InputText("Module", module, sizeof(module));
+    renderScanScope(&stringSections);
     ImGui::InputText("String", searchString, sizeof(searchString));
+    ImGui::CheckboxFlags("ASCII", &stringEncodings, encoding_ascii);
+    ImGui::SameLine();
+    ImGui::CheckboxFlags("UTF-8", &stringEncodings, encoding_utf8);
+    ImGui::SameLine();
+    ImGui::CheckboxFlags("UTF-16", &stringEncodings, encoding_utf16);
+    ImGui::Checkbox("Case insensitive", &stringCaseInsensitive);
+    ImGui::SameLine();
+    ImGui::Checkbox("Whole word", &stringWholeWord);
     if (ImGui::Button("Scan")) {
-        PatternInfo pattern;
-		std::string patternString = pattern::stringToSignature(searchString);
+        stringSearchOptions options;
+        options.encodings = static_cast<uint8_t>(stringEncodings);
+        options.caseInsensitive = stringCaseInsensitive;
+        options.wholeWord = stringWholeWord;
 
-        pattern.pattern = patternString;
-        patternResults = pattern::scanPattern(pattern, module, PatternType::BYTE_PATTERN);
+        patternResults = pattern::scanString(searchString, scanTarget(stringSections), options);
         if (patternResults != std::nullopt && !patternResults.value().matches.empty()) {
             signaturesWindow = true;
         }
@@ -207,10 +277,12 @@ void ui::renderSignatureResults() {
 
         PatternScanResult& results = patternResults.value();
 
-		for (uintptr_t match : results.matches) {
+		for (size_t i = 0; i < results.matches.size(); i++) {
+			uintptr_t match = results.matches[i];
 			const std::string address = toHexString(match);
             const char* cAddr = address.c_str();
-			if (ImGui::Selectable(cAddr)) {
+			const std::string label = i < results.labels.size() ? address + "  " + results.labels[i] : address;
+			if (ImGui::Selectable(label.c_str())) {
                 if (g_Classes.size() >= g_SelectedClass) {
                     uClass& cClass = g_Classes[g_SelectedClass];
                     updateAddressBox(addressInput, (char*)(cAddr));
@@ -251,6 +323,39 @@ void ui::renderModals()
 			ImGui::CloseCurrentPopup();
 		ImGui::EndPopup();
 	}
+
+	if (generateSignatureAt) {
+		generatedSignature = GeneratedSignature();
+		pattern::g_SignatureGenerator.start(generateSignatureAt);
+		generateSignatureAt = 0;
+		ImGui::OpenPopup("Generated Signature");
+	}
+
+	if (auto result = pattern::g_SignatureGenerator.take()) {
+		generatedSignature = std::move(*result);
+		if (generatedSignature.error.empty()) {
+			ImGui::SetClipboardText(generatedSignature.pattern.c_str());
+		}
+	}
+
+	if (ImGui::BeginPopup("Generated Signature"))
+	{
+		if (pattern::g_SignatureGenerator.busy()) {
+			ImGui::Text("Generating a signature...");
+		}
+		else if (!generatedSignature.error.empty()) {
+			ImGui::Text("%s", generatedSignature.error.c_str());
+		}
+		else {
+			ImGui::Text("%s + 0x%llX, %zu bytes in %.1f ms, copied to the clipboard", generatedSignature.module.c_str(),
+				static_cast<unsigned long long>(generatedSignature.rva), generatedSignature.length, generatedSignature.ms);
+			ImGui::SetNextItemWidth(400.0f);
+			ImGui::InputText("##GeneratedSignature", generatedSignature.pattern.data(), generatedSignature.pattern.size() + 1, ImGuiInputTextFlags_ReadOnly);
+		}
+		if (ImGui::Button("Close"))
+			ImGui::CloseCurrentPopup();
+		ImGui::EndPopup();
+	}
 }
 
 void ui::renderMain() {
@@ -262,6 +367,9 @@ void ui::renderMain() {
                 processWindow = true;
                 mem::getProcessList();
             }
+            if (ImGui::MenuItem("Open dump")) {
+                dumpWindow = true;
+            }
             ImGui::EndMenu();
         }
         if (ImGui::BeginMenu("Tools")) {
@@ -273,9 +381,35 @@ void ui::renderMain() {
 			{
 				stringSearchWindow = true;
 			}
+            if (ImGui::MenuItem("Signature Sets")) {
+                signatureSetWindow = true;
+            }
+            if (ImGui::MenuItem("RTTI Types")) {
+                rttiWindow = true;
+            }
 
             ImGui::EndMenu();
         }
+
+        if (mem::g_Source && mem::g_Attach.busy()) {
+            ImGui::TextDisabled("attaching: %s", mem::g_Attach.currentStage().c_str());
+            if (ImGui::IsItemHovered()) {
+                std::string stages;
+                for (auto& stage : mem::g_Attach.timings()) {
+                    stages += stage.done ? std::format("{:<9}{:.1f} ms\n", stage.name, stage.ms) : std::format("{:<9}...\n", stage.name);
+                }
+                ImGui::SetTooltip("%s", stages.c_str());
+            }
+        }
+        else if (mem::g_Source) {
+            auto& timings = mem::g_AttachTimings;
+            ImGui::TextDisabled("attached in %.0f ms", timings.modules + timings.sections + timings.regions + timings.exports + timings.symbols);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("modules  %.1f ms\nsections %.1f ms\nregions  %.1f ms\nexports  %.1f ms\nsymbols  %.1f ms (%zu)\n%u threads, %u/%zu modules cached\nrtti     %zu types%s",
+                    timings.modules, timings.sections, timings.regions, timings.exports, timings.symbols, mem::g_Symbols.size(), timings.threads,
+                    timings.cachedModules.load(), mem::moduleList.size(), mem::g_RttiIndex.current()->typeCount(), mem::g_RttiIndex.busy() ? ", indexing" : "");
+            }
+        }
         ImGui::EndMenuBar();
 
         ImGui::Columns(2);
@@ -311,6 +445,16 @@ void ui::renderMain() {
                     if (ImGui::MenuItem("New Class")) {
                         g_Classes.push_back({ uClass(50) });
                     }
+                    if (lClass.reader && ImGui::BeginMenu("Refresh rate")) {
+                        constexpr int intervals[] = { 0, 16, 50, 100, 500, 1000 };
+                        for (int interval : intervals) {
+                            std::string label = interval ? std::to_string(interval) + " ms" : "As fast as possible";
+                            if (ImGui::MenuItem(label.c_str(), nullptr, lClass.reader->intervalMs == interval)) {
+                                lClass.reader->intervalMs = interval;
+                            }
+                        }
+                        ImGui::EndMenu();
+                    }
                     if (ImGui::MenuItem("Delete")) {
                         if (g_Classes.size() > 0) {
                             uClass& sClass = g_Classes[i];
@@ -369,6 +513,11 @@ void ui::renderMain() {
             updateAddressBox(sClass.addressInput, addressInput);
         }
 
+        if (sClass.reader) {
+            ImGui::SameLine();
+            ImGui::TextDisabled("%.0f reads/s, %.2f ms", sClass.reader->rate(), sClass.reader->latency());
+        }
+
         static bool oInputFocused = false;
 
         // ImGui::IsItemFocused() doesn't really work for losing focus from the inputtext
@@ -401,6 +550,10 @@ void ui::renderMain() {
 
         processWasActive = processActive;
 
+        if (processActive) {
+            mem::pollModules();
+        }
+
     }
     ImGui::End();
 }
@@ -447,6 +600,298 @@ void ui::renderProcessWindow() {
     ImGui::End();
 }
 
+void ui::renderDumpWindow() {
+    static bool oDumpWindow = false;
+    static bool failed = false;
+
+    if (!dumpWindow) {
+        oDumpWindow = dumpWindow;
+        return;
+    }
+
+    if (dumpWindow != oDumpWindow) {
+        ImGui::SetNextWindowPos(ImVec2(mainPos.x + 50, mainPos.y + 50), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(minWidth + 100, 0), ImGuiCond_Always);
+        failed = false;
+    }
+    oDumpWindow = dumpWindow;
+
+    ImGui::Begin("Open dump", &dumpWindow);
+
+    static char path[MAX_PATH] = { 0 };
+    ImGui::InputText("Path", path, sizeof(path));
+
+    if (ImGui::Button("Open")) {
+        failed = !mem::openDump(path);
+        dumpWindow = failed;
+    }
+
+    if (failed) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Not a readable minidump");
+    }
+
+    ImGui::End();
+}
+
+void ui::renderRttiWindow() {
+    static bool oRttiWindow = false;
+    if (!rttiWindow) {
+        oRttiWindow = rttiWindow;
+        return;
+    }
+
+    if (rttiWindow != oRttiWindow) {
+        ImGui::SetNextWindowPos(ImVec2(mainPos.x + 50, mainPos.y + 50), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(minWidth + 200, 400), ImGuiCond_Always);
+    }
+    oRttiWindow = rttiWindow;
+
+    ImGui::Begin("RTTI Types", &rttiWindow);
+
+    static char filter[256] = { 0 };
+    bool filterChanged = ImGui::InputText("Filter", filter, sizeof(filter));
+
+    auto& index = mem::g_RttiIndex;
+    auto types = index.current();
+    if (index.busy()) {
+        ImGui::SameLine();
+        ImGui::TextDisabled("indexing %zu/%zu modules", index.modulesDone.load(), index.modulesTotal.load());
+    }
+
+    // the filtered list is only rebuilt when the filter or the index changes, not every frame
+    static std::shared_ptr<const rttiSnapshot> shown;
+    static std::vector<std::pair<const rttiModuleTypes*, const rttiType*>> matches;
+    if (filterChanged || shown != types) {
+        shown = types;
+        matches.clear();
+        for (auto& module : types->modules) {
+            for (auto& type : module->types) {
+                if (!filter[0] || searchMatches(type.name, filter)) {
+                    matches.push_back({ module.get(), &type });
+                }
+            }
+        }
+    }
+
+    ImGui::TextDisabled("%zu of %zu types", matches.size(), types->typeCount());
+
+    ImGui::BeginChild("##RttiList");
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(matches.size()));
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            auto [module, type] = matches[i];
+            ImGui::PushID(i);
+            ImGui::Selectable(std::format("{}!{}", module->module, type->name).c_str());
+
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s\n%zu vtable(s), first at %s", type->hierarchy.c_str(), type->vtables.size(), toHexString(type->vtables.front()).c_str());
+            }
+
+            if (ImGui::BeginPopupContextItem("##RttiContext")) {
+                if (ImGui::MenuItem("Copy vtable")) {
+                    ImGui::SetClipboardText(toHexString(type->vtables.front()).c_str());
+                }
+                if (ImGui::MenuItem("Copy name")) {
+                    ImGui::SetClipboardText(type->name.c_str());
+                }
+                if (type->primaryVtable && ImGui::MenuItem("Find instances")) {
+                    mem::scanInstances(type->name);
+                    showInstancesWindow = true;
+                }
+                ImGui::EndPopup();
+            }
+            ImGui::PopID();
+        }
+    }
+    ImGui::EndChild();
+
+    ImGui::End();
+}
+
+void ui::renderInstancesWindow() {
+    static bool windowOpen = false;
+    static bool oWindowOpen = false;
+    static bool wasBusy = false;
+    static std::vector<uintptr_t> results;
+    static instanceScanStats stats;
+    static std::string label;
+
+    if (showInstancesWindow) {
+        windowOpen = true;
+        showInstancesWindow = false;
+    }
+
+    auto& scanner = mem::g_Instances;
+
+    // results are copied out once when a search finishes instead of every frame
+    bool busy = scanner.busy();
+    if ((wasBusy && !busy) || (windowOpen && !oWindowOpen)) {
+        results = scanner.results(&stats);
+        label = scanner.label();
+    }
+    wasBusy = busy;
+
+    if (!windowOpen) {
+        oWindowOpen = windowOpen;
+        return;
+    }
+
+    if (windowOpen != oWindowOpen) {
+        ImGui::SetNextWindowPos(ImVec2(mainPos.x + 80, mainPos.y + 80), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(minWidth + 50, 400), ImGuiCond_Always);
+    }
+    oWindowOpen = windowOpen;
+
+    ImGui::Begin("Instances", &windowOpen);
+
+    auto openInstance = [](uintptr_t address, const std::string& name) {
+        uClass newClass(50);
+        newClass.address = address;
+        std::string newName = name.substr(0, sizeof(newClass.name) - 1);
+        memset(newClass.name, 0, sizeof(newClass.name));
+        memcpy(newClass.name, newName.data(), newName.size());
+        std::string addressText = toHexString(address);
+        memcpy(newClass.addressInput, addressText.data(), (std::min)(addressText.size(), sizeof(newClass.addressInput) - 1));
+        g_Classes.push_back(newClass);
+        g_SelectedClass = g_Classes.size() - 1;
+        updateAddressBox(addressInput, newClass.addressInput);
+    };
+
+    if (busy) {
+        uint64_t total = scanner.bytesTotal.load();
+        float fraction = total ? static_cast<float>(scanner.bytesDone.load()) / static_cast<float>(total) : 0.0f;
+        ImGui::Text("Searching for %s...", scanner.label().c_str());
+        ImGui::ProgressBar(fraction);
+        if (ImGui::Button("Cancel")) {
+            scanner.stop();
+        }
+    }
+    else {
+        ImGui::Text("%zu instances of %s", results.size(), label.c_str());
+        ImGui::TextDisabled("%.1f MB in %.0f ms%s", stats.bytesScanned / (1024.0 * 1024.0), stats.ms, stats.truncated ? ", truncated" : "");
+
+        constexpr size_t OPEN_ALL_LIMIT = 64;
+        if (!results.empty() && ImGui::Button(results.size() > OPEN_ALL_LIMIT ? "Open first 64" : "Open all")) {
+            for (size_t i = 0; i < results.size() && i < OPEN_ALL_LIMIT; i++) {
+                openInstance(results[i], label + "_" + std::to_string(i));
+            }
+        }
+
+        ImGui::BeginChild("##InstancesList");
+        ImGuiListClipper clipper;
+        clipper.Begin(static_cast<int>(results.size()));
+        while (clipper.Step()) {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+                ImGui::PushID(i);
+                if (ImGui::Selectable(toHexString(results[i]).c_str())) {
+                    openInstance(results[i], label + "_" + std::to_string(i));
+                }
+                ImGui::PopID();
+            }
+        }
+        ImGui::EndChild();
+    }
+
+    ImGui::End();
+}
+
+void ui::renderSignatureSetWindow() {
+    static bool oSignatureSetWindow = false;
+    if (!signatureSetWindow) {
+        oSignatureSetWindow = signatureSetWindow;
+        return;
+    }
+
+    if (signatureSetWindow != oSignatureSetWindow) {
+        ImGui::SetNextWindowPos(ImVec2(mainPos.x + 50, mainPos.y + 50), ImGuiCond_Always);
+        ImGui::SetNextWindowSize(ImVec2(minWidth + 250, 400), ImGuiCond_Always);
+    }
+    oSignatureSetWindow = signatureSetWindow;
+
+    ImGui::Begin("Signature Sets", &signatureSetWindow);
+
+    static char path[MAX_PATH] = { 0 };
+    static SignatureSet set;
+    static bool loadFailed = false;
+
+    ImGui::InputText("File", path, sizeof(path));
+    if (ImGui::Button("Load")) {
+        loadFailed = !pattern::loadSignatureSet(path, set);
+        if (!loadFailed) {
+            pattern::resolveSignatureSet(set);
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Resolve") && !set.entries.empty()) {
+        pattern::resolveSignatureSet(set);
+    }
+
+    if (loadFailed) {
+        ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "Couldn't open %s", path);
+    }
+    else if (!set.entries.empty()) {
+        size_t resolved = std::count_if(set.entries.begin(), set.entries.end(), [](const SignatureEntry& entry) { return !entry.matches.empty(); });
+        ImGui::TextDisabled("%zu of %zu resolved, %zu modules in %.0f ms", resolved, set.entries.size(), set.modules, set.ms);
+    }
+
+    ImGui::BeginChild("##SignatureSetList");
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(set.entries.size()));
+    while (clipper.Step()) {
+        for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
+            auto& entry = set.entries[i];
+            ImGui::PushID(i);
+
+            std::string result;
+            if (!entry.error.empty()) {
+                result = entry.error;
+            }
+            else if (entry.matches.empty()) {
+                result = "not found";
+            }
+            else {
+                result = toHexString(entry.matches.front());
+                if (entry.matches.size() > 1) {
+                    result += std::format(" (+{})", entry.matches.size() - 1);
+                }
+            }
+
+            if (ImGui::Selectable(std::format("{}  {}!{}", entry.name, entry.module, result).c_str()) && !entry.matches.empty()) {
+                if (g_Classes.size() > g_SelectedClass) {
+                    uClass& cClass = g_Classes[g_SelectedClass];
+                    std::string address = toHexString(entry.matches.front());
+                    updateAddressBox(addressInput, address.data());
+                    updateAddressBox(cClass.addressInput, address.data());
+                    updateAddress(entry.matches.front(), &cClass.address);
+                }
+            }
+
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("%s", entry.pattern.c_str());
+            }
+
+            if (!entry.matches.empty() && ImGui::BeginPopupContextItem("##SignatureSetContext")) {
+                if (ImGui::MenuItem("Copy address")) {
+                    ImGui::SetClipboardText(toHexString(entry.matches.front()).c_str());
+                }
+                if (ImGui::MenuItem("Copy RVA")) {
+                    moduleInfo moduleData;
+                    if (mem::getModuleInfo(entry.module, &moduleData)) {
+                        ImGui::SetClipboardText(toHexString(entry.matches.front() - moduleData.base).c_str());
+                    }
+                }
+                ImGui::EndPopup();
+            }
+            ImGui::PopID();
+        }
+    }
+    ImGui::EndChild();
+
+    ImGui::End();
+}
+
 void ui::renderExportWindow() {
     if (!exportWindow) {
         return;
@@ -468,9 +913,16 @@ bool ui::searchMatches(std::string str, std::string term) {
 }
 
 void ui::render() {
+    mem::g_Cache.nextFrame();
+    mem::g_Attach.publish();
+
     renderMain();
     renderProcessWindow();
+    renderDumpWindow();
     renderExportWindow();
+    renderRttiWindow();
+    renderInstancesWindow();
+    renderSignatureSetWindow();
     renderSignatureScan();
     renderSignatureResults();    
 	renderStringScan();
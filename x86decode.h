@@ -0,0 +1,346 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// just enough of an x86/x64 decoder to know how long an instruction is and where its displacement and immediate
+// sit, which is all the signature generator needs to decide what to wildcard. covers the legacy one, two and
+// three byte maps with every prefix, vex and evex. anything it doesn't know comes back as invalid
+
+struct instructionLayout {
+    size_t length = 0;
+
+    size_t dispOffset = 0;
+    size_t dispSize = 0;
+    bool ripRelative = false; // disp is relative to the next instruction (x64 only)
+
+    size_t immOffset = 0;
+    size_t immSize = 0; // both immediates of enter count as one
+    bool relative = false; // imm is a branch target relative to the next instruction
+    bool address = false; // imm is an absolute address (mov moffs, far jmp and call)
+};
+
+namespace x86 {
+    enum immKind : uint8_t {
+        imm_none,
+        imm_8,
+        imm_16,
+        imm_z, // 16 or 32 by operand size
+        imm_v, // 16, 32 or 64 by operand size (mov r, imm)
+        imm_rel8,
+        imm_relz,
+        imm_enter, // imm16 + imm8
+        imm_far, // ptr16:16 or ptr16:32
+        imm_moffs, // by address size
+        imm_group3, // f6/f7, only test has an immediate
+    };
+
+    struct opcodeInfo {
+        bool modrm;
+        immKind imm;
+    };
+
+    constexpr opcodeInfo oneByte(uint8_t op) {
+        if (op < 0x40) {
+            switch (op & 7) {
+            case 0: case 1: case 2: case 3:
+                return { true, imm_none };
+            case 4:
+                return { false, imm_8 };
+            case 5:
+                return { false, imm_z };
+            default:
+                return { false, imm_none };
+            }
+        }
+        if (op < 0x62) {
+            return { false, imm_none };
+        }
+        if (op >= 0x70 && op <= 0x7F) {
+            return { false, imm_rel8 };
+        }
+        if (op >= 0x84 && op <= 0x8F) {
+            return { true, imm_none };
+        }
+        if (op >= 0x91 && op <= 0x9F) {
+            return { false, op == 0x9A ? imm_far : imm_none };
+        }
+        if (op >= 0xA0 && op <= 0xA3) {
+            return { false, imm_moffs };
+        }
+        if (op >= 0xB0 && op <= 0xB7) {
+            return { false, imm_8 };
+        }
+        if (op >= 0xB8 && op <= 0xBF) {
+            return { false, imm_v };
+        }
+        if (op >= 0xD8 && op <= 0xDF) {
+            return { true, imm_none };
+        }
+
+        switch (op) {
+        case 0x62: case 0x63: case 0xC4: case 0xC5:
+            return { true, imm_none };
+        case 0x68:
+            return { false, imm_z };
+        case 0x69:
+            return { true, imm_z };
+        case 0x6A: case 0xA8: case 0xCD: case 0xD4: case 0xD5: case 0xE4: case 0xE5: case 0xE6: case 0xE7:
+            return { false, imm_8 };
+        case 0x6B: case 0x80: case 0x82: case 0x83: case 0xC0: case 0xC1: case 0xC6:
+            return { true, imm_8 };
+        case 0x81: case 0xC7:
+            return { true, imm_z };
+        case 0x90:
+            return { false, imm_none };
+        case 0xA9:
+            return { false, imm_z };
+        case 0xC2: case 0xCA:
+            return { false, imm_16 };
+        case 0xC8:
+            return { false, imm_enter };
+        case 0xD0: case 0xD1: case 0xD2: case 0xD3: case 0xFE: case 0xFF:
+            return { true, imm_none };
+        case 0xE0: case 0xE1: case 0xE2: case 0xE3: case 0xEB:
+            return { false, imm_rel8 };
+        case 0xE8: case 0xE9:
+            return { false, imm_relz };
+        case 0xEA:
+            return { false, imm_far };
+        case 0xF6: case 0xF7:
+            return { true, imm_group3 };
+        default:
+            return { false, imm_none }; // 6c-6f, a4-af, c3, c9, cb, cc, ce, cf, d6, d7, ec-ef, f1, f4, f5, f8-fd
+        }
+    }
+
+    constexpr opcodeInfo twoByte(uint8_t op) {
+        if (op >= 0x80 && op <= 0x8F) {
+            return { false, imm_relz };
+        }
+        if ((op >= 0x30 && op <= 0x37) || (op >= 0xC8 && op <= 0xCF)) {
+            return { false, imm_none };
+        }
+
+        switch (op) {
+        case 0x05: case 0x06: case 0x07: case 0x08: case 0x09: case 0x0B: case 0x0E:
+        case 0x77: case 0xA0: case 0xA1: case 0xA2: case 0xA8: case 0xA9: case 0xAA:
+            return { false, imm_none };
+        case 0x0F: // 3dnow, the real opcode comes last as an imm8
+        case 0x70: case 0x71: case 0x72: case 0x73: case 0xA4: case 0xAC: case 0xBA:
+        case 0xC2: case 0xC4: case 0xC5: case 0xC6:
+            return { true, imm_8 };
+        default:
+            return { true, imm_none };
+        }
+    }
+
+    // map 1 = 0f, 2 = 0f 38, 3 = 0f 3a
+    constexpr opcodeInfo mapped(int map, uint8_t op) {
+        if (map == 1) {
+            return twoByte(op);
+        }
+        return { true, map == 3 ? imm_8 : imm_none };
+    }
+}
+
+inline bool decodeInstruction(const uint8_t* code, size_t size, bool is64Bit, instructionLayout* out) {
+    using namespace x86;
+
+    *out = instructionLayout();
+    size_t i = 0;
+    bool operandSize16 = false;
+    bool addressSizeSmall = false; // 32 bit addressing in x64, 16 bit in x86
+    bool rexW = false;
+
+    auto at = [&](size_t index) -> int { return index < size ? code[index] : -1; };
+
+    // legacy prefixes, at most 14 of them fit in the 15 byte limit
+    for (; i < 15; i++) {
+        int byte = at(i);
+        if (byte == 0x66) {
+            operandSize16 = true;
+        }
+        else if (byte == 0x67) {
+            addressSizeSmall = true;
+        }
+        else if (byte != 0xF0 && byte != 0xF2 && byte != 0xF3 && byte != 0x2E && byte != 0x36 && byte != 0x3E &&
+            byte != 0x26 && byte != 0x64 && byte != 0x65) {
+            break;
+        }
+    }
+
+    if (is64Bit && at(i) >= 0x40 && at(i) <= 0x4F) {
+        rexW = at(i) & 8;
+        i++;
+    }
+
+    int op = at(i);
+    if (op < 0) {
+        return false;
+    }
+
+    opcodeInfo info{};
+    int map = 0;
+
+    // vex and evex reuse les, lds and bound, outside x64 only when the next byte couldn't be a memory operand
+    bool vex = (op == 0xC4 || op == 0xC5) && (is64Bit || (at(i + 1) & 0xC0) == 0xC0);
+    bool evex = op == 0x62 && (is64Bit || (at(i + 1) & 0xC0) == 0xC0);
+
+    if (vex || evex) {
+        if (op == 0xC5) {
+            map = 1;
+            i += 2;
+        }
+        else if (op == 0xC4) {
+            map = at(i + 1) & 0x1F;
+            rexW = at(i + 2) & 0x80;
+            i += 3;
+        }
+        else {
+            map = at(i + 1) & 0x07;
+            rexW = at(i + 2) & 0x80;
+            i += 4;
+        }
+
+        op = at(i);
+        if (op < 0 || map < 1 || map > 3) {
+            return false;
+        }
+        i++;
+
+        info = mapped(map, static_cast<uint8_t>(op));
+        info.modrm = !(vex && map == 1 && op == 0x77); // vzeroupper and vzeroall
+        if (info.imm != imm_8) {
+            info.imm = imm_none; // no vex instruction takes anything but an imm8
+        }
+    }
+    else if (op == 0x0F) {
+        int second = at(i + 1);
+        if (second == 0x38 || second == 0x3A) {
+            map = second == 0x38 ? 2 : 3;
+            op = at(i + 2);
+            i += 3;
+        }
+        else {
+            map = 1;
+            op = second;
+            i += 2;
+        }
+        if (op < 0) {
+            return false;
+        }
+        info = mapped(map, static_cast<uint8_t>(op));
+    }
+    else {
+        if (is64Bit && (op == 0x06 || op == 0x07 || op == 0x0E || op == 0x16 || op == 0x17 || op == 0x1E || op == 0x1F ||
+            op == 0x27 || op == 0x2F || op == 0x37 || op == 0x3F || op == 0x60 || op == 0x61 || op == 0x82 ||
+            op == 0x9A || op == 0xD4 || op == 0xD5 || op == 0xD6 || op == 0xEA)) {
+            return false;
+        }
+        info = oneByte(static_cast<uint8_t>(op));
+        i++;
+    }
+
+    if (info.modrm) {
+        int modrm = at(i++);
+        if (modrm < 0) {
+            return false;
+        }
+
+        // mov to and from control and debug registers only ever takes registers, whatever mod says
+        int mod = (map == 1 && op >= 0x20 && op <= 0x26) ? 3 : modrm >> 6;
+        int reg = (modrm >> 3) & 7;
+        int rm = modrm & 7;
+
+        if (info.imm == imm_group3) {
+            info.imm = reg < 2 ? (op == 0xF6 ? imm_8 : imm_z) : imm_none;
+        }
+
+        if (mod != 3) {
+            size_t disp = 0;
+            if (!is64Bit && addressSizeSmall) {
+                // 16 bit addressing has no sib
+                disp = mod == 1 ? 1 : (mod == 2 || (mod == 0 && rm == 6)) ? 2 : 0;
+            }
+            else {
+                if (rm == 4) {
+                    int sib = at(i++);
+                    if (sib < 0) {
+                        return false;
+                    }
+                    if (mod == 0 && (sib & 7) == 5) {
+                        disp = 4;
+                    }
+                }
+                else if (mod == 0 && rm == 5) {
+                    disp = 4;
+                    out->ripRelative = is64Bit;
+                }
+
+                if (mod == 1) {
+                    disp = 1;
+                }
+                else if (mod == 2) {
+                    disp = 4;
+                }
+            }
+
+            out->dispOffset = i;
+            out->dispSize = disp;
+            i += disp;
+        }
+    }
+    else if (info.imm == imm_group3) {
+        info.imm = imm_none;
+    }
+
+    size_t immSize = 0;
+    switch (info.imm) {
+    case imm_8:
+        immSize = 1;
+        break;
+    case imm_16:
+        immSize = 2;
+        break;
+    case imm_z:
+        immSize = operandSize16 && !rexW ? 2 : 4;
+        break;
+    case imm_v:
+        immSize = rexW ? 8 : operandSize16 ? 2 : 4;
+        break;
+    case imm_rel8:
+        immSize = 1;
+        out->relative = true;
+        break;
+    case imm_relz:
+        immSize = operandSize16 && !is64Bit ? 2 : 4;
+        out->relative = true;
+        break;
+    case imm_enter:
+        immSize = 3;
+        break;
+    case imm_far:
+        immSize = operandSize16 ? 4 : 6;
+        out->address = true;
+        break;
+    case imm_moffs:
+        immSize = is64Bit ? (addressSizeSmall ? 4 : 8) : (addressSizeSmall ? 2 : 4);
+        out->address = true;
+        break;
+    default:
+        break;
+    }
+
+    out->immOffset = i;
+    out->immSize = immSize;
+    i += immSize;
+
+    if (i > 15 || i > size) {
+        *out = instructionLayout();
+        return false;
+    }
+
+    out->length = i;
+    return true;
+}